@@ -0,0 +1,57 @@
+#ifndef __COMMON_ATOMIC__H__
+#define __COMMON_ATOMIC__H__
+
+#include "common/types.h"
+
+/**
+ * 内存访问与内存屏障原语
+ * RVWMO内存模型下，普通的读写操作可以被硬件重排，多核共享的数据需要借助fence指令确定访问顺序
+ * 1.READ_ONCE/WRITE_ONCE：阻止编译器合并、拆分或省略访问，不提供硬件层面的顺序保证
+ * 2.smp_mb/smp_rmb/smp_wmb：硬件内存屏障
+ * 3.rcu_assign_pointer/rcu_dereference：发布/订阅指针(RCU的基础)
+ */
+
+/**
+ * @brief 编译器屏障
+ *
+ */
+#define barrier() asm volatile("" : : : "memory")
+
+/**
+ * @brief 单次读取，禁止编译器优化
+ * @param x 变量(左值)
+ */
+#define READ_ONCE(x) (*(const volatile __typeof__(x) *)&(x))
+
+/**
+ * @brief 单次写入，禁止编译器优化
+ * @param x 变量(左值)
+ * @param v 写入值
+ */
+#define WRITE_ONCE(x, v)                           \
+    do                                             \
+    {                                              \
+        *(volatile __typeof__(x) *)&(x) = (v);     \
+    } while (0)
+
+/* 硬件内存屏障*/
+#define smp_mb() asm volatile("fence rw, rw" : : : "memory")  /* 读写全屏障*/
+#define smp_rmb() asm volatile("fence r, r" : : : "memory")   /* 读屏障*/
+#define smp_wmb() asm volatile("fence w, w" : : : "memory")   /* 写屏障*/
+
+/**
+ * @brief 发布指针：p指向的对象初始化完成后，才对其他核心可见
+ *        store-release保证之前的所有写操作先于指针本身可见
+ * @param p 被赋值的指针(左值)
+ * @param v 新的指针值
+ */
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/**
+ * @brief 订阅指针：读取RCU保护的指针
+ *        RVWMO保证地址依赖的读操作有序，因此只需要阻止编译器优化
+ * @param p 被读取的指针(左值)
+ */
+#define rcu_dereference(p) READ_ONCE(p)
+
+#endif /* !__COMMON_ATOMIC__H__ */
@@ -0,0 +1,117 @@
+#ifndef __COMMON_BITOPS__H__
+#define __COMMON_BITOPS__H__
+
+#include "common/types.h"
+
+/**
+ * 位操作
+ * rv64g没有Zbb扩展，__builtin_clz/ctz/popcount会编译成libgcc的__clzdi2等函数调用，
+ * 内核不链接libgcc，这里用移位和比较的二分查找实现，全部内联
+ * clz64/ctz64/fls64的参数为0时结果没有意义(与__builtin_clz一致)，调用者需先判断
+ */
+
+/**
+ * @brief 前导零个数(x != 0)
+ *
+ * @param x
+ * @return uint32_t 0~63
+ */
+static inline uint32_t clz64(uint64_t x)
+{
+    uint32_t n = 0;
+    if (!(x & 0xffffffff00000000ul))
+    {
+        n += 32;
+        x <<= 32;
+    }
+    if (!(x & 0xffff000000000000ul))
+    {
+        n += 16;
+        x <<= 16;
+    }
+    if (!(x & 0xff00000000000000ul))
+    {
+        n += 8;
+        x <<= 8;
+    }
+    if (!(x & 0xf000000000000000ul))
+    {
+        n += 4;
+        x <<= 4;
+    }
+    if (!(x & 0xc000000000000000ul))
+    {
+        n += 2;
+        x <<= 2;
+    }
+    if (!(x & 0x8000000000000000ul))
+    {
+        n += 1;
+    }
+    return n;
+}
+/**
+ * @brief 末尾零个数(x != 0)
+ *
+ * @param x
+ * @return uint32_t 0~63
+ */
+static inline uint32_t ctz64(uint64_t x)
+{
+    uint32_t n = 0;
+    if (!(x & 0xfffffffful))
+    {
+        n += 32;
+        x >>= 32;
+    }
+    if (!(x & 0xfffful))
+    {
+        n += 16;
+        x >>= 16;
+    }
+    if (!(x & 0xfful))
+    {
+        n += 8;
+        x >>= 8;
+    }
+    if (!(x & 0xful))
+    {
+        n += 4;
+        x >>= 4;
+    }
+    if (!(x & 0x3ul))
+    {
+        n += 2;
+        x >>= 2;
+    }
+    if (!(x & 0x1ul))
+    {
+        n += 1;
+    }
+    return n;
+}
+/**
+ * @brief 最高置位的位置(从1开始)，x为0时返回0
+ *
+ * @param x
+ * @return uint32_t 0~64
+ */
+static inline uint32_t fls64(uint64_t x)
+{
+    return x ? 64 - clz64(x) : 0;
+}
+/**
+ * @brief 置位个数(SWAR，乘法由M扩展完成)
+ *
+ * @param x
+ * @return uint32_t
+ */
+static inline uint32_t hweight64(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ul);
+    x = (x & 0x3333333333333333ul) + ((x >> 2) & 0x3333333333333333ul);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0ful;
+    return (uint32_t)((x * 0x0101010101010101ul) >> 56);
+}
+
+#endif
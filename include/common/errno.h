@@ -0,0 +1,19 @@
+#ifndef __COMMON_ERRNO__H__
+#define __COMMON_ERRNO__H__
+
+/* 错误码(与Linux保持一致，内核函数返回负值表示错误)*/
+#define EPERM 1       /* 操作不允许*/
+#define ESRCH 3       /* 没有对应的进程/线程*/
+#define EINTR 4       /* 被信号打断*/
+#define EBADF 9       /* 文件描述符非法*/
+#define EAGAIN 11     /* 资源暂时不可用*/
+#define ENOMEM 12     /* 内存不足*/
+#define EFAULT 14     /* 非法地址*/
+#define EBUSY 16      /* 资源忙*/
+#define EEXIST 17     /* 已经存在*/
+#define EINVAL 22     /* 参数非法*/
+#define ENOSYS 38     /* 功能未实现*/
+#define ETIME 62      /* 定时器到期*/
+#define ETIMEDOUT 110 /* 超时*/
+
+#endif /* !__COMMON_ERRNO__H__ */
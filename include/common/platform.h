@@ -4,6 +4,6 @@
 #define NCPU 1
 #define K_BOOT_STACK_SIZE 0x1000 /* 4KB*/
 
-#define QEMU_VIRT_CPU_FREQ (10000000ul) /* 10MHz*/
+#define QEMU_VIRT_CPU_FREQ (10000000ul) /* 10MHz(设备树未提供timebase-frequency时的默认值)*/
 
 #endif /* !__COMMON_PLATFORM_H__ */
\ No newline at end of file
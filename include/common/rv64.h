@@ -115,6 +115,26 @@ static inline uint64_t read_dtb_entry(void)
 	asm volatile("mv %[dtb_entry], a3" : [dtb_entry] "=r"(dtb_entry));
 	return dtb_entry;
 }
+/**
+ * @brief 读取tp寄存器，内核态下tp保存当前核心的hartid
+ *
+ * @return uint64_t
+ */
+static inline uint64_t read_tp(void)
+{
+	uint64_t tp;
+	asm volatile("mv %[tp], tp" : [tp] "=r"(tp));
+	return tp;
+}
+/**
+ * @brief 写tp寄存器，内核启动时写入hartid
+ *
+ * @param x
+ */
+static inline void write_tp(uint64_t x)
+{
+	asm volatile("mv tp, %[x]" : : [x] "r"(x));
+}
 /* S-mode层级的寄存器sie PG.94 */
 /**
  * |15 - 14|   13 |12 - 10| 9  |8 - 6| 5  |4 - 2| 1  | 0 |
@@ -134,11 +154,26 @@ static inline void write_sie(uint64_t x)
 	asm volatile("csrw sie, %[x]" : : [x] "r"(x));
 }
 
+/* S-mode层级的寄存器sip(中断等待位与sie一一对应)*/
+#define SIP_SSIP (1L << 1) /* 核间中断等待位*/
+/**
+ * @brief 清除sip中的等待位(S-Mode只能清除SSIP)
+ *
+ * @param mask
+ */
+static inline void clear_sip(uint64_t mask)
+{
+	asm volatile("csrc sip, %[mask]" : : [mask] "r"(mask));
+}
+
 /**
  * S-mode层级的Trap-Vector Base Address
  * |63  -  2|1  -  0|
  * |base_adr|  mode |
+ * mode=0：所有陷阱跳转到base；mode=1：异常跳转到base，中断跳转到base + 4 * cause
  */
+#define STVEC_MODE_DIRECT (0)
+#define STVEC_MODE_VECTORED (1)
 static inline void write_stvec(uint64_t addr)
 {
 	asm volatile("csrw stvec, %[addr]" : : [addr] "r"(addr));
@@ -211,6 +246,43 @@ static inline uint64_t read_sstatus(void)
 	asm volatile("csrr %[val], sstatus" : [val] "=r"(val));
 	return val;
 }
+/**
+ * @brief 写sstatus寄存器
+ *
+ * @param val
+ */
+static inline void write_sstatus(uint64_t val)
+{
+	asm volatile("csrw sstatus, %[val]" : : [val] "r"(val));
+}
+/**
+ * @brief 读取sepc寄存器(S-Mode异常返回地址)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t read_sepc(void)
+{
+	uint64_t val;
+	asm volatile("csrr %[val], sepc" : [val] "=r"(val));
+	return val;
+}
+/**
+ * @brief 写sepc寄存器
+ *
+ * @param val
+ */
+static inline void write_sepc(uint64_t val)
+{
+	asm volatile("csrw sepc, %[val]" : : [val] "r"(val));
+}
+/**
+ * @brief 等待中断：即使sstatus.SIE关闭，sie中使能的中断挂起时也会唤醒
+ *
+ */
+static inline void wfi(void)
+{
+	asm volatile("wfi" : : : "memory");
+}
 /**
  * @brief 判断当前的中断状态
  * 
@@ -235,8 +307,10 @@ static inline uint64_t get_si(void)
 #define SCAUSE_TRAP_CODE_MASK ((1ul << SCAUSE_TRAP_CODE_LEN) - 1)
 #define SCAUSE_EXCEPTION (0ul)
 #define SCAUSE_INTERRUPT (1ul)
+#define INTERRUPT_SOFTWARE (1) /* 软件中断(核间中断)*/
 #define INTERRUPT_TIMER (5)	   /* 定时器中断*/
 #define INTERRUPT_EXTERNEL (9) /* 外部中断*/
+#define EXCEPTION_ECALL_U (8)  /* U-Mode的ecall(系统调用)*/
 static inline uint64_t read_scause(void)
 {
 	uint64_t cause;
@@ -244,6 +318,24 @@ static inline uint64_t read_scause(void)
 	return cause;
 }
 
+/**
+ * @brief 刷新本核心TLB中va所在页的缓存
+ *
+ * @param va
+ */
+static inline void sfence_vma(uint64_t va)
+{
+	asm volatile("sfence.vma %[va], zero" : : [va] "r"(va) : "memory");
+}
+/**
+ * @brief 刷新本核心的全部TLB
+ *
+ */
+static inline void sfence_vma_all(void)
+{
+	asm volatile("sfence.vma zero, zero" : : : "memory");
+}
+
 /**
  * @brief 读取时钟计数器的值
  *
@@ -255,4 +347,24 @@ static inline uint64_t read_rdtime(void)
 	asm volatile("rdtime %[tcount]" : [tcount] "=r"(tcount));
 	return tcount;
 }
+/**
+ * @brief 写scounteren寄存器：置位的计数器允许U-Mode读取(第1位TM对应time)
+ *
+ * @param val
+ */
+#define SCOUNTEREN_TM (1ul << 1)
+static inline void write_scounteren(uint64_t val)
+{
+	asm volatile("csrw scounteren, %[val]" : : [val] "r"(val));
+}
+/**
+ * @brief 写stimecmp寄存器(Sstc扩展，CSR编号0x14D)：time >= stimecmp时挂起S-Mode定时器中断
+ *        写入新值同时清除挂起的定时器中断，不需要经过SBI陷入M-Mode
+ *
+ * @param val
+ */
+static inline void write_stimecmp(uint64_t val)
+{
+	asm volatile("csrw 0x14d, %[val]" : : [val] "r"(val));
+}
 #endif /* __COMMON_RV64__H__ */
\ No newline at end of file
@@ -13,6 +13,8 @@ typedef signed int int32_t;
 typedef signed short int16_t;
 typedef signed char int8_t;
 
+#define INT32_MAX (0x7fffffff) /* int32_t最大值*/
+
 /* bool类型*/
 typedef uint8_t bool;
 #define true 1
@@ -2,8 +2,11 @@
 #define __CPU_CPU__H__
 
 #include "common/types.h"
+#include "common/platform.h"
+#include "common/rv64.h"
 #include "process/thread.h"
 #include "lock/mutex.h"
+#include "trap/trapframe.h"
 typedef struct
 {
     thread_t *cpu_running;          /* CPU正在运行的线程*/
@@ -11,8 +14,39 @@ typedef struct
     mutex_t *mutexs[MAX_MUTEX_NUM]; /* 互斥锁数组*/
     register_t sstatus;             /* sstatus之前的值(中断状态)*/
     uint8_t cpu_idle;               /* CPU是否空闲(没有进程执行)*/
+    uint64_t rcu_nesting;           /* RCU读临界区嵌套深度*/
+    context_t cpu_context;          /* 调度器上下文(swtch切换回调度器时使用)*/
+    uint8_t cpu_need_resched;       /* 中断返回时需要重新调度*/
+    uint8_t cpu_tick_stopped;       /* 周期tick已停止(空闲或只有一个可运行线程)*/
+    uint64_t cpu_next_event;        /* 已编程的下一次定时器中断时间(rdtime)，~0表示未编程*/
+    uint64_t cpu_irq_depth;         /* 正在处理的可嵌套中断层数(开中断处理外部中断期间非0)*/
+    uint32_t cpu_softirq_pending;   /* 待处理的软中断位图*/
+    uint8_t cpu_in_softirq;         /* 正在执行软中断(不能抢占，不能重入)*/
+    uint64_t cpu_user_pt;           /* 用户态正在使用的根页表地址(0表示在内核态)，用于限定TLB刷新的目标核心*/
+#ifdef JAEOS_LOCKSTAT
+    uint64_t irqoff_start;          /* 本次关中断的开始时间*/
+    uint64_t irqoff_max;            /* 最长关中断时间*/
+#endif
 } cpu_t;
 
+/**
+ * @brief 获取当前核心的id(内核态下tp寄存器保存hartid)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t cpuid(void)
+{
+    return read_tp();
+}
+
+/**
+ * @brief 当前cpu的结构体变量
+ *
+ */
+#define cpu_this (cpus[cpuid()])
+
 /* data*/
-extern cpu_t cpu_this;
-#endif /* !__CPU_CPU__H__*/
\ No newline at end of file
+extern cpu_t cpus[NCPU];
+extern uint64_t cpu_online_mask;
+extern uint8_t irq_stacks[NCPU][IRQ_STACK_SIZE];
+#endif /* !__CPU_CPU__H__*/
@@ -0,0 +1,43 @@
+#ifndef __CPU_SMP__H__
+#define __CPU_SMP__H__
+
+#include "common/types.h"
+#include "lib/llist.h"
+
+/* 核间中断类型(同一核心上未处理的同类IPI会被合并)*/
+#define IPI_CALL_FUNC (1u << 0)     /* 远程函数调用*/
+#define IPI_RESCHEDULE (1u << 1)    /* 重新调度*/
+#define IPI_TLB_SHOOTDOWN (1u << 2) /* TLB刷新*/
+#define IPI_TICK (1u << 3)          /* 重新计算下一次定时器事件(恢复已停止的tick)*/
+
+/* 远程TLB刷新超过该页数时，直接刷新整个TLB*/
+#define TLB_SHOOTDOWN_MAX_PAGES (32)
+
+/* csd标志*/
+#define CSD_FLAG_LOCK (1u << 0) /* csd正在使用(远程函数尚未执行完毕)*/
+#define CSD_FLAG_WAIT (1u << 1) /* 调用者同步等待*/
+
+typedef void (*smp_call_func_t)(void *arg);
+
+/**
+ * @brief 远程函数调用描述符(call single data)
+ *
+ */
+typedef struct
+{
+    llist_node_t csd_node;     /* 目标核心调用队列的节点*/
+    smp_call_func_t csd_func;  /* 远程执行的函数*/
+    void *csd_arg;             /* 函数参数*/
+    uint32_t csd_flags;        /* CSD_FLAG_**/
+} csd_t;
+
+/* functions*/
+void smp_init(void);
+void smp_boot_secondary(void);
+err_t smp_call_function_single(uint64_t cpu, smp_call_func_t func, void *arg, bool wait);
+void smp_call_function_many(uint64_t mask, smp_call_func_t func, void *arg, bool wait);
+void smp_send_reschedule(uint64_t cpu);
+void smp_send_tick(uint64_t cpu);
+void smp_tlb_shootdown(uint64_t mask, uint64_t va, uint64_t size);
+void ipi_interrupt_handler(void);
+#endif /* !__CPU_SMP__H__*/
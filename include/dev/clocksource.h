@@ -0,0 +1,205 @@
+#ifndef __DEV_CLOCKSOURCE__H__
+#define __DEV_CLOCKSOURCE__H__
+
+#include "common/types.h"
+#include "common/platform.h"
+#include "common/rv64.h"
+#include "lock/seqlock.h"
+
+/**
+ * 时钟源(clocksource)与计时(timekeeping)
+ * 1.时钟源是rdtime计数器，频率从设备树/cpus节点的timebase-frequency读取(没有时使用QEMU_VIRT_CPU_FREQ)
+ * 2.初始化时预先计算乘数：ns = (cycles * mult) >> CS_SHIFT，换算只需要一次128位乘法，不需要除法
+ *   周期→tick数使用64位小数的倒数乘法加一次校正，结果与除法完全相同
+ * 3.CLOCK_MONOTONIC：启动以来的时间；CLOCK_REALTIME：自1970年以来的时间，初始值来自goldfish RTC
+ * 4.计时器的基准受顺序锁保护，读路径不加锁
+ */
+
+#define CS_SHIFT (32)            /* 换算乘数的小数位数*/
+#define NSEC_PER_SEC (1000000000ul)
+#define NSEC_PER_MSEC (1000000ul)
+#define NSEC_PER_USEC (1000ul)
+
+/* 时钟编号(与Linux一致)*/
+#define CLOCK_REALTIME (0)
+#define CLOCK_MONOTONIC (1)
+
+/* goldfish RTC寄存器(读TIME_LOW时锁存TIME_HIGH)*/
+#define RTC_TIME_LOW (0x00)
+#define RTC_TIME_HIGH (0x04)
+
+/**
+ * @brief 用户态时间结构体(与Linux RV64一致)
+ *
+ */
+typedef struct
+{
+    int64_t tv_sec;  /* 秒*/
+    int64_t tv_nsec; /* 纳秒*/
+} timespec_t;
+typedef struct
+{
+    int64_t tv_sec;  /* 秒*/
+    int64_t tv_usec; /* 微秒*/
+} timeval_t;
+
+/**
+ * @brief 时钟源换算参数(初始化后只读)
+ *
+ */
+typedef struct
+{
+    uint64_t cs_freq;         /* 计数频率(Hz)*/
+    uint64_t cs_mult_ns;      /* 周期→纳秒乘数*/
+    uint64_t cs_mult_us;      /* 周期→微秒乘数*/
+    uint64_t cs_mult_cyc;     /* 纳秒→周期乘数(向上取整)*/
+    uint64_t cs_tick_cycles;  /* 每个tick的周期数*/
+    uint64_t cs_mult_jiffies; /* 周期→tick数乘数：(2^64 - 1) / cs_tick_cycles*/
+} clocksource_t;
+
+/**
+ * @brief 计时器：基准时刻的计数值与对应的两种时间(受tk_lock保护)
+ *        time = base + ((rdtime - tk_cycle_last) * mult >> CS_SHIFT)
+ */
+typedef struct
+{
+    seqlock_t tk_lock;      /* 顺序锁*/
+    uint64_t tk_cycle_last; /* 基准时刻的rdtime*/
+    uint64_t tk_mono_ns;    /* 基准时刻的CLOCK_MONOTONIC*/
+    uint64_t tk_real_ns;    /* 基准时刻的CLOCK_REALTIME*/
+} timekeeper_t;
+
+/* data*/
+extern clocksource_t clocksource;
+extern timekeeper_t timekeeper;
+
+/**
+ * @brief 定点乘法：(x * mult) >> CS_SHIFT，使用128位乘积避免溢出(RV64上是mul+mulhu)
+ *
+ * @param x
+ * @param mult
+ * @return uint64_t
+ */
+static inline uint64_t clocksource_mul(uint64_t x, uint64_t mult)
+{
+    return (uint64_t)(((unsigned __int128)x * mult) >> CS_SHIFT);
+}
+/**
+ * @brief 周期数换算为纳秒
+ *
+ * @param cycles
+ * @return uint64_t
+ */
+static inline uint64_t clocksource_cyc2ns(uint64_t cycles)
+{
+    return clocksource_mul(cycles, clocksource.cs_mult_ns);
+}
+/**
+ * @brief 周期数换算为微秒
+ *
+ * @param cycles
+ * @return uint64_t
+ */
+static inline uint64_t clocksource_cyc2us(uint64_t cycles)
+{
+    return clocksource_mul(cycles, clocksource.cs_mult_us);
+}
+/**
+ * @brief 周期数换算为tick数(向下取整)
+ *        乘数向下取整，估计值最多比商小1，用一次乘法校正，不需要除法
+ *
+ * @param cycles
+ * @return uint64_t
+ */
+static inline uint64_t clocksource_cyc2jiffies(uint64_t cycles)
+{
+    uint64_t q = (uint64_t)(((unsigned __int128)cycles * clocksource.cs_mult_jiffies) >> 64);
+    if (cycles - q * clocksource.cs_tick_cycles >= clocksource.cs_tick_cycles)
+    {
+        q++;
+    }
+    return q;
+}
+/**
+ * @brief 纳秒换算为周期数(向上取整，用于超时不会提前)
+ *
+ * @param ns
+ * @return uint64_t
+ */
+static inline uint64_t clocksource_ns2cyc(uint64_t ns)
+{
+    unsigned __int128 prod = (unsigned __int128)ns * clocksource.cs_mult_cyc;
+    return (uint64_t)((prod + ((1ul << CS_SHIFT) - 1)) >> CS_SHIFT);
+}
+/**
+ * @brief 微秒换算为周期数
+ *
+ * @param us
+ * @return uint64_t
+ */
+static inline uint64_t clocksource_us2cyc(uint64_t us)
+{
+    return clocksource_ns2cyc(us * NSEC_PER_USEC);
+}
+/**
+ * @brief timespec换算为纳秒(调用者已检查tv_sec >= 0且0 <= tv_nsec < NSEC_PER_SEC)
+ *        超出64位范围时饱和为~0ul，相当于永久等待
+ *
+ * @param ts
+ * @return uint64_t
+ */
+static inline uint64_t timespec_to_ns(const timespec_t *ts)
+{
+    if ((uint64_t)ts->tv_sec > (~0ul - (uint64_t)ts->tv_nsec) / NSEC_PER_SEC)
+    {
+        return ~0ul;
+    }
+    return (uint64_t)ts->tv_sec * NSEC_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+/**
+ * @brief CLOCK_MONOTONIC(纳秒)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t clock_mono_ns(void)
+{
+    uint32_t seq;
+    uint64_t ns;
+    do
+    {
+        seq = read_seqbegin(&timekeeper.tk_lock);
+        ns = timekeeper.tk_mono_ns + clocksource_cyc2ns(read_rdtime() - timekeeper.tk_cycle_last);
+    } while (read_seqretry(&timekeeper.tk_lock, seq));
+    return ns;
+}
+/**
+ * @brief CLOCK_MONOTONIC(微秒)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t time_mono_us(void)
+{
+    return clock_mono_ns() / NSEC_PER_USEC;
+}
+/**
+ * @brief CLOCK_REALTIME(纳秒)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t clock_real_ns(void)
+{
+    uint32_t seq;
+    uint64_t ns;
+    do
+    {
+        seq = read_seqbegin(&timekeeper.tk_lock);
+        ns = timekeeper.tk_real_ns + clocksource_cyc2ns(read_rdtime() - timekeeper.tk_cycle_last);
+    } while (read_seqretry(&timekeeper.tk_lock, seq));
+    return ns;
+}
+
+/* functions*/
+void clocksource_init(void);
+err_t clock_gettime_ns(int32_t clockid, uint64_t *ns);
+err_t clock_settime_ns(int32_t clockid, uint64_t ns);
+#endif /* !__DEV_CLOCKSOURCE__H__*/
@@ -28,6 +28,13 @@ typedef struct
     uint64_t start;
     uint64_t size;
 } MEM_INFO;
+/* CPU信息 */
+typedef struct
+{
+    uint32_t cpus;          /* 设备树中的核心数量*/
+    uint32_t sstc_cpus;     /* 支持Sstc扩展(stimecmp)的核心数量*/
+    uint64_t timebase_freq; /* rdtime计数频率(Hz)，0表示设备树未提供*/
+} CPU_INFO;
 /* 设备树标记值 */
 #define FDT_MAGIC 0xd00dfeed      /* 设备树头部魔数*/
 #define FDT_BEGIN_NODE 0x00000001 /* node起始标记*/
@@ -40,5 +47,6 @@ typedef struct
 void dtb_prase(uint64_t _dtb_entry);
 /* data*/
 extern MEM_INFO mem_info;
+extern CPU_INFO cpu_info;
 extern uint64_t dtb_entry;
 #endif /* !__DEV_DTB__H__ */
\ No newline at end of file
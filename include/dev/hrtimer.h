@@ -0,0 +1,78 @@
+#ifndef __DEV_HRTIMER__H__
+#define __DEV_HRTIMER__H__
+
+#include "common/types.h"
+#include "common/platform.h"
+#include "lock/mutex.h"
+#include "lib/queue.h"
+#include "process/thread.h"
+#include "process/uring.h"
+
+/**
+ * 高精度定时器(hrtimer)
+ * 1.到期时间是rdtime绝对值(10MHz，100ns精度)，不按tick取整
+ * 2.每个核心一个最小堆，硬件比较器单次编程为堆顶的到期时间
+ * 3.HARD定时器在定时器中断中执行回调(关中断，不持有队列锁)
+ *   SOFT定时器到期后挂入延迟链表，由HRTIMER软中断在中断返回前(开中断)执行
+ * 4.周期tick也是一个hrtimer，只在需要时启动
+ */
+
+#define HRTIMER_HEAP_MAX (MAX_THREAD_NUM + URING_TIMEOUT_POOL + 32) /* 每个核心最多排队的hrtimer数量(每个线程最多一个睡眠定时器)*/
+#define HRTIMER_INDEX_NONE (~0u)               /* 未排队*/
+#define HRTIMER_INDEX_SOFT (~0u - 1)           /* 已到期，在延迟链表中等待执行*/
+
+#define HRTIMER_MODE_HARD (0x01) /* 在中断中执行回调*/
+#define HRTIMER_MODE_SOFT (0x02) /* 延迟执行回调*/
+
+/**
+ * @brief 回调返回值
+ *
+ */
+typedef enum
+{
+    HRTIMER_NORESTART, /* 不再重启*/
+    HRTIMER_RESTART,   /* 按回调中更新的hr_expires重新排队*/
+} hrtimer_restart_t;
+
+/**
+ * @brief 高精度定时器
+ *
+ */
+typedef struct hrtimer
+{
+    uint64_t hr_expires;                           /* 到期时间(rdtime)*/
+    hrtimer_restart_t (*hr_func)(struct hrtimer *); /* 到期回调*/
+    struct hrtimer_base *hr_base;                  /* 最近一次启动所在核心的队列(NULL表示从未启动)*/
+    uint32_t hr_index;                             /* 在最小堆中的下标*/
+    uint8_t hr_mode;                               /* 回调执行方式*/
+    TAILQ_ENTRY(struct hrtimer)                    /* 拼接注释*/
+    hr_softlink;                                   /* 延迟链表链接*/
+} hrtimer_t;
+
+/**
+ * @brief 每个核心的hrtimer队列(受hb_lock保护)
+ *
+ */
+typedef struct hrtimer_base
+{
+    mutex_t hb_lock;                      /* 队列锁*/
+    uint64_t hb_cpu;                      /* 所属核心*/
+    uint64_t hb_nr;                       /* 堆中的定时器数量*/
+    hrtimer_t *hb_heap[HRTIMER_HEAP_MAX]; /* 按到期时间排列的最小堆*/
+    TAILQ_HEAD(hrtimer_t)                 /* 拼接注释*/
+    hb_soft;                              /* 已到期、等待执行的SOFT定时器*/
+    hrtimer_t *volatile hb_running;       /* 正在执行回调的定时器*/
+    bool hb_in_irq;                       /* 正在处理定时器中断(结束时统一编程比较器)*/
+} hrtimer_base_t;
+
+/* functions*/
+void hrtimer_bases_init(void);
+void hrtimer_init(hrtimer_t *hr, hrtimer_restart_t (*func)(hrtimer_t *), uint8_t mode);
+void hrtimer_start(hrtimer_t *hr, uint64_t expires);
+int32_t hrtimer_try_cancel(hrtimer_t *hr);
+bool hrtimer_cancel(hrtimer_t *hr);
+uint64_t hrtimer_forward(hrtimer_t *hr, uint64_t now, uint64_t interval);
+void hrtimer_interrupt(void);
+void hrtimer_run_soft(void);
+err_t hrtimer_nanosleep(uint64_t ns, bool abs);
+#endif /* !__DEV_HRTIMER__H__*/
@@ -0,0 +1,29 @@
+#ifndef __DEV_IRQ__H__
+#define __DEV_IRQ__H__
+
+#include "common/types.h"
+#include "dev/plic.h"
+
+/**
+ * 外部中断注册与分发
+ * 1.request_irq登记中断源的处理函数、PLIC优先级和允许的核心(亲和性)
+ * 2.每个中断源同一时刻只在一个核心上使能(路由目标)，从亲和性中选择负载最低的在线核心
+ * 3.一次外部中断循环claim/complete，处理完所有送到本核心的中断源
+ *   处理期间把本核心的阈值提高到当前中断源的优先级，更高优先级的中断源可以嵌套
+ * 4.周期性按各中断源的触发次数重新分配路由目标，避免单个核心成为瓶颈
+ */
+
+#define IRQ_NUM (PLIC_MAX_IR_ID + 1)   /* 中断源数量(0号不使用)*/
+#define IRQ_AFFINITY_ALL (~0ul)        /* 允许所有核心处理*/
+#define IRQ_TARGET_NONE (~0ul)         /* 未路由到任何核心*/
+#define IRQ_BALANCE_INTERVAL_MS (1000) /* 重新均衡路由的周期*/
+
+typedef void (*irq_handler_t)(uint32_t irq); /* 中断处理函数(中断上下文，不能睡眠)*/
+
+/* functions*/
+void irq_init(void);
+err_t request_irq(uint32_t irq, irq_handler_t handler, uint32_t priority, uint64_t cpumask);
+err_t irq_set_affinity(uint32_t irq, uint64_t cpumask);
+void irq_balance(void);
+void irq_dispatch(void);
+#endif /* !__DEV_IRQ__H__*/
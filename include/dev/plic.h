@@ -59,8 +59,16 @@
 #define UART0_IR_ID 10
 #define RTC_IR_ID 11
 
+#define PLIC_MAX_IR_ID (127) /* 最大中断源ID(QEMU virt)*/
+#define PLIC_PRIORITY_MIN (1) /* 最低有效优先级(0表示屏蔽)*/
+#define PLIC_PRIORITY_MAX (7) /* 最高优先级*/
+
 /* functions*/
 void plic_init(uint64_t hart_id);
 uint32_t plic_claim(uint64_t hart_id);
 void plic_complete(uint32_t interrupt_id, uint64_t hart_id);
+void plic_set_priority(uint32_t interrupt_id, uint32_t priority);
+void plic_set_enable(uint32_t interrupt_id, uint64_t hart_id, bool enable);
+uint32_t plic_get_threshold(uint64_t hart_id);
+void plic_set_threshold(uint64_t hart_id, uint32_t threshold);
 #endif /* !__DEV_PLIC__H__*/
\ No newline at end of file
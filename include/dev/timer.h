@@ -3,11 +3,46 @@
 
 #include "common/types.h"
 #include "common/platform.h"
+#include "common/rv64.h"
+#include "dev/clocksource.h"
 
 #define JAEOS_TIME_FREQ (1000ul)                                 /* 1KHz*/
-#define JAEOS_TIME_CYCLES (QEMU_VIRT_CPU_FREQ / JAEOS_TIME_FREQ) /* 10000cycles: 1ms*/
+#define JAEOS_TIME_CYCLES (clocksource.cs_tick_cycles)           /* 每个tick的rdtime周期数(10MHz时为10000)*/
+#define TIMER_EVENT_NONE (~0ul)                                  /* 没有待处理的定时器事件*/
+
+/**
+ * 动态tick
+ * 1.定时器不再固定每1ms触发，而是编程为最早的待处理事件：时间片/预算到期、RCU、睡眠超时(时间轮)
+ * 2.空闲核心没有待处理事件时不编程定时器，在wfi中等待中断
+ * 3.忙碌核心只有一个可运行线程时同样停止周期tick(full NO_HZ)
+ * 4.jiffies由rdtime推导，不依赖tick中断的次数
+ * 5.所有核心支持Sstc扩展时直接写stimecmp，否则通过sbi_set_timer陷入M-Mode编程mtimecmp
+ * 6.tick是一个hrtimer(dev/hrtimer.h)，硬件比较器由hrtimer统一编程为最早的到期时间
+ */
+
+/**
+ * @brief 自启动以来的tick数(由rdtime推导)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t timer_jiffies(void)
+{
+    return clocksource_cyc2jiffies(read_rdtime());
+}
+/**
+ * @brief now之后的下一个tick边界
+ *
+ * @param now
+ * @return uint64_t
+ */
+static inline uint64_t timer_next_tick(uint64_t now)
+{
+    return (clocksource_cyc2jiffies(now) + 1) * JAEOS_TIME_CYCLES;
+}
 
 /* functions*/
 void timer_init(void);
 void timer_interrupt_handler(void);
-#endif /* !__DEV_TIMER__H__*/
\ No newline at end of file
+void timer_reprogram(void);
+void timer_program(uint64_t stime_value);
+#endif /* !__DEV_TIMER__H__*/
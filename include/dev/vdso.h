@@ -0,0 +1,35 @@
+#ifndef __DEV_VDSO__H__
+#define __DEV_VDSO__H__
+
+#include "common/types.h"
+#include "lock/seqlock.h"
+#include "dev/vvar.h"
+
+/**
+ * 用户态时钟页(vDSO/vvar)
+ * 1.VVAR_VMA：只读数据页(PTE_R|PTE_U)，保存时钟源换算参数和计时器基准，受序列计数器保护
+ * 2.VDSO_VMA：代码页(PTE_R|PTE_X|PTE_U)，用户态直接读rdtime(scounteren.TM允许)并计算时间，不需要陷入内核
+ * 3.两个页由所有进程共享(内核镜像中的同一物理页)，内核在计时器基准变化时更新vvar
+ * 4.vdso.S按dev/vvar.h中的偏移访问vvar，修改结构体时需要同步修改
+ */
+
+/**
+ * @brief vvar数据：time = vv_base_ns[clockid] + ((rdtime - vv_cycle_last) * vv_mult >> vv_shift)
+ *
+ */
+typedef struct
+{
+    seqcount_t vv_seq;                /* 序列计数器(奇数表示内核正在更新)*/
+    uint32_t vv_shift;                /* 换算乘数的小数位数*/
+    uint64_t vv_mult;                 /* 周期→纳秒乘数*/
+    uint64_t vv_cycle_last;           /* 基准时刻的rdtime*/
+    uint64_t vv_base_ns[VVAR_CLOCKS]; /* 基准时刻的时间，按时钟编号索引*/
+} vvar_data_t;
+
+/* data*/
+extern vvar_data_t vvar;
+extern char vdso_page[]; /* vdso.S的全局符号(代码页起始地址)*/
+
+/* functions*/
+void vvar_update(void);
+#endif /* !__DEV_VDSO__H__*/
@@ -0,0 +1,20 @@
+#ifndef __DEV_VVAR_H__
+#define __DEV_VVAR_H__
+
+/* vvar字段偏移(vdso.S使用，与vvar_data_t保持一致)*/
+#define VVAR_SEQ_OFFSET 0
+#define VVAR_SHIFT_OFFSET 4
+#define VVAR_MULT_OFFSET 8
+#define VVAR_CYCLE_LAST_OFFSET 16
+#define VVAR_BASE_NS_OFFSET 24
+
+#define VVAR_CLOCKS 2 /* vvar中保存基准的时钟数(CLOCK_REALTIME、CLOCK_MONOTONIC)，按时钟编号索引*/
+
+/* vdso函数在VDSO_VMA页内的偏移(用户态按VDSO_VMA + 偏移调用)*/
+#define VDSO_CLOCK_GETTIME_OFFSET 0x000 /* int clock_gettime(clockid_t, struct timespec *)*/
+#define VDSO_GETTIMEOFDAY_OFFSET 0x100  /* int gettimeofday(struct timeval *, void *)*/
+
+/* vdso不支持时回退的系统调用号*/
+#define VDSO_SYS_CLOCK_GETTIME 113
+
+#endif /* __DEV_VVAR_H__*/
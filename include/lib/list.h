@@ -1,5 +1,6 @@
 #ifndef __LIB_LIST__H__
 #define __LIB_LIST__H__
+#include "common/atomic.h"
 
 /*
  * List definitions.
@@ -52,4 +53,96 @@
         (elm)->field.le_prev = &(head)->lh_first;                    \
     } while (/*CONSTCOND*/ 0)
 
+/**
+ * @brief 链表为空
+ *        当链表为空时，返回true，否则返回false
+ * @param head 链表头地址
+ */
+#define LIST_EMPTY(head) ((head)->lh_first == NULL)
+
+/**
+ * @brief 获取链表中的第一个成员
+ * @param head 链表头地址
+ */
+#define LIST_FIRST(head) ((head)->lh_first)
+
+/**
+ * @brief 获取链表中elm的下一个成员
+ * @param elm 成员地址
+ * @param field 链接字段
+ */
+#define LIST_NEXT(elm, field) ((elm)->field.le_next)
+
+/**
+ * @brief 遍历链表
+ * @param var 迭代变量
+ * @param head 链表头地址
+ * @param field 链接字段
+ */
+#define LIST_FOREACH(var, head, field) \
+    for ((var) = LIST_FIRST(head);     \
+         (var);                        \
+         (var) = LIST_NEXT(var, field))
+
+/**
+ * @brief 从链表中移除elm成员
+ * @param elm 移除成员地址
+ * @param field 链接字段
+ */
+#define LIST_REMOVE(elm, field)                                                \
+    do                                                                         \
+    {                                                                          \
+        if ((elm)->field.le_next != NULL)                                      \
+            (elm)->field.le_next->field.le_prev = (elm)->field.le_prev;        \
+        *(elm)->field.le_prev = (elm)->field.le_next;                          \
+    } while (0)
+
+/*
+ * RCU List definitions.
+ * 写者之间仍需互斥(加锁)，读者只需要处于rcu_read_lock()/rcu_read_unlock()之间
+ * 移除的成员必须等待宽限期(synchronize_rcu/call_rcu)结束后才能释放或复用
+ */
+
+/**
+ * @brief 头插法插入链表成员(RCU)
+ *        先初始化elm的链接字段，再发布elm，读者不会看到未初始化的成员
+ * @param head 链表头地址
+ * @param elm 插入成员地址
+ * @param field 插入链接
+ */
+#define LIST_INSERT_HEAD_RCU(head, elm, field)                       \
+    do                                                               \
+    {                                                                \
+        (elm)->field.le_next = (head)->lh_first;                     \
+        (elm)->field.le_prev = &(head)->lh_first;                    \
+        if ((head)->lh_first != NULL)                                \
+            (head)->lh_first->field.le_prev = &(elm)->field.le_next; \
+        rcu_assign_pointer((head)->lh_first, (elm));                 \
+    } while (0)
+
+/**
+ * @brief 从链表中移除elm成员(RCU)
+ *        保留elm->le_next，正在访问elm的读者仍然可以继续向后遍历
+ * @param elm 移除成员地址
+ * @param field 链接字段
+ */
+#define LIST_REMOVE_RCU(elm, field)                                            \
+    do                                                                         \
+    {                                                                          \
+        if ((elm)->field.le_next != NULL)                                      \
+            (elm)->field.le_next->field.le_prev = (elm)->field.le_prev;        \
+        rcu_assign_pointer(*(elm)->field.le_prev, (elm)->field.le_next);       \
+    } while (0)
+
+/**
+ * @brief 遍历链表(RCU读者)
+ * @param var 迭代变量
+ * @param head 链表头地址
+ * @param field 链接字段
+ */
+#define LIST_FOREACH_RCU(var, head, field)          \
+    for ((var) = rcu_dereference((head)->lh_first); \
+         (var);                                     \
+         (var) = rcu_dereference((var)->field.le_next))
+
 #endif /* !__LIB_LIST__H__*/
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef __LIB_LLIST__H__
+#define __LIB_LLIST__H__
+
+#include "common/types.h"
+
+/**
+ * 无锁单链表(lock-less list)
+ * 多个生产者通过CAS并发插入(llist_add)，消费者一次性摘下整个链表(llist_del_all)
+ * 不支持从链表中间删除，适用于核间调用队列、工作队列等多生产者单消费者场景
+ */
+
+/**
+ * @brief 无锁链表节点(嵌入到成员结构体中)
+ *
+ */
+typedef struct llist_node
+{
+    struct llist_node *next;
+} llist_node_t;
+
+/**
+ * @brief 无锁链表头
+ *
+ */
+typedef struct
+{
+    llist_node_t *first;
+} llist_head_t;
+
+/**
+ * @brief 由节点地址获取成员结构体地址
+ * @param ptr 节点地址
+ * @param type 成员结构体类型
+ * @param member 节点在结构体中的字段名
+ */
+#define llist_entry(ptr, type, member) ((type *)((char *)(ptr) - __builtin_offsetof(type, member)))
+
+/**
+ * @brief 初始化无锁链表
+ *
+ * @param head
+ */
+static inline void init_llist_head(llist_head_t *head)
+{
+    head->first = NULL;
+}
+/**
+ * @brief 无锁链表为空
+ *
+ * @param head
+ * @return bool
+ */
+static inline bool llist_empty(llist_head_t *head)
+{
+    return __atomic_load_n(&head->first, __ATOMIC_RELAXED) == NULL;
+}
+/**
+ * @brief 头插法插入节点(多生产者安全)
+ *
+ * @param node
+ * @param head
+ * @return bool 插入前链表是否为空(为空时通常需要通知消费者)
+ */
+static inline bool llist_add(llist_node_t *node, llist_head_t *head)
+{
+    llist_node_t *first = __atomic_load_n(&head->first, __ATOMIC_RELAXED);
+    do
+    {
+        node->next = first;
+    } while (!__atomic_compare_exchange_n(&head->first, &first, node, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return first == NULL;
+}
+/**
+ * @brief 摘下整个链表(返回的链表按插入顺序逆序排列)
+ *
+ * @param head
+ * @return llist_node_t*
+ */
+static inline llist_node_t *llist_del_all(llist_head_t *head)
+{
+    return __atomic_exchange_n(&head->first, NULL, __ATOMIC_ACQUIRE);
+}
+/**
+ * @brief 反转链表(将llist_del_all的结果恢复为插入顺序)
+ *
+ * @param node
+ * @return llist_node_t*
+ */
+static inline llist_node_t *llist_reverse_order(llist_node_t *node)
+{
+    llist_node_t *prev = NULL;
+    while (node != NULL)
+    {
+        llist_node_t *next = node->next;
+        node->next = prev;
+        prev = node;
+        node = next;
+    }
+    return prev;
+}
+#endif /* !__LIB_LLIST__H__*/
@@ -1,5 +1,6 @@
 #ifndef __LIB_QUEUE__H__
 #define __LIB_QUEUE__H__
+#include "common/atomic.h"
 
 /**
  * @brief 尾队列定义(head)
@@ -119,4 +120,82 @@
 #define TAILQ_NEXT(elm, field) ((elm)->field.tqe_next)
 #define TAILQ_LAST(head, headname) (*(((struct headname *)((head)->tqh_last))->tqh_last))
 #define TAILQ_PREV(elm, headname, field) (*(((struct headname *)((elm)->field.tqe_prev))->tqh_last))
+
+/**
+ * @brief 遍历队列
+ * @param var 迭代变量
+ * @param head 队列头地址
+ * @param field 链接字段
+ */
+#define TAILQ_FOREACH(var, head, field) \
+    for ((var) = TAILQ_FIRST(head);     \
+         (var);                         \
+         (var) = TAILQ_NEXT(var, field))
+
+/*
+ * RCU Tail queue definitions.
+ * 写者之间仍需互斥(加锁)，读者只能使用TAILQ_FOREACH_RCU向后遍历(tqe_prev/tqh_last不受保护)
+ * 移除的成员必须等待宽限期(synchronize_rcu/call_rcu)结束后才能释放或复用
+ */
+
+/**
+ * @brief 头插法插入队列(RCU)
+ * @param head 队列头地址
+ * @param elm 插入成员地址
+ * @param field 链接字段
+ */
+#define TAILQ_INSERT_HEAD_RCU(head, elm, field)                         \
+    do                                                                  \
+    {                                                                   \
+        (elm)->field.tqe_next = (head)->tqh_first;                      \
+        (elm)->field.tqe_prev = &(head)->tqh_first;                     \
+        if ((head)->tqh_first != NULL)                                  \
+            (head)->tqh_first->field.tqe_prev = &(elm)->field.tqe_next; \
+        else                                                            \
+            (head)->tqh_last = &(elm)->field.tqe_next;                  \
+        rcu_assign_pointer((head)->tqh_first, (elm));                   \
+    } while (0)
+
+/**
+ * @brief 将elm成员插入到队尾(RCU)
+ * @param head 队列头地址
+ * @param elm 插入成员地址
+ * @param field 链接字段
+ */
+#define TAILQ_INSERT_TAIL_RCU(head, elm, field)     \
+    do                                              \
+    {                                               \
+        (elm)->field.tqe_next = NULL;               \
+        (elm)->field.tqe_prev = (head)->tqh_last;   \
+        rcu_assign_pointer(*(head)->tqh_last, (elm)); \
+        (head)->tqh_last = &(elm)->field.tqe_next;  \
+    } while (0)
+
+/**
+ * @brief 移除队列中的elm对应的entry(RCU)
+ *        保留elm->tqe_next，正在访问elm的读者仍然可以继续向后遍历
+ * @param head 队列头地址
+ * @param elm 移除成员地址
+ * @param field 链接字段
+ */
+#define TAILQ_REMOVE_RCU(head, elm, field)                                 \
+    do                                                                     \
+    {                                                                      \
+        if (((elm)->field.tqe_next) != NULL)                               \
+            (elm)->field.tqe_next->field.tqe_prev = (elm)->field.tqe_prev; \
+        else                                                               \
+            (head)->tqh_last = (elm)->field.tqe_prev;                      \
+        rcu_assign_pointer(*(elm)->field.tqe_prev, (elm)->field.tqe_next); \
+    } while (0)
+
+/**
+ * @brief 遍历队列(RCU读者)
+ * @param var 迭代变量
+ * @param head 队列头地址
+ * @param field 链接字段
+ */
+#define TAILQ_FOREACH_RCU(var, head, field)          \
+    for ((var) = rcu_dereference((head)->tqh_first); \
+         (var);                                      \
+         (var) = rcu_dereference((var)->field.tqe_next))
 #endif /* !__LIB_QUEUE__H__*/
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef __LIB_RBTREE__H__
+#define __LIB_RBTREE__H__
+
+#include "common/types.h"
+
+/**
+ * 侵入式红黑树
+ * 1.rb_node_t嵌入到元素结构体中，通过rb_entry获取元素
+ * 2.比较函数由调用者提供，键值相等的元素插入到已有元素的右侧(保持插入顺序)
+ * 3.rb_root_t缓存最左节点，rb_first为O(1)
+ */
+
+#define RB_RED (0)
+#define RB_BLACK (1)
+
+/**
+ * @brief 红黑树节点
+ *
+ */
+typedef struct rb_node
+{
+    struct rb_node *rb_parent; /* 父节点*/
+    struct rb_node *rb_left;   /* 左子节点*/
+    struct rb_node *rb_right;  /* 右子节点*/
+    uint8_t rb_color;          /* 节点颜色*/
+} rb_node_t;
+
+/**
+ * @brief 红黑树根
+ *
+ */
+typedef struct
+{
+    rb_node_t *rb_node;     /* 根节点*/
+    rb_node_t *rb_leftmost; /* 最左节点(最小元素)*/
+} rb_root_t;
+
+/**
+ * @brief 通过节点获取元素
+ * @param ptr rb_node_t指针
+ * @param type 元素类型
+ * @param member rb_node_t在元素中的字段名
+ */
+#define rb_entry(ptr, type, member) ((type *)((char *)(ptr) - __builtin_offsetof(type, member)))
+
+/**
+ * @brief 初始化红黑树
+ *
+ * @param root
+ */
+static inline void rb_init(rb_root_t *root)
+{
+    root->rb_node = NULL;
+    root->rb_leftmost = NULL;
+}
+/**
+ * @brief 红黑树是否为空
+ *
+ * @param root
+ * @return bool
+ */
+static inline bool rb_empty(const rb_root_t *root)
+{
+    return root->rb_node == NULL;
+}
+/**
+ * @brief 最小节点
+ *
+ * @param root
+ * @return rb_node_t*
+ */
+static inline rb_node_t *rb_first(const rb_root_t *root)
+{
+    return root->rb_leftmost;
+}
+
+/* functions*/
+void rb_insert(rb_root_t *root, rb_node_t *node, bool (*less)(const rb_node_t *, const rb_node_t *));
+void rb_erase(rb_root_t *root, rb_node_t *node);
+rb_node_t *rb_next(const rb_node_t *node);
+rb_node_t *rb_last(const rb_root_t *root);
+#endif /* !__LIB_RBTREE__H__*/
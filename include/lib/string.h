@@ -5,4 +5,5 @@
 int32_t strlen(const char *str);
 int32_t strcmp(const char *s1, const char *s2);
 void *memset(void *dest, int32_t val, int32_t count);
+void *memcpy(void *dest, const void *src, uint64_t count);
 #endif  /* !__LIB_STRING__H__*/
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef __LOCK_LOCKSTAT__H__
+#define __LOCK_LOCKSTAT__H__
+#include "common/types.h"
+#include "lock/mutex.h"
+
+/**
+ * 锁统计(lockstat)
+ * 开启JAEOS_LOCKSTAT后，记录每个mutex的获取次数、竞争次数、等待时间、持有时间，以及每个核心的最长关中断时间
+ * 时间均来自rdtime计数，lockstat_dump()按竞争次数降序输出，用户态通过trapstat系统调用(TRAPSTAT_LOCK)读取
+ * 未开启时所有接口均为空函数，不影响mutex的性能
+ */
+
+#define LOCKSTAT_DUMP_MAX (32) /* 最多输出的锁数量*/
+#define LOCKSTAT_NAME_LEN (32) /* 输出记录中锁名的最大长度(含结尾的0)*/
+
+/**
+ * @brief 复制到用户空间的单个锁的统计记录(时间单位为rdtime计数)
+ *
+ */
+typedef struct
+{
+    char lr_name[LOCKSTAT_NAME_LEN]; /* 锁名(过长时截断)*/
+    uint64_t lr_acquired;            /* 获取次数*/
+    uint64_t lr_contended;           /* 发生竞争的获取次数*/
+    uint64_t lr_wait_total;          /* 累计等待时间*/
+    uint64_t lr_wait_max;            /* 最长等待时间*/
+    uint64_t lr_hold_total;          /* 累计持有时间*/
+    uint64_t lr_hold_max;            /* 最长持有时间*/
+} lockstat_record_t;
+
+#ifdef JAEOS_LOCKSTAT
+/* functions*/
+void lockstat_register(mutex_t *m);
+void lockstat_acquired(mutex_t *m, uint64_t wait, bool contended);
+void lockstat_released(mutex_t *m);
+void lockstat_irqoff_begin(void);
+void lockstat_irqoff_end(void);
+void lockstat_dump(void);
+int32_t lockstat_read(lockstat_record_t *recs, int32_t max);
+void lockstat_reset(void);
+#else
+static inline void lockstat_register(mutex_t *m) {}
+static inline void lockstat_acquired(mutex_t *m, uint64_t wait, bool contended) {}
+static inline void lockstat_released(mutex_t *m) {}
+static inline void lockstat_irqoff_begin(void) {}
+static inline void lockstat_irqoff_end(void) {}
+static inline void lockstat_dump(void) {}
+static inline void lockstat_reset(void) {}
+#endif
+#endif /* !__LOCK_LOCKSTAT__H__*/
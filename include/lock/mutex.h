@@ -1,7 +1,7 @@
 #ifndef __LOCK_MUTEX__H__
 #define __LOCK_MUTEX__H__
 #include "common/types.h"
-#include "process/thread.h"
+#include "lib/list.h"
 
 #define MUTEX_TYPE_SPIN (0x01)	/* mutex底层基于自旋锁实现*/
 #define MUTEX_TYPE_SLEEP (0x02) /* mutex底层基于睡眠锁实现*/
@@ -10,6 +10,22 @@
 
 #define MAX_MUTEX_NUM (128) /* CPU支持的最多mutex数量(可重入深度)*/
 
+/**
+ * @brief 锁统计信息(JAEOS_LOCKSTAT)，时间单位为rdtime计数
+ *
+ */
+typedef struct
+{
+	uint64_t ls_acquired;	/* 获取次数*/
+	uint64_t ls_contended;	/* 发生竞争(需要自旋等待)的获取次数*/
+	uint64_t ls_wait_total; /* 累计等待时间*/
+	uint64_t ls_wait_max;	/* 最长等待时间*/
+	uint64_t ls_hold_total; /* 累计持有时间*/
+	uint64_t ls_hold_max;	/* 最长持有时间*/
+	uint64_t ls_hold_start; /* 本次持有的开始时间*/
+	bool ls_registered;		/* 是否已加入统计链表*/
+} lockstat_t;
+
 /**
  * @brief mutex类型定义
  *
@@ -22,6 +38,11 @@ typedef struct mutex
 	void *mutex_data;			/* 互斥锁mutex的实际数据*/
 	uint8_t mutex_type;			/* 互斥锁mutex的底层实现类型*/
 	uint8_t mutex_depth;		/* 互斥锁mutex的锁深度*/
+#ifdef JAEOS_LOCKSTAT
+	lockstat_t mutex_stat;		/* 锁统计信息*/
+	LIST_ENTRY(struct mutex)	/* 拼接注释*/
+	mutex_statlink;				/* 锁统计链表entry*/
+#endif
 } mutex_t;
 
 /* functions*/
@@ -36,6 +57,11 @@ extern mutex_t pid_lock;
 extern mutex_t pr_lock;
 extern mutex_t kvm_lock;
 extern mutex_t sigevent_lock;
+extern mutex_t rcu_lock;
+extern mutex_t dl_bw_lock;
+extern mutex_t uring_lock;
+extern mutex_t irq_lock;
+extern mutex_t sighand_lock;
 
 extern mutex_t *mutexs;
 #endif /* !__LOCK_MUTEX__H__*/
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef __LOCK_RCU__H__
+#define __LOCK_RCU__H__
+#include "common/types.h"
+#include "common/atomic.h"
+#include "cpu/cpu.h"
+
+/**
+ * RCU(Read-Copy-Update)
+ * 1.读者：rcu_read_lock()/rcu_read_unlock()之间不加锁地遍历共享数据，读临界区中不允许睡眠或切换线程
+ * 2.写者：加锁后复制/修改数据，通过rcu_assign_pointer发布新版本，旧版本在宽限期结束后释放
+ * 3.宽限期：所有核心都经过一次静止状态(上下文切换、陷阱返回、时钟中断时不在读临界区)
+ *           宽限期结束后，宽限期开始前进入读临界区的读者一定已经离开
+ * 4.空闲核心处于扩展静止状态，宽限期不等待空闲核心，空闲核心可以停止tick
+ */
+
+/**
+ * @brief RCU回调结构(嵌入到需要延迟释放的对象中)
+ *
+ */
+typedef struct rcu_head
+{
+    struct rcu_head *rh_next;           /* 回调链表的下一个成员*/
+    void (*rh_func)(struct rcu_head *); /* 宽限期结束后调用的函数*/
+    uint64_t rh_gp;                     /* 需要等待完成的宽限期编号*/
+} rcu_head_t;
+
+/**
+ * @brief 进入RCU读临界区(可嵌套)
+ *
+ */
+static inline void rcu_read_lock(void)
+{
+    cpu_this.rcu_nesting++;
+    barrier();
+}
+/**
+ * @brief 离开RCU读临界区
+ *
+ */
+static inline void rcu_read_unlock(void)
+{
+    barrier();
+    cpu_this.rcu_nesting--;
+}
+
+/* functions*/
+void rcu_init(void);
+void rcu_note_qs(void);
+void rcu_check_callbacks(void);
+bool rcu_pending(void);
+void rcu_idle_enter(void);
+void rcu_idle_exit(void);
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *));
+void synchronize_rcu(void);
+#endif /* !__LOCK_RCU__H__*/
@@ -0,0 +1,141 @@
+#ifndef __LOCK_SEQLOCK__H__
+#define __LOCK_SEQLOCK__H__
+#include "common/types.h"
+#include "common/atomic.h"
+#include "lock/mutex.h"
+
+/**
+ * 顺序锁(seqlock)
+ * 1.写者修改数据前后各递增一次序列号，修改期间序列号为奇数
+ * 2.读者不加锁：记录读取前的序列号，读取后序列号变化(或读取前为奇数)则重试
+ * 3.适用于读多写少、数据较小的场景(时间)：读者不会使写者等待，读路径只有两次读序列号和两个读屏障
+ * 4.写者之间需要互斥：seqcount_t由调用者保证，seqlock_t内置一个自旋锁
+ */
+
+/**
+ * @brief 序列计数器
+ *
+ */
+typedef struct
+{
+    uint32_t sequence; /* 序列号：奇数表示正在写*/
+} seqcount_t;
+
+/**
+ * @brief 序列计数器 + 写者互斥锁
+ *
+ */
+typedef struct
+{
+    seqcount_t seqcount; /* 序列计数器*/
+    mutex_t lock;        /* 写者互斥锁*/
+} seqlock_t;
+
+/**
+ * @brief 初始化序列计数器
+ *
+ * @param s
+ */
+static inline void seqcount_init(seqcount_t *s)
+{
+    s->sequence = 0;
+}
+/**
+ * @brief 读者开始读取，等待正在进行的写结束
+ *
+ * @param s
+ * @return uint32_t 读取前的序列号
+ */
+static inline uint32_t read_seqcount_begin(const seqcount_t *s)
+{
+    uint32_t seq;
+    while ((seq = READ_ONCE(s->sequence)) & 1)
+        ;
+    smp_rmb();
+    return seq;
+}
+/**
+ * @brief 读者结束读取，检查期间是否发生了写
+ *
+ * @param s
+ * @param seq read_seqcount_begin的返回值
+ * @return bool 需要重试
+ */
+static inline bool read_seqcount_retry(const seqcount_t *s, uint32_t seq)
+{
+    smp_rmb();
+    return READ_ONCE(s->sequence) != seq;
+}
+/**
+ * @brief 写者开始修改(写者之间需要互斥)
+ *
+ * @param s
+ */
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+    WRITE_ONCE(s->sequence, s->sequence + 1);
+    smp_wmb();
+}
+/**
+ * @brief 写者结束修改
+ *
+ * @param s
+ */
+static inline void write_seqcount_end(seqcount_t *s)
+{
+    smp_wmb();
+    WRITE_ONCE(s->sequence, s->sequence + 1);
+}
+/**
+ * @brief 初始化顺序锁
+ *
+ * @param sl
+ * @param name
+ */
+static inline void seqlock_init(seqlock_t *sl, char *name)
+{
+    seqcount_init(&sl->seqcount);
+    mutex_init(&sl->lock, name, MUTEX_TYPE_SPIN);
+}
+/**
+ * @brief 读者开始读取
+ *
+ * @param sl
+ * @return uint32_t
+ */
+static inline uint32_t read_seqbegin(const seqlock_t *sl)
+{
+    return read_seqcount_begin(&sl->seqcount);
+}
+/**
+ * @brief 读者结束读取
+ *
+ * @param sl
+ * @param seq
+ * @return bool 需要重试
+ */
+static inline bool read_seqretry(const seqlock_t *sl, uint32_t seq)
+{
+    return read_seqcount_retry(&sl->seqcount, seq);
+}
+/**
+ * @brief 写者加锁并开始修改
+ *
+ * @param sl
+ */
+static inline void write_seqlock(seqlock_t *sl)
+{
+    mutex_lock(&sl->lock);
+    write_seqcount_begin(&sl->seqcount);
+}
+/**
+ * @brief 写者结束修改并解锁
+ *
+ * @param sl
+ */
+static inline void write_sequnlock(seqlock_t *sl)
+{
+    write_seqcount_end(&sl->seqcount);
+    mutex_unlock(&sl->lock);
+}
+#endif /* !__LOCK_SEQLOCK__H__*/
@@ -61,6 +61,10 @@ extern char end[];
  * |       PAGE_SIZE      |
  * +---------------------+  <-- SIGNAL_TRAMPOLINE(信号跳板)
  * |       PAGE_SIZE      |
+ * +---------------------+  <-- VDSO(用户态时钟代码页)
+ * |       PAGE_SIZE      |
+ * +---------------------+  <-- VVAR(用户态时钟数据页，只读)
+ * |       PAGE_SIZE      |
  * +---------------------+  <-- TRAPFRAME(陷阱帧)
  * |       PAGE_SIZE      |
  * +---------------------+  <-- STACKTOP(内核栈顶)
@@ -82,6 +86,10 @@ extern char end[];
  * |----------------------|
  * |         256KB        |     (用户栈扩展空间)
  * +---------------------+  <-- TD_USTACK_BOTTOM
+ * |       PAGE_SIZE      |     (不可访问)
+ * +---------------------+
+ * |   URING_PAGE_NUM页   |     (提交/完成队列，用户与内核共享)
+ * +---------------------+  <-- URING
  */
 
 #define MAX_VMA ((1ul << (9 + 9 + 9 + 12 - 1)) - 1) /* 256G 0x0 ~ 0x3FFFFFFFFFFFFF*/
@@ -89,7 +97,9 @@ extern char end[];
 
 #define TRAMPOLINE_VMA (MAX_VMA + 1 - PAGE_SIZE)           /* 跳板代码起始地址*/
 #define SIGNAL_TRAMPOLINE_VMA (TRAMPOLINE_VMA - PAGE_SIZE) /* 信号跳板起始地址*/
-#define TRAPFRAME_VMA (SIGNAL_TRAMPOLINE_VMA - PAGE_SIZE)  /* 陷阱帧起始地址*/
+#define VDSO_VMA (SIGNAL_TRAMPOLINE_VMA - PAGE_SIZE)       /* 用户态时钟代码页起始地址*/
+#define VVAR_VMA (VDSO_VMA - PAGE_SIZE)                    /* 用户态时钟数据页起始地址(vdso.S按相对位置访问)*/
+#define TRAPFRAME_VMA (VVAR_VMA - PAGE_SIZE)               /* 陷阱帧起始地址*/
 #define STACKTOP_VMA (TRAPFRAME_VMA - PAGE_SIZE)           /* 内核栈顶*/
 #define USTACKTOP_VMA STACKTOP_VMA                         /* 用户栈顶*/
 
@@ -108,4 +118,8 @@ extern char end[];
 #define TD_USTACK_EXTEND_SIZE (TD_USTACK_EXTEND_PAGE_NUM * PAGE_SIZE)            /* 用户栈扩展空间大小*/
 #define TD_USTACK_BOTTOM_VMA (TD_USTACK_INIT_BOTTOM_VMA - TD_USTACK_EXTEND_SIZE) /* 用户栈扩展空间底部*/
 
+/* 提交/完成队列(用户栈下方，中间隔一个不可访问页)*/
+#define URING_PAGE_NUM (3)                                                        /* 头部、提交队列、完成队列各一页*/
+#define URING_VMA (TD_USTACK_BOTTOM_VMA - PAGE_SIZE - URING_PAGE_NUM * PAGE_SIZE) /* 队列起始地址*/
+
 #endif /* __MMU_MMU__H__*/
\ No newline at end of file
@@ -90,6 +90,18 @@
 
 /* 配置MODE字段*/
 #define SATP_MODE_SHIFT (60)
+#define SATP_MODE_SV39 (8ul)
+
+/**
+ * @brief 根页表地址转换为satp寄存器的值(SV39)
+ *
+ * @param pt_address 根页表物理地址
+ * @return uint64_t
+ */
+static inline uint64_t make_satp(uint64_t pt_address)
+{
+    return (SATP_MODE_SV39 << SATP_MODE_SHIFT) | ((pt_address >> PAGE_SHIFT) & PTE_PPN_MASK);
+}
 
 /**
  * @brief 获取VPN[level]
@@ -162,6 +174,10 @@ static inline Page *__attribute__((warn_unused_result)) Pte2Page(pte_t pte)
 void vmm_init(void);
 void vm_enable(void);
 err_t pt_map(uint64_t pt_address, uint64_t va, uint64_t pa, uint64_t perm);
+void pt_unmap(uint64_t pt_address, uint64_t va);
+err_t pt_user_addr(uint64_t pt_address, uint64_t va, uint64_t perm, uint64_t *pa);
+err_t copyin(uint64_t pt_address, void *dst, uint64_t srcva, uint64_t len);
+err_t copyout(uint64_t pt_address, uint64_t dstva, const void *src, uint64_t len);
 /* data*/
 extern uint64_t kernel_root_pte_pa;
 extern uint64_t kernel_root_pte_va;
@@ -0,0 +1,24 @@
+#ifndef __PROCESS_FUTEX__H__
+#define __PROCESS_FUTEX__H__
+
+#include "common/types.h"
+
+/**
+ * 快速用户态互斥(futex)
+ * 1.以futex字所在的物理地址作为等待通道，不同进程映射同一物理页时可以互相唤醒
+ * 2.按物理地址散列到固定数量的锁：FUTEX_WAIT在锁内比较值并进入睡眠，FUTEX_WAKE在锁内唤醒，不会丢失唤醒
+ */
+
+#define FUTEX_WAIT (0)
+#define FUTEX_WAKE (1)
+#define FUTEX_PRIVATE_FLAG (128) /* 进程私有(忽略，按物理地址处理)*/
+#define FUTEX_CMD_MASK (~FUTEX_PRIVATE_FLAG)
+
+#define FUTEX_HASH_BITS (6)
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+/* functions*/
+void futex_init(void);
+err_t futex_wait(uint64_t pt_address, uint64_t uaddr, uint32_t val, uint64_t wakeus);
+int64_t futex_wake(uint64_t pt_address, uint64_t uaddr, uint64_t nr);
+#endif /* !__PROCESS_FUTEX__H__*/
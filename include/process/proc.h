@@ -6,6 +6,7 @@
 #include "lib/queue.h"
 #include "trap/trap.h"
 #include "lock/mutex.h"
+#include "signal/signal.h"
 #define MAX_PROC_NUM (128) /* 最大进程数量*/
 
 /**
@@ -50,6 +51,11 @@ typedef struct proc
     uintptr_t p_brk;          /* 进程的堆顶地址*/
     uintptr_t p_pt;           /* 进程页表根地址*/
     trapframe_t *p_trapframe; /* 用户态上下文指针*/
+    struct uring *p_uring;    /* 提交/完成队列(NULL表示未创建)*/
+    sigset_t p_sigpending;    /* 进程级待处理信号位图(与p_sigqueue同步，受sigevent_lock保护)*/
+    TAILQ_HEAD(struct sigevent) /* 拼接注释*/
+    p_sigqueue;               /* 进程级待处理信号队列(任意一个未屏蔽的线程处理)*/
+    sighand_t *p_sighand;     /* 信号动作表(NULL表示全部为默认动作且没有共享)*/
     err_t p_exitcode;         /* 进程退出码*/
     times_t p_times;          /* 进程运行时间(清零起始地址p_startzero_addr)*/
     // thread_fs_t p_fs_struct;  /* 文件系统相关字段*/
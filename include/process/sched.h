@@ -0,0 +1,137 @@
+#ifndef __PROCESS_SCHED__H__
+#define __PROCESS_SCHED__H__
+
+#include "common/types.h"
+#include "common/platform.h"
+#include "process/thread.h"
+#include "lock/mutex.h"
+#include "lib/queue.h"
+#include "dev/clocksource.h"
+
+/**
+ * 调度器
+ * 1.每个核心运行scheduler()循环，从运行队列取出线程并通过swtch切换过去
+ * 2.线程通过sched()切换回调度器，调用前必须只持有自己的td_lock且状态不是RUNNING
+ * 3.时钟中断统计运行时间，时间片耗尽时设置cpu_need_resched，在中断返回时抢占
+ *   只有一个可运行线程或核心空闲时不需要tick，由sched_next_event告知定时器
+ * 4.持有锁或处于RCU读临界区时不抢占
+ * 5.每个核心有独立的运行队列，唤醒时优先放回线程上次运行的核心，空闲核心从最忙的核心批量窃取
+ * 6.调度类按优先级排列(截止时间类 > 实时类 > 公平类)，高优先级调度类的就绪线程总是先运行
+ * 7.公平类按加权虚拟运行时间(vruntime)排序，总是运行vruntime最小的线程
+ * 8.截止时间类按绝对截止时间排序(EDF)，由恒定带宽服务器(CBS)限制每个周期的运行时间
+ * 9.修改调度策略、优先级或nice值时，在rq_lock下先从原调度类摘下线程，修改后再放入新调度类
+ */
+
+#define TD_TIME_SLICE (10)                                   /* SCHED_RR时间片长度(tick)：10ms*/
+#define SCHED_IMBALANCE (2)                                  /* 上次运行的核心比最空闲核心多出的负载上限*/
+#define SCHED_STEAL_BATCH (8)                                /* 单次最多窃取的线程数量*/
+#define SCHED_CACHE_HOT_CYCLES clocksource_us2cyc(5000)     /* 离开CPU不足5ms的线程视为缓存热*/
+
+/* 调度策略(与Linux编号一致)*/
+#define SCHED_NORMAL (0)   /* 普通线程*/
+#define SCHED_FIFO (1)     /* 实时线程：先进先出，不按时间片轮转*/
+#define SCHED_RR (2)       /* 实时线程：同优先级按时间片轮转*/
+#define SCHED_DEADLINE (6) /* 截止时间线程：每个周期内运行给定的预算*/
+
+/* 入队标志*/
+#define SCHED_ENQUEUE_WAKEUP (0x01)   /* 线程被唤醒(或新建)*/
+#define SCHED_ENQUEUE_MIGRATED (0x02) /* 线程从其他核心迁移过来*/
+
+#define RT_PRIO_LEVELS (64) /* 实时优先级数量：0最高，63最低*/
+#define NICE_MIN (-20)      /* 最高nice值*/
+#define NICE_MAX (19)       /* 最低nice值*/
+
+/**
+ * @brief 每个核心的运行队列(各调度类的数据都受rq_lock保护)
+ *
+ */
+typedef struct runq
+{
+    mutex_t rq_lock;                        /* 运行队列锁*/
+    uint64_t rq_cpu;                        /* 所属核心*/
+    uint64_t rq_nr;                         /* 就绪线程数量(不含正在运行的线程)*/
+    uint64_t rq_rt_bitmap;                  /* 非空实时优先级位图：优先级p对应第63-p位*/
+    TAILQ_HEAD(thread_t)                    /* 拼接注释*/
+    rq_rt_queue[RT_PRIO_LEVELS];            /* 每个实时优先级的就绪队列*/
+    rb_root_t rq_fair_root;                 /* 公平类红黑树(按vruntime排序)*/
+    uint64_t rq_fair_nr;                    /* 公平类就绪线程数量*/
+    uint64_t rq_fair_load;                  /* 公平类就绪线程的权重之和*/
+    uint64_t rq_min_vruntime;               /* 单调递增的最小vruntime*/
+    rb_root_t rq_dl_root;                   /* 截止时间类红黑树(按绝对截止时间排序)*/
+    TAILQ_HEAD(thread_t)                    /* 拼接注释*/
+    rq_dl_throttled;                        /* 预算耗尽、等待补充的截止时间线程*/
+} runq_t;
+
+/**
+ * @brief 调度类：所有操作都在持有rq_lock时调用
+ *
+ */
+typedef struct sched_class
+{
+    void (*sc_enqueue)(runq_t *rq, thread_t *td, uint32_t flags); /* 加入就绪队列*/
+    thread_t *(*sc_pick)(runq_t *rq);                             /* 取出下一个运行的线程*/
+    thread_t *(*sc_steal)(runq_t *rq, uint64_t cpu, bool cold);   /* 取出一个允许迁移到cpu的线程*/
+    bool (*sc_preempt)(thread_t *curr, thread_t *td);             /* 同类线程td是否应抢占curr*/
+    bool (*sc_tick)(runq_t *rq, thread_t *td);                    /* 时钟中断，返回是否需要重新调度*/
+    void (*sc_update)(runq_t *rq, thread_t *td, uint64_t delta);  /* 统计运行时间(可以为NULL)*/
+    void (*sc_dequeue)(runq_t *rq, thread_t *td);                 /* 从就绪队列中移除指定线程*/
+    void (*sc_detach)(runq_t *rq, thread_t *td);                  /* 正在运行的线程进入睡眠或离开本调度类(可以为NULL)*/
+    void (*sc_attach)(runq_t *rq, thread_t *td);                  /* 正在运行的线程切换到本调度类(可以为NULL)*/
+    bool (*sc_ready)(runq_t *rq);                                 /* 是否有可以立即运行的线程*/
+    bool (*sc_timer)(runq_t *rq, uint64_t now);                   /* 每个tick调用(可以为NULL)，返回是否需要重新调度*/
+    uint64_t (*sc_next_event)(runq_t *rq, thread_t *curr, uint64_t now); /* 下一次需要定时器的时间(可以为NULL)*/
+} sched_class_t;
+
+/**
+ * @brief 修改调度参数期间的线程状态(sched_change_begin/sched_change_end之间持有sch_rq的rq_lock)
+ *
+ */
+typedef struct
+{
+    runq_t *sch_rq;  /* 锁住的运行队列(NULL表示线程不在队列中也不在运行，不需要加锁)*/
+    bool sch_queued; /* 修改前在就绪队列中，已经从原调度类摘下*/
+    bool sch_curr;   /* 正在运行或已被选中即将运行*/
+} sched_change_t;
+
+/**
+ * @brief 线程离开CPU的时间是否足够长(缓存已经变冷)
+ *
+ * @param td
+ * @param now
+ * @return bool
+ */
+static inline bool sched_cache_cold(thread_t *td, uint64_t now)
+{
+    return now - td->td_lastran >= SCHED_CACHE_HOT_CYCLES;
+}
+
+/* functions*/
+void sched_init(void);
+void swtch(context_t *old, context_t *new);
+void scheduler(void) __attribute__((noreturn));
+void sched(void);
+void yield(void);
+void setrunnable(thread_t *td);
+void sleep(void *chan, mutex_t *mtx, const char *msg);
+void wakeup(void *chan);
+uint64_t wakeup_n(void *chan, uint64_t nr);
+bool wakeup_thread(thread_t *td, void *chan);
+void sched_tick(void);
+void sched_preempt(void);
+uint64_t sched_next_event(uint64_t now);
+void sched_kick(thread_t *td);
+err_t sched_setaffinity(thread_t *td, uint64_t mask);
+void sched_affinity_test(void);
+err_t sched_setscheduler(thread_t *td, int32_t policy, int32_t prio);
+err_t sched_setnice(thread_t *td, int32_t nice);
+void sched_change_begin(thread_t *td, sched_change_t *sch);
+void sched_change_end(thread_t *td, sched_change_t *sch);
+err_t sched_set_min_granularity(uint64_t us);
+err_t sched_setattr_deadline(thread_t *td, uint64_t runtime_us, uint64_t deadline_us, uint64_t period_us);
+void sched_dl_init(void);
+void sched_dl_release(thread_t *td);
+/* data*/
+extern const sched_class_t dl_sched_class;
+extern const sched_class_t rt_sched_class;
+extern const sched_class_t fair_sched_class;
+#endif /* !__PROCESS_SCHED__H__*/
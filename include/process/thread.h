@@ -2,8 +2,10 @@
 #define __PROCESS_THREAD__H__
 
 #include "common/types.h"
+#include "common/atomic.h"
 #include "lib/list.h"
 #include "lib/queue.h"
+#include "lib/rbtree.h"
 #include "process/proc.h"
 #include "lock/mutex.h"
 #include "signal/signal.h"
@@ -25,7 +27,7 @@ typedef struct thread
 	TAILQ_ENTRY(struct thread)		   /* 拼接注释*/
 	td_runq;						   /* 运行队列entry*/
 	TAILQ_ENTRY(struct thread)		   /* 拼接注释*/
-	td_sleepq;						   /* 睡眠队列entry*/
+	td_sleepq;						   /* 睡眠队列(等待通道哈希桶)entry*/
 	TAILQ_ENTRY(struct thread)		   /* 拼接注释*/
 	td_freeq;						   /* 空闲队列entry*/
 	tid_t td_tid;					   /* 线程id*/
@@ -33,15 +35,37 @@ typedef struct thread
 	char td_name[MAX_THREAD_NAME_LEN]; /* 线程名(清零属性区域开始t_startzero_addr)*/
 	uintptr_t td_wchan;				   /* 线程睡眠等待的地址*/
 	const char *td_wmesg;			   /* 线程睡眠等待的原因*/
+	uint64_t td_slice;				   /* 线程剩余的时间片(tick)*/
+	uint64_t td_lastcpu;			   /* 线程最近一次运行(或已被选中即将运行)的核心*/
+	struct runq *td_rq;				   /* 所在的运行队列(NULL表示不在队列中，受该队列的rq_lock保护)*/
+	uint64_t td_lastran;			   /* 线程最近一次离开CPU的时间(rdtime)*/
+	uint64_t td_nswitch;			   /* 线程被切换出CPU的次数*/
+	uint64_t td_affinity;			   /* 允许运行的核心位图*/
+	int32_t td_policy;				   /* 调度策略*/
+	int32_t td_prio;				   /* 实时优先级(0最高)*/
+	int32_t td_nice;				   /* 普通线程的nice值*/
+	uint64_t td_vruntime;			   /* 加权虚拟运行时间(公平调度类)*/
+	uint64_t td_weight;				   /* 入队时的权重*/
+	uint64_t td_sum_exec;			   /* 累计运行时间(rdtime)*/
+	uint64_t td_prev_sum_exec;		   /* 本次被调度时的累计运行时间*/
+	rb_node_t td_rbnode;			   /* 公平/截止时间调度类红黑树节点*/
+	uint64_t td_dl_runtime;			   /* 截止时间调度类：每个周期的运行时间预算(rdtime)*/
+	uint64_t td_dl_deadline;		   /* 截止时间调度类：相对截止时间(rdtime)*/
+	uint64_t td_dl_period;			   /* 截止时间调度类：周期(rdtime)*/
+	uint64_t td_dl_abs_deadline;	   /* 截止时间调度类：当前绝对截止时间(rdtime)*/
+	int64_t td_dl_remaining;		   /* 截止时间调度类：当前周期剩余预算*/
+	uint8_t td_dl_throttled;		   /* 截止时间调度类：预算耗尽，等待补充*/
 	err_t td_exitcode;				   /* 线程退出码*/
 	sigevent_t *td_sig;				   /* 线程当前正在处理的信号*/
 	trapframe_t td_trapframe;		   /* 用户态上下文*/
-	ktrapframe_t td_kcontext;		   /* 内核态上下文*/
+	context_t td_kcontext;			   /* 内核态上下文*/
 	uint8_t td_killed;				   /* 线程是否被杀死*/
 	sigset_t td_cursigmask;			   /* 线程正在处理的信号屏蔽字*/
+	sigset_t td_sigpending;			   /* 待处理信号位图(与td_sigqueue同步，受sigevent_lock保护)*/
+	uint32_t td_sigsummary;			   /* 有未屏蔽的待处理信号(线程级或进程级，受sigevent_lock保护写入)*/
 	uint64_t td_ctid;				   /* 清空tid地址标识*/
 	uint64_t td_utstamp;			   /* 用户态线程时间戳*/
-	uint64_t td_ststamp;			   /* 内核态线程时间戳*/
+	uint64_t td_ststamp;			   /* 内核态线程时间戳(运行时间统计起点)*/
 	sigset_t td_sigmask;			   /* 线程信号屏蔽字(t_startcopy_addr)*/
 	uintptr_t td_kstack;			   /* 内核栈所在页的首地址(t_endzero/copy_addr)*/
 	TAILQ_HEAD(struct sigevent)		   /* 拼接注释*/
@@ -56,10 +80,43 @@ typedef struct
 {
 	TAILQ_HEAD(thread_t) /* 拼接注释*/
 	tq_head;			 /* 线程队列*/
+	mutex_t tq_lock;	 /* 队列锁*/
 } threadq_t;
 
+/* 等待通道哈希表：按chan散列到固定数量的桶，每个桶一把锁，wakeup只遍历同一个桶*/
+#define SLEEPQ_HASH_BITS (7)
+#define SLEEPQ_HASH_SIZE (1 << SLEEPQ_HASH_BITS)
+
 /* functions*/
 void thread_init(void);
+thread_t *thread_alloc(void);
+void thread_free(thread_t *td);
+thread_t *kthread_alloc(void (*fn)(void *), void *arg, const char *name);
+thread_t *kthread_create(void (*fn)(void *), void *arg, const char *name);
+void kthread_exit(err_t exitcode) __attribute__((noreturn));
 /* data*/
 extern thread_t *threads;
+extern threadq_t thread_sleepqs[SLEEPQ_HASH_SIZE];
+
+/**
+ * @brief 查找等待通道所在的睡眠队列(Fibonacci散列，地址低位的对齐零不影响分布)
+ *
+ * @param chan
+ * @return threadq_t*
+ */
+static inline threadq_t *sleepq_lookup(uintptr_t chan)
+{
+	return &thread_sleepqs[(chan * 0x9E3779B97F4A7C15ul) >> (64 - SLEEPQ_HASH_BITS)];
+}
+/**
+ * @brief 是否有未屏蔽的待处理信号(线程级或进程级)，不加锁读取，只用于返回用户态前的快速判断
+ *        只测试一个汇总字：待处理位图或屏蔽字变化时由signal_recalc_pending更新
+ *
+ * @param td
+ * @return bool
+ */
+static inline bool signal_pending(thread_t *td)
+{
+	return READ_ONCE(td->td_sigsummary) != 0;
+}
 #endif /* !__PROCESS_THREAD__H__*/
\ No newline at end of file
@@ -3,32 +3,60 @@
 
 #include "common/types.h"
 #include "process/thread.h"
+#include "lock/mutex.h"
+#include "lib/queue.h"
 
-#define MAX_SLEEP_EVENT_NUM 128 /* 线程睡眠事件数量*/
+/**
+ * 带超时的睡眠(分层时间轮)
+ * 1.每个核心一个时间轮，超时事件挂入当前核心的时间轮，插入和取消都是O(1)
+ * 2.时间轮分为TW_LEVELS层，每层TW_SLOTS个槽；第k层每个槽覆盖64^k个jiffy
+ *   到期时间越远，挂入的层越高，当低层转完一圈时把高层对应槽的事件重新分配到低层(级联)
+ * 3.超时事件按松弛量(slack)向粗粒度边界取整，相近的超时在同一个jiffy一起触发
+ * 4.定时器只编程到时间轮下一个非空槽的时间，空闲时不需要tick
+ */
+
+#define TW_LEVEL_BITS (6)                   /* 每层槽数的位数*/
+#define TW_SLOTS (1ul << TW_LEVEL_BITS)     /* 每层槽数：64*/
+#define TW_SLOT_MASK (TW_SLOTS - 1)         /* 槽索引掩码*/
+#define TW_LEVELS (4)                       /* 层数：覆盖64^4个jiffy(约4.6小时)*/
+#define TW_MAX_DELTA ((1ul << (TW_LEVEL_BITS * TW_LEVELS)) - 1) /* 时间轮能直接表示的最大间隔*/
+#define TSLEEP_SLACK_SHIFT (8)              /* 默认松弛量：超时时长的1/256*/
 
 /**
- * @brief 线程睡眠事件结构
+ * @brief 线程睡眠超时事件(由tsleep在睡眠线程的栈上分配)
  *
  */
 typedef struct tsleepevent
 {
-    thread_t *tse_td;               /* 关联的线程对象*/
-    void *tse_waitch;               /* 等待的通道标识(如锁/信号量)*/
-    uint64_t tse_wakeus;            /* 预定唤醒时间戳(微秒)*/
     TAILQ_ENTRY(struct tsleepevent) /* 拼接注释*/
-    tse_freeq;                      /* 空闲队列链接*/
-    TAILQ_ENTRY(struct tsleepevent) /* 拼接注释*/
-    tse_usedq;                      /* 使用队列链接*/
+    tse_link;                       /* 时间轮槽链接*/
+    uint64_t tse_expires;           /* 到期时间(jiffy)*/
+    struct twheel *tse_wheel;       /* 所在的时间轮(NULL表示未挂入)*/
+    uint16_t tse_index;             /* 所在的槽：层 * TW_SLOTS + 槽*/
+    bool tse_fired;                 /* 是否因超时唤醒了线程*/
+    thread_t *tse_td;               /* 关联的线程对象*/
+    void *tse_waitch;               /* 等待的通道标识*/
 } tsevent_t;
 
 /**
- * @brief 线程睡眠事件队列类型
+ * @brief 每个核心的分层时间轮(受tw_lock保护)
  *
  */
-typedef struct
+typedef struct twheel
 {
-    TAILQ_HEAD(tsevent_t) /* 拼接注释*/
-    tq_head;              /* 线程睡眠事件队列*/
-    mutex_t tq_lock;      /* 互斥锁(是否需要)*/
-} tseventq_t;
-#endif /* !__PROCESS_TSLEEP__H__*/
\ No newline at end of file
+    mutex_t tw_lock;                       /* 时间轮锁*/
+    uint64_t tw_clk;                       /* 下一个待处理的jiffy(之前的事件都已触发)*/
+    uint64_t tw_count;                     /* 挂入的事件数量*/
+    uint64_t tw_next;                      /* 下一个需要处理的jiffy(缓存，可能偏早)*/
+    uint64_t tw_pending[TW_LEVELS];        /* 每层非空槽位图*/
+    TAILQ_HEAD(tsevent_t)                  /* 拼接注释*/
+    tw_slots[TW_LEVELS][TW_SLOTS];         /* 槽链表*/
+} twheel_t;
+
+/* functions*/
+void tsleep_init(void);
+err_t tsleep(void *chan, mutex_t *mtx, const char *msg, uint64_t wakeus);
+err_t tsleep_slack(void *chan, mutex_t *mtx, const char *msg, uint64_t wakeus, uint64_t slackus);
+void tsleep_check(void);
+uint64_t tsleep_next_event(void);
+#endif /* !__PROCESS_TSLEEP__H__*/
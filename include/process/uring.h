@@ -0,0 +1,108 @@
+#ifndef __PROCESS_URING__H__
+#define __PROCESS_URING__H__
+
+#include "common/types.h"
+
+/**
+ * 提交/完成队列(类似io_uring)
+ * 1.每个进程一组队列，三个物理页同时映射到用户空间URING_VMA和内核(直接访问物理地址)：
+ *   头部页(队列下标)、提交队列页(uring_sqe_t数组)、完成队列页(uring_cqe_t数组)
+ * 2.用户填写sqes[sq_tail & mask]后递增sq_tail；内核消费后递增sq_head
+ *   内核填写cqes[cq_tail & mask]后递增cq_tail；用户读取后递增cq_head
+ * 3.一次io_uring_enter可以消费多个提交，并可以等待指定数量的完成
+ * 4.URING_SETUP_SQPOLL：内核线程轮询提交队列，用户提交不需要陷入内核
+ *   空闲超过sq_thread_idle后内核线程睡眠并设置URING_SQ_NEED_WAKEUP，用户通过io_uring_enter(URING_ENTER_SQ_WAKEUP)唤醒
+ */
+
+#define URING_SQ_ENTRIES (64)  /* 提交队列长度(一页)*/
+#define URING_CQ_ENTRIES (128) /* 完成队列长度*/
+
+#define URING_TIMEOUT_POOL (64) /* 所有队列共享的超时事件数量*/
+
+/* 操作码*/
+#define URING_OP_NOP (0)        /* 空操作*/
+#define URING_OP_READ (1)       /* 读：fd、addr、len*/
+#define URING_OP_WRITE (2)      /* 写：fd、addr、len*/
+#define URING_OP_FUTEX_WAKE (3) /* 唤醒：addr为futex字地址，len为最多唤醒的线程数*/
+#define URING_OP_TIMEOUT (4)    /* 超时：addr为相对时间(timespec)，到期时完成，结果为-ETIME*/
+
+/* io_uring_setup标志*/
+#define URING_SETUP_SQPOLL (1u << 1)
+
+/* 头部sq_flags(内核写)*/
+#define URING_SQ_NEED_WAKEUP (1u << 0)
+
+/* io_uring_enter标志*/
+#define URING_ENTER_GETEVENTS (1u << 0)
+#define URING_ENTER_SQ_WAKEUP (1u << 1)
+
+#define URING_SQ_IDLE_DEFAULT_MS (1000) /* 轮询线程默认空闲时间*/
+
+/**
+ * @brief 提交项(64字节，一页64项)
+ *
+ */
+typedef struct
+{
+    uint8_t opcode;     /* 操作码*/
+    uint8_t flags;      /* 保留*/
+    uint16_t ioprio;    /* 保留*/
+    int32_t fd;         /* 文件描述符*/
+    uint64_t off;       /* 保留*/
+    uint64_t addr;      /* 用户缓冲区/futex字/timespec地址*/
+    uint32_t len;       /* 长度/唤醒数量*/
+    uint32_t op_flags;  /* 保留*/
+    uint64_t user_data; /* 原样返回到完成项*/
+    uint64_t pad[3];
+} uring_sqe_t;
+
+/**
+ * @brief 完成项
+ *
+ */
+typedef struct
+{
+    uint64_t user_data; /* 提交项的user_data*/
+    int32_t res;        /* 结果(负值为-errno)*/
+    uint32_t flags;     /* 保留*/
+} uring_cqe_t;
+
+/**
+ * @brief 队列头部(用户与内核共享)
+ *
+ */
+typedef struct
+{
+    uint32_t sq_head;     /* 内核写：已消费的提交数*/
+    uint32_t sq_tail;     /* 用户写：已提交的提交数*/
+    uint32_t sq_mask;     /* URING_SQ_ENTRIES - 1*/
+    uint32_t sq_flags;    /* 内核写：URING_SQ_NEED_WAKEUP*/
+    uint32_t sq_dropped;  /* 内核写：非法提交项数量*/
+    uint32_t cq_head;     /* 用户写：已读取的完成数*/
+    uint32_t cq_tail;     /* 内核写：已产生的完成数*/
+    uint32_t cq_mask;     /* URING_CQ_ENTRIES - 1*/
+    uint32_t cq_overflow; /* 内核写：完成队列满时丢弃的完成数*/
+} uring_hdr_t;
+
+/**
+ * @brief io_uring_setup参数
+ *
+ */
+typedef struct
+{
+    uint32_t flags;          /* URING_SETUP_*/
+    uint32_t sq_thread_idle; /* 轮询线程空闲多久后睡眠(毫秒)，0为默认值*/
+    uint32_t sq_entries;     /* 返回：提交队列长度*/
+    uint32_t cq_entries;     /* 返回：完成队列长度*/
+    uint64_t hdr_addr;       /* 返回：头部用户地址*/
+    uint64_t sqes_addr;      /* 返回：提交队列用户地址*/
+    uint64_t cqes_addr;      /* 返回：完成队列用户地址*/
+} uring_params_t;
+
+struct proc;
+
+/* functions*/
+void uring_init(void);
+int64_t uring_setup(struct proc *p, uint64_t uparams);
+int64_t uring_enter(struct proc *p, uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+#endif /* !__PROCESS_URING__H__*/
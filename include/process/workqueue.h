@@ -0,0 +1,57 @@
+#ifndef __PROCESS_WORKQUEUE__H__
+#define __PROCESS_WORKQUEUE__H__
+
+#include "common/types.h"
+#include "common/platform.h"
+#include "lock/mutex.h"
+
+/**
+ * 每个核心的工作队列(中断延迟处理的第二级)
+ * 1.每个核心一个kworker内核线程，在线程上下文中执行工作项，可以睡眠、可以被抢占
+ * 2.入队无锁：多个生产者(任意核心、中断上下文)用CAS压入单链表，kworker一次取走整条链表再反转为FIFO顺序
+ * 3.只有kworker空闲睡眠时入队才需要加锁唤醒，中断中入队的开销是一次CAS
+ * 4.同一个工作项在执行前只会排队一次(wk_pending)，执行时已清除，回调中可以重新入队
+ */
+
+/**
+ * @brief 工作项
+ *
+ */
+typedef struct work
+{
+    struct work *wk_next;            /* 队列链接*/
+    void (*wk_func)(struct work *);  /* 回调(线程上下文)*/
+    uint32_t wk_pending;             /* 已入队、尚未开始执行*/
+} work_t;
+
+/**
+ * @brief 每个核心的工作队列
+ *
+ */
+typedef struct
+{
+    work_t *wq_head;          /* 待执行的工作项(后进先出，无锁压入)*/
+    uint32_t wq_idle;         /* kworker正在睡眠或即将睡眠(受wq_lock保护写入)*/
+    mutex_t wq_lock;          /* kworker睡眠/唤醒的握手锁*/
+    struct thread *wq_worker; /* kworker线程*/
+} workqueue_t;
+
+/**
+ * @brief 初始化工作项
+ *
+ * @param wk
+ * @param func
+ */
+static inline void work_init(work_t *wk, void (*func)(work_t *))
+{
+    wk->wk_next = NULL;
+    wk->wk_func = func;
+    wk->wk_pending = 0;
+}
+
+/* functions*/
+void workqueue_init(void);
+void workqueue_cpu_online(uint64_t cpu);
+bool queue_work_on(uint64_t cpu, work_t *wk);
+bool queue_work(work_t *wk);
+#endif /* !__PROCESS_WORKQUEUE__H__*/
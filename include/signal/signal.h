@@ -2,11 +2,15 @@
 #define __SIGNAL_SIGNAL__H__
 
 #include "common/types.h"
+#include "common/bitops.h"
 #include "trap/trap.h"
 #include "lib/queue.h"
 
-#define MAX_SIGNAL_NUM 128   /* 支持的最大信号数量*/
-#define MAX_SIGEVENT_NUM 256 /* 支持的最大信号事件数*/
+#define MAX_SIGNAL_NUM 128      /* 支持的最大信号数量*/
+#define MAX_SIGEVENT_NUM 256    /* 启动时预分配的信号事件数(不够时按页扩充)*/
+#define SIGEVENT_MAX_PAGES 256  /* 信号事件最多扩充的物理页数*/
+#define SIGEVENT_CACHE_MAX 32   /* 每个核心缓存的空闲信号事件上限*/
+#define SIGEVENT_CACHE_BATCH 16 /* 缓存与全局空闲栈之间每次搬运的数量*/
 
 typedef union
 {
@@ -14,14 +18,16 @@ typedef union
     void *si_ptr;
 } sigval_t;
 
+#define SIGSET_WORD_BITS 64                                                       /* 每个字的位数*/
+#define SIGSET_WORDS ((MAX_SIGNAL_NUM + SIGSET_WORD_BITS - 1) / SIGSET_WORD_BITS) /* 信号集合的字数*/
+
 /**
  * @brief 信号集合
- *
+ *        信号signo(从1开始)对应第(signo - 1)位，按64位字整体运算
  */
 typedef struct
 {
-    /* +7表示向上取整，避免信号位数截断*/
-    uint8_t ss_byte[(MAX_SIGNAL_NUM + 7) / 8]; /* 字节数组，每个位表示一个信号*/
+    uint64_t ss_word[SIGSET_WORDS]; /* 每个位表示一个信号*/
 } sigset_t;
 /**
  * @brief 信号结构体(Linux2.6兼容:gibc)
@@ -67,18 +73,9 @@ typedef struct sigevent
     uint64_t se_uuctx;           /* 用户态上下文*/
     TAILQ_ENTRY(struct sigevent) /* 拼接注释*/
     se_link;                     /* 内核管理的信号事件队列成员*/
+    struct sigevent *se_free;    /* 空闲链表(每个核心的缓存或全局无锁栈)*/
 } sigevent_t;
 
-/**
- * @brief 信号队列类型定义
- *
- */
-typedef struct
-{
-    TAILQ_HEAD(sigevent_t) /* 拼接注释*/
-    tq_head;               /* 信号事件队列*/
-} sigeventq_t;
-
 /**
  * @brief 引用自musl的k_sigaction结构体
  *        声明信号动作
@@ -92,19 +89,165 @@ typedef struct
     sigset_t sa_mask;
 } sigaction_t;
 
+#define SIGHAND_CHUNK_SIGNALS SIGSET_WORD_BITS                                                /* 每个动作页容纳的信号数*/
+#define SIGHAND_CHUNKS ((MAX_SIGNAL_NUM + SIGHAND_CHUNK_SIGNALS - 1) / SIGHAND_CHUNK_SIGNALS) /* 动作页数量*/
+
 /**
- * @brief 信号动作集合(每个线程对应一组动作集合)
- * 
+ * @brief 信号动作表(按进程共享，POSIX规定信号动作属于进程)
+ *        1.同一进程的所有线程通过td_proc共享，CLONE_SIGHAND创建的子进程增加引用计数共享同一张表
+ *        2.按需分配：进程没有设置过信号动作且没有共享时p_sighand为NULL，表示全部为默认动作；
+ *          CLONE_SIGHAND共享时立即分配表头(sighand_get)，保证双方指向同一张表
+ *        3.动作页按需分配：只有设置了非默认动作的信号所在的页才分配物理页，NULL页表示整页都是默认动作
+ *        4.fork时复制(sighand_copy)，最后一个引用释放时回收
  */
-typedef struct
+typedef struct sighand
 {
-    sigaction_t handler[MAX_SIGNAL_NUM];
-} sighandler_set_t;
+    uint32_t sh_refcnt;                     /* 引用计数(原子操作)*/
+    sigaction_t *sh_action[SIGHAND_CHUNKS]; /* 动作页(受sighand_lock保护)*/
+    struct sighand *sh_next;                /* 空闲链表(受sighand_lock保护)*/
+} sighand_t;
 
 
+/**
+ * @brief 清空信号集合
+ *
+ * @param set
+ */
+static inline void sigemptyset(sigset_t *set)
+{
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        set->ss_word[i] = 0;
+    }
+}
+/**
+ * @brief 信号集合置满
+ *
+ * @param set
+ */
+static inline void sigfillset(sigset_t *set)
+{
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        set->ss_word[i] = ~0ul;
+    }
+}
+/**
+ * @brief 加入信号
+ *
+ * @param set
+ * @param signo 1~MAX_SIGNAL_NUM
+ */
+static inline void sigaddset(sigset_t *set, int32_t signo)
+{
+    uint32_t bit = signo - 1;
+    set->ss_word[bit / SIGSET_WORD_BITS] |= 1ul << (bit % SIGSET_WORD_BITS);
+}
+/**
+ * @brief 移除信号
+ *
+ * @param set
+ * @param signo 1~MAX_SIGNAL_NUM
+ */
+static inline void sigdelset(sigset_t *set, int32_t signo)
+{
+    uint32_t bit = signo - 1;
+    set->ss_word[bit / SIGSET_WORD_BITS] &= ~(1ul << (bit % SIGSET_WORD_BITS));
+}
+/**
+ * @brief 判断信号是否在集合中
+ *
+ * @param set
+ * @param signo 1~MAX_SIGNAL_NUM
+ * @return bool
+ */
+static inline bool sigismember(const sigset_t *set, int32_t signo)
+{
+    uint32_t bit = signo - 1;
+    return (set->ss_word[bit / SIGSET_WORD_BITS] >> (bit % SIGSET_WORD_BITS)) & 1;
+}
+/**
+ * @brief 判断信号集合是否为空
+ *
+ * @param set
+ * @return bool
+ */
+static inline bool sigisemptyset(const sigset_t *set)
+{
+    uint64_t any = 0;
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        any |= set->ss_word[i];
+    }
+    return any == 0;
+}
+/**
+ * @brief dst = a | b
+ *
+ */
+static inline void sigorsets(sigset_t *dst, const sigset_t *a, const sigset_t *b)
+{
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        dst->ss_word[i] = a->ss_word[i] | b->ss_word[i];
+    }
+}
+/**
+ * @brief dst = a & b
+ *
+ */
+static inline void sigandsets(sigset_t *dst, const sigset_t *a, const sigset_t *b)
+{
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        dst->ss_word[i] = a->ss_word[i] & b->ss_word[i];
+    }
+}
+/**
+ * @brief dst = a & ~b
+ *
+ */
+static inline void sigandnsets(sigset_t *dst, const sigset_t *a, const sigset_t *b)
+{
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        dst->ss_word[i] = a->ss_word[i] & ~b->ss_word[i];
+    }
+}
+/**
+ * @brief 集合中编号最小的信号
+ *
+ * @param set
+ * @return int32_t 集合为空时返回0
+ */
+static inline int32_t sigfirst(const sigset_t *set)
+{
+    for (int i = 0; i < SIGSET_WORDS; i++)
+    {
+        if (set->ss_word[i])
+        {
+            return i * SIGSET_WORD_BITS + ctz64(set->ss_word[i]) + 1;
+        }
+    }
+    return 0;
+}
+
 /* data*/
 extern sigevent_t *sigevents;
-extern sighandler_set_t *sigactions;
+struct thread;
+struct proc;
+
 /* functions*/
 void signal_init(void);
+err_t signal_send_thread(struct thread *td, int32_t signo, int32_t status);
+err_t signal_send_proc(struct proc *p, int32_t signo, int32_t status);
+sigevent_t *signal_dequeue(struct thread *td);
+void signal_recalc_pending(struct thread *td);
+void sigevent_free(sigevent_t *se);
+sighand_t *sighand_alloc(void);
+sighand_t *sighand_get(struct proc *p);
+err_t sighand_copy(struct proc *p, sighand_t **new);
+void sighand_put(sighand_t *sh);
+err_t sigaction_get(struct proc *p, int32_t signo, sigaction_t *act);
+err_t sigaction_set(struct proc *p, int32_t signo, const sigaction_t *act, sigaction_t *oact);
 #endif /* !__SIGNAL_SIGNAL__H__*/
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef __TRAP_SOFTIRQ__H__
+#define __TRAP_SOFTIRQ__H__
+
+#include "common/types.h"
+
+/**
+ * 软中断(中断延迟处理的第一级)
+ * 1.硬中断处理函数只做必要的设备操作，调用raise_softirq标记本核心的待处理位图后立即返回
+ * 2.中断返回前(回到线程栈、可以开中断)按位执行软中断，执行期间开中断，不能睡眠，不会被抢占
+ * 3.一次最多执行SOFTIRQ_BUDGET_US或SOFTIRQ_MAX_RESTART轮，剩余的交给本核心的kworker，避免中断风暴饿死线程
+ */
+
+/* 软中断编号(数值越小越先执行)*/
+#define SOFTIRQ_HRTIMER (0) /* 已到期的SOFT定时器回调*/
+#define SOFTIRQ_BLOCK (1)   /* 块设备完成处理*/
+#define SOFTIRQ_NR (2)
+
+#define SOFTIRQ_BUDGET_US (2000) /* 一次中断返回最多处理软中断的时间*/
+#define SOFTIRQ_MAX_RESTART (10) /* 一次中断返回最多重新检查的轮数*/
+
+/* functions*/
+void softirq_init(void);
+void open_softirq(uint32_t nr, void (*action)(void));
+void raise_softirq(uint32_t nr);
+void do_softirq(void);
+#endif /* !__TRAP_SOFTIRQ__H__*/
@@ -0,0 +1,59 @@
+#ifndef __TRAP_SYSCALL__H__
+#define __TRAP_SYSCALL__H__
+
+#include "common/types.h"
+#include "common/platform.h"
+#include "trap/trap.h"
+
+/**
+ * 系统调用(Linux RISC-V ABI)
+ * 1.a7为系统调用号，a0~a5为参数，返回值写回a0(负值为-errno)
+ * 2.按调用号索引只读函数指针表分发，参数直接从trapframe_t中读取
+ * 3.每个核心分别统计每个系统调用的调用次数和耗时(rdtime)，统计时不需要加锁
+ */
+
+#define NR_SYSCALLS (512) /* 系统调用表大小*/
+
+/* 系统调用号(与Linux asm-generic/unistd.h一致)*/
+#define SYS_exit (93)
+#define SYS_exit_group (94)
+#define SYS_futex (98)
+#define SYS_nanosleep (101)
+#define SYS_clock_settime (112)
+#define SYS_clock_gettime (113)
+#define SYS_clock_getres (114)
+#define SYS_clock_nanosleep (115)
+#define SYS_sched_yield (124)
+#define SYS_rt_sigreturn (139)
+#define SYS_gettimeofday (169)
+#define SYS_getpid (172)
+#define SYS_getppid (173)
+#define SYS_gettid (178)
+#define SYS_io_uring_setup (425)
+#define SYS_io_uring_enter (426)
+
+/* JaeOS私有系统调用号(不与Linux冲突)*/
+#define SYS_trapstat (500) /* 读取中断/异常/系统调用统计(trap/trapstat.h)*/
+
+#define TIMER_ABSTIME (1) /* clock_nanosleep：绝对时间*/
+
+/**
+ * @brief 系统调用处理函数：参数从trapframe_t中读取，返回值写回a0
+ *
+ */
+typedef int64_t (*syscall_fn_t)(trapframe_t *tf);
+
+/**
+ * @brief 单个系统调用的统计
+ *
+ */
+typedef struct
+{
+    uint64_t ss_count;  /* 调用次数*/
+    uint64_t ss_cycles; /* 累计耗时(rdtime)*/
+} syscall_stat_t;
+
+/* functions*/
+void syscall_dispatch(trapframe_t *tf);
+void syscall_stat_read(uint64_t nr, syscall_stat_t *stat);
+#endif /* !__TRAP_SYSCALL__H__*/
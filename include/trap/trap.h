@@ -4,11 +4,10 @@
 
 /**
  * @brief 用户态中断上下文(寄存器帧)
- * 
+ *        字段偏移与trapframe.h中的OFFSET_*一致(trampoline.S按偏移访问)
  */
 typedef struct
 {
-	uint64_t kernel_sp;	   /* 内核的sp指针*/
 	uint64_t kernel_satp;  /* 内核页表*/
 	uint64_t trap_handler; /* 用户态异常处理函数*/
 	uint64_t epc;		   /* 用户epc*/
@@ -44,6 +43,7 @@ typedef struct
 	uint64_t t4;
 	uint64_t t5;
 	uint64_t t6;
+	uint64_t kernel_sp; /* 内核的sp指针*/
 	uint64_t ft0;
 	uint64_t ft1;
 	uint64_t ft2;
@@ -79,19 +79,15 @@ typedef struct
 } trapframe_t;
 /**
  * @brief 内核态中断上下文(寄存器帧)
- *        在发生异常或中断时，保存被中断代码的完整寄存器状态
+ *        只保存调用者保存(caller-saved)的寄存器和sepc/sstatus，字段偏移与trapframe.h中的KTF_*一致
+ *        被调用者保存的寄存器由C函数负责；tp保存hartid、gp为内核全局指针，均不需要保存
  */
 typedef struct
 {
 	uint64_t ra;
-	uint64_t sp;
-	uint64_t gp;
-	uint64_t tp;
 	uint64_t t0;
 	uint64_t t1;
 	uint64_t t2;
-	uint64_t s0;
-	uint64_t s1;
 	uint64_t a0;
 	uint64_t a1;
 	uint64_t a2;
@@ -100,6 +96,26 @@ typedef struct
 	uint64_t a5;
 	uint64_t a6;
 	uint64_t a7;
+	uint64_t t3;
+	uint64_t t4;
+	uint64_t t5;
+	uint64_t t6;
+	uint64_t epc;	  /* 被打断的pc(嵌套中断会覆盖sepc)*/
+	uint64_t sstatus; /* 被打断时的sstatus(SPP/SPIE)*/
+} ktrapframe_t;
+/**
+ * @brief 内核线程上下文(swtch切换时保存的寄存器)
+ *        只需要保存被调用者保存(callee-saved)的寄存器，字段偏移与trapframe.h中的CTX_*一致
+ *        tp在内核态保存hartid，线程可能在不同核心之间迁移，swtch不保存/恢复tp
+ */
+typedef struct
+{
+	uint64_t ra;
+	uint64_t sp;
+	uint64_t gp;
+	uint64_t tp;
+	uint64_t s0;
+	uint64_t s1;
 	uint64_t s2;
 	uint64_t s3;
 	uint64_t s4;
@@ -110,11 +126,14 @@ typedef struct
 	uint64_t s9;
 	uint64_t s10;
 	uint64_t s11;
-	uint64_t t3;
-	uint64_t t4;
-	uint64_t t5;
-	uint64_t t6;
-} ktrapframe_t;
+} context_t;
 void set_trap_handle(void);
+uint64_t kernel_trap(ktrapframe_t *ktf);
+uint64_t kernel_trap_timer(ktrapframe_t *ktf);
+uint64_t kernel_trap_ipi(ktrapframe_t *ktf);
+uint64_t kernel_trap_external(ktrapframe_t *ktf);
+void kernel_trap_tail(ktrapframe_t *ktf);
+void user_trap(void) __attribute__((noreturn));
+void user_trap_ret(void) __attribute__((noreturn));
 
 #endif /* !__TRAP_TRAP__H__*/
\ No newline at end of file
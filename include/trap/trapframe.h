@@ -88,4 +88,29 @@
 #define CTX_S10_OFF 112
 #define CTX_S11_OFF 120
 
+/* 内核态中断帧ktrapframe_t的偏移(只保存调用者保存寄存器和sepc/sstatus)*/
+#define KTF_RA 0
+#define KTF_T0 8
+#define KTF_T1 16
+#define KTF_T2 24
+#define KTF_A0 32
+#define KTF_A1 40
+#define KTF_A2 48
+#define KTF_A3 56
+#define KTF_A4 64
+#define KTF_A5 72
+#define KTF_A6 80
+#define KTF_A7 88
+#define KTF_T3 96
+#define KTF_T4 104
+#define KTF_T5 112
+#define KTF_T6 120
+#define KTF_EPC 128
+#define KTF_SSTATUS 136
+#define KTF_SIZE 144 /* 16字节对齐*/
+
+/* 每个核心的中断栈(大小为2的幂，ktrap_vector按hartid移位定位)*/
+#define IRQ_STACK_SHIFT 13
+#define IRQ_STACK_SIZE (1 << IRQ_STACK_SHIFT)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef __TRAP_TRAPSTAT__H__
+#define __TRAP_TRAPSTAT__H__
+
+#include "common/types.h"
+#include "common/bitops.h"
+#include "common/platform.h"
+#include "cpu/cpu.h"
+#include "dev/irq.h"
+
+/**
+ * 中断/异常统计
+ * 1.每个核心分别记录，只在关中断时由本核心修改，不需要加锁
+ * 2.时间单位为rdtime周期，按log2分桶：th_hist[0]为0，th_hist[i]为[2^(i-1), 2^i)，最后一个桶包含更大的值
+ * 3.定时器：实际进入处理函数的时间相对比较器编程值的延迟，以及处理函数耗时
+ * 4.核间中断、外部中断(按PLIC中断源ID)：处理函数耗时；异常：按scause编号计数
+ * 5.通过trapstat系统调用读取所有核心的汇总
+ */
+
+#define TRAPSTAT_BUCKETS (32)      /* 直方图桶数*/
+#define TRAPSTAT_EXCEPTION_NR (16) /* 统计的异常编号数量*/
+
+/* trapstat系统调用的统计项*/
+#define TRAPSTAT_TIMER_LATENESS (0) /* 定时器延迟，输出trapstat_hist_t*/
+#define TRAPSTAT_TIMER (1)          /* 定时器处理耗时，输出trapstat_hist_t*/
+#define TRAPSTAT_IPI (2)            /* 核间中断处理耗时，输出trapstat_hist_t*/
+#define TRAPSTAT_EXTERNAL (3)       /* 外部中断处理耗时(arg为PLIC中断源ID)，输出trapstat_hist_t*/
+#define TRAPSTAT_EXCEPTION (4)      /* 异常次数，输出uint64_t[TRAPSTAT_EXCEPTION_NR]*/
+#define TRAPSTAT_SYSCALL (5)        /* 系统调用统计(arg为系统调用号)，输出syscall_stat_t*/
+#define TRAPSTAT_LOCK (6)           /* 锁统计(arg为缓冲区能容纳的记录数)，按竞争次数降序输出lockstat_record_t[]，返回记录数；
+                                       未开启JAEOS_LOCKSTAT时返回-ENOSYS*/
+
+/**
+ * @brief log2直方图
+ *
+ */
+typedef struct
+{
+    uint64_t th_count;                  /* 样本数*/
+    uint64_t th_total;                  /* 累计值*/
+    uint64_t th_max;                    /* 最大值*/
+    uint64_t th_hist[TRAPSTAT_BUCKETS]; /* 分桶计数*/
+} trapstat_hist_t;
+
+/**
+ * @brief 每个核心的统计
+ *
+ */
+typedef struct
+{
+    trapstat_hist_t tc_timer_late;                /* 定时器延迟*/
+    trapstat_hist_t tc_timer;                     /* 定时器处理耗时*/
+    trapstat_hist_t tc_ipi;                       /* 核间中断处理耗时*/
+    trapstat_hist_t tc_external[IRQ_NUM];         /* 外部中断处理耗时*/
+    uint64_t tc_exception[TRAPSTAT_EXCEPTION_NR]; /* 异常次数*/
+} trapstat_cpu_t;
+
+/* data*/
+extern trapstat_cpu_t trapstat_cpus[NCPU];
+
+/**
+ * @brief 当前核心的统计(需关中断)
+ *
+ */
+#define trapstat_this (trapstat_cpus[cpuid()])
+
+/**
+ * @brief 记录一个样本(需关中断)
+ *
+ * @param th
+ * @param cycles
+ */
+static inline void trapstat_record(trapstat_hist_t *th, uint64_t cycles)
+{
+    uint64_t bucket = fls64(cycles);
+    th->th_hist[bucket < TRAPSTAT_BUCKETS ? bucket : TRAPSTAT_BUCKETS - 1]++;
+    th->th_count++;
+    th->th_total += cycles;
+    if (cycles > th->th_max)
+    {
+        th->th_max = cycles;
+    }
+}
+
+/* functions*/
+void trapstat_exception(uint64_t code);
+err_t trapstat_read(uint32_t which, uint32_t arg, trapstat_hist_t *th);
+void trapstat_read_exception(uint64_t *counts);
+void trapstat_dump(void);
+#endif /* !__TRAP_TRAPSTAT__H__*/
@@ -2,7 +2,17 @@
 #include "cpu/cpu.h"
 
 /**
- * @brief 当前cpu的结构体变量(仅支持hart0)
- * 
+ * @brief 每个核心对应的cpu结构体变量(通过cpu_this访问当前核心)
+ *
  */
-cpu_t cpu_this;
\ No newline at end of file
+cpu_t cpus[NCPU];
+/**
+ * @brief 已上线核心的位图(bit i表示hart i)
+ *
+ */
+uint64_t cpu_online_mask;
+/**
+ * @brief 每个核心的中断栈(ktrap_vector在最外层中断时切换到这里，线程内核栈不需要为中断预留空间)
+ *
+ */
+uint8_t irq_stacks[NCPU][IRQ_STACK_SIZE] __attribute__((aligned(16)));
@@ -0,0 +1,400 @@
+#include "common/types.h"
+#include "common/rv64.h"
+#include "common/errno.h"
+#include "common/atomic.h"
+#include "cpu/cpu.h"
+#include "cpu/smp.h"
+#include "lib/llist.h"
+#include "lock/mutex.h"
+#include "mmu/mmu.h"
+#include "sbi/sbi.h"
+#include "lib/printf.h"
+#include "dev/timer.h"
+#include "trap/trapstat.h"
+
+/**
+ * 核间中断(IPI)
+ * 1.发送方将请求写入目标核心的数据结构，在ipi_pending中置位对应的IPI类型
+ *   只有ipi_pending由0变为非0时才真正发送IPI，同一核心上未处理的IPI会被合并
+ * 2.接收方先清除sip.SSIP，再原子地取走ipi_pending，保证不会丢失IPI
+ * 3.远程函数调用使用无锁链表作为每个核心的调用队列
+ * 4.发送方在关中断状态下同步等待时，会处理发往自己的请求，避免两个核心互相等待导致死锁
+ */
+
+/**
+ * @brief 每个核心的IPI数据
+ *
+ */
+typedef struct
+{
+    uint32_t ipi_pending;   /* 未处理的IPI类型位图*/
+    llist_head_t ipi_callq; /* 远程函数调用队列(无锁)*/
+    csd_t ipi_csd[NCPU];    /* 本核心发往各核心的异步调用描述符*/
+    mutex_t ipi_tlb_lock;   /* 保护TLB刷新请求*/
+    uint64_t ipi_tlb_start; /* 待刷新范围的起始地址*/
+    uint64_t ipi_tlb_end;   /* 待刷新范围的结束地址(0表示没有请求)*/
+    uint64_t ipi_tlb_gen;   /* 最新的TLB刷新请求代数*/
+    uint64_t ipi_tlb_done;  /* 已完成的TLB刷新请求代数*/
+} ipi_data_t;
+
+static ipi_data_t ipi_datas[NCPU];
+
+/**
+ * @brief 核间中断初始化
+ *
+ */
+void smp_init(void)
+{
+    for (int i = 0; i < NCPU; i++)
+    {
+        ipi_data_t *d = &ipi_datas[i];
+        d->ipi_pending = 0;
+        init_llist_head(&d->ipi_callq);
+        mutex_init(&d->ipi_tlb_lock, "ipi_tlb_lock", MUTEX_TYPE_SPIN);
+        d->ipi_tlb_start = 0;
+        d->ipi_tlb_end = 0;
+        d->ipi_tlb_gen = 0;
+        d->ipi_tlb_done = 0;
+    }
+}
+/**
+ * @brief 主核初始化完成后通过SBI HSM启动其余核心
+ *        从核从_start_secondary开始执行，上线后设置cpu_online_mask
+ */
+void smp_boot_secondary(void)
+{
+    extern char _start_secondary[];
+    for (uint64_t i = 0; i < NCPU; i++)
+    {
+        if (i == cpuid())
+        {
+            continue;
+        }
+        SBI_RET ret = sbi_hart_start(i, (uint64_t)_start_secondary, 0);
+        if (ret.error != SBI_SUCCESS)
+        {
+            printf("[JaeOS]Hart %ld Start Failed: %ld.\n", i, (int64_t)ret.error);
+        }
+    }
+}
+/**
+ * @brief 向目标核心发送IPI(合并未处理的IPI)
+ *
+ * @param cpu 目标核心
+ * @param type IPI类型
+ */
+static void ipi_send(uint64_t cpu, uint32_t type)
+{
+    if (__atomic_fetch_or(&ipi_datas[cpu].ipi_pending, type, __ATOMIC_ACQ_REL) == 0)
+    {
+        sbi_send_ipi(1ul << cpu, 0);
+    }
+}
+/**
+ * @brief 执行调用队列中的所有远程函数(按提交顺序)
+ *
+ * @param d
+ */
+static void ipi_run_callq(ipi_data_t *d)
+{
+    llist_node_t *node = llist_reverse_order(llist_del_all(&d->ipi_callq));
+    while (node != NULL)
+    {
+        csd_t *csd = llist_entry(node, csd_t, csd_node);
+        /* 解锁后csd可能被发送方复用，先取出所有字段*/
+        node = node->next;
+        smp_call_func_t func = csd->csd_func;
+        void *arg = csd->csd_arg;
+        if (csd->csd_flags & CSD_FLAG_WAIT)
+        {
+            /* 同步调用：执行完毕后通知发送方*/
+            func(arg);
+            __atomic_store_n(&csd->csd_flags, 0, __ATOMIC_RELEASE);
+        }
+        else
+        {
+            /* 异步调用：先释放csd*/
+            __atomic_store_n(&csd->csd_flags, 0, __ATOMIC_RELEASE);
+            func(arg);
+        }
+    }
+}
+/**
+ * @brief 处理TLB刷新请求
+ *
+ * @param d
+ */
+static void ipi_tlb_handler(ipi_data_t *d)
+{
+    mutex_lock(&d->ipi_tlb_lock);
+    uint64_t start = d->ipi_tlb_start;
+    uint64_t end = d->ipi_tlb_end;
+    uint64_t gen = d->ipi_tlb_gen;
+    d->ipi_tlb_end = 0;
+    mutex_unlock(&d->ipi_tlb_lock);
+
+    if (end == 0)
+    {
+        return;
+    }
+    if (end - start > TLB_SHOOTDOWN_MAX_PAGES * PAGE_SIZE)
+    {
+        sfence_vma_all();
+    }
+    else
+    {
+        for (uint64_t va = start; va < end; va += PAGE_SIZE)
+        {
+            sfence_vma(va);
+        }
+    }
+    __atomic_store_n(&d->ipi_tlb_done, gen, __ATOMIC_RELEASE);
+}
+/**
+ * @brief 处理本核心所有未处理的IPI
+ *
+ */
+static void ipi_handle_pending(void)
+{
+    ipi_data_t *d = &ipi_datas[cpuid()];
+    uint32_t pending = __atomic_exchange_n(&d->ipi_pending, 0, __ATOMIC_ACQUIRE);
+    if (pending & IPI_TLB_SHOOTDOWN)
+    {
+        ipi_tlb_handler(d);
+    }
+    if (pending & IPI_CALL_FUNC)
+    {
+        ipi_run_callq(d);
+    }
+    if (pending & IPI_RESCHEDULE)
+    {
+        /* 由中断返回路径(sched_preempt)完成调度*/
+        cpu_this.cpu_need_resched = 1;
+    }
+    if (pending & IPI_TICK)
+    {
+        timer_reprogram();
+    }
+}
+/**
+ * @brief 同步等待期间处理发往本核心的请求
+ *
+ */
+static void ipi_poll(void)
+{
+    if (!get_si() && READ_ONCE(ipi_datas[cpuid()].ipi_pending))
+    {
+        ipi_handle_pending();
+    }
+}
+/**
+ * @brief 等待csd被目标核心释放
+ *
+ * @param csd
+ */
+static void csd_lock_wait(csd_t *csd)
+{
+    while (__atomic_load_n(&csd->csd_flags, __ATOMIC_ACQUIRE) & CSD_FLAG_LOCK)
+    {
+        ipi_poll();
+    }
+}
+/**
+ * @brief 将csd加入目标核心的调用队列并发送IPI
+ *
+ * @param cpu
+ * @param csd
+ */
+static void csd_queue(uint64_t cpu, csd_t *csd)
+{
+    llist_add(&csd->csd_node, &ipi_datas[cpu].ipi_callq);
+    ipi_send(cpu, IPI_CALL_FUNC);
+}
+/**
+ * @brief 核间中断处理函数
+ *
+ */
+void ipi_interrupt_handler(void)
+{
+    uint64_t start = read_rdtime();
+    /* 先清除等待位，之后到达的IPI会重新置位*/
+    clear_sip(SIP_SSIP);
+    ipi_handle_pending();
+    trapstat_record(&trapstat_this.tc_ipi, read_rdtime() - start);
+}
+/**
+ * @brief 在指定核心上执行func(arg)
+ *
+ * @param cpu 目标核心
+ * @param func 远程函数(在目标核心的中断上下文中执行)
+ * @param arg 函数参数
+ * @param wait 是否等待远程函数执行完毕
+ * @return err_t
+ */
+err_t smp_call_function_single(uint64_t cpu, smp_call_func_t func, void *arg, bool wait)
+{
+    if (cpu >= NCPU || !(READ_ONCE(cpu_online_mask) & (1ul << cpu)))
+    {
+        return -EINVAL;
+    }
+    /* 关中断期间当前线程不会被迁移到其他核心*/
+    register_t sie = disable_si();
+    uint64_t self = cpuid();
+    if (cpu == self)
+    {
+        /* 目标是本核心：直接执行*/
+        func(arg);
+        restore_si(sie);
+        return 0;
+    }
+    csd_t stack_csd;
+    csd_t *csd;
+    if (wait)
+    {
+        csd = &stack_csd;
+        csd->csd_flags = CSD_FLAG_LOCK | CSD_FLAG_WAIT;
+    }
+    else
+    {
+        /* 等待上一次发往该核心的异步调用完成*/
+        csd = &ipi_datas[self].ipi_csd[cpu];
+        csd_lock_wait(csd);
+        csd->csd_flags = CSD_FLAG_LOCK;
+    }
+    csd->csd_func = func;
+    csd->csd_arg = arg;
+    csd_queue(cpu, csd);
+    if (wait)
+    {
+        csd_lock_wait(csd);
+    }
+    restore_si(sie);
+    return 0;
+}
+/**
+ * @brief 在mask中的所有核心(不包括本核心)上执行func(arg)
+ *
+ * @param mask 目标核心位图
+ * @param func 远程函数(在目标核心的中断上下文中执行)
+ * @param arg 函数参数
+ * @param wait 是否等待所有远程函数执行完毕
+ */
+void smp_call_function_many(uint64_t mask, smp_call_func_t func, void *arg, bool wait)
+{
+    csd_t stack_csds[NCPU];
+    register_t sie = disable_si();
+    uint64_t self = cpuid();
+    mask &= READ_ONCE(cpu_online_mask) & ~(1ul << self);
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        if (!(mask & (1ul << cpu)))
+        {
+            continue;
+        }
+        csd_t *csd;
+        if (wait)
+        {
+            csd = &stack_csds[cpu];
+            csd->csd_flags = CSD_FLAG_LOCK | CSD_FLAG_WAIT;
+        }
+        else
+        {
+            csd = &ipi_datas[self].ipi_csd[cpu];
+            csd_lock_wait(csd);
+            csd->csd_flags = CSD_FLAG_LOCK;
+        }
+        csd->csd_func = func;
+        csd->csd_arg = arg;
+        csd_queue(cpu, csd);
+    }
+    if (wait)
+    {
+        for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+        {
+            if (mask & (1ul << cpu))
+            {
+                csd_lock_wait(&stack_csds[cpu]);
+            }
+        }
+    }
+    restore_si(sie);
+}
+/**
+ * @brief 通知目标核心重新调度
+ *
+ * @param cpu
+ */
+void smp_send_reschedule(uint64_t cpu)
+{
+    if (cpu < NCPU && (READ_ONCE(cpu_online_mask) & (1ul << cpu)))
+    {
+        ipi_send(cpu, IPI_RESCHEDULE);
+    }
+}
+/**
+ * @brief 通知核心重新计算下一次定时器事件(用于唤醒停止了tick的核心)
+ *
+ * @param cpu 目标核心
+ */
+void smp_send_tick(uint64_t cpu)
+{
+    if (cpu < NCPU && cpu != cpuid() && (READ_ONCE(cpu_online_mask) & (1ul << cpu)))
+    {
+        ipi_send(cpu, IPI_TICK);
+    }
+}
+/**
+ * @brief 同步刷新mask中其他核心的TLB(本核心由调用者负责)
+ *        同一核心上的多个请求会合并为一个范围
+ *
+ * @param mask 目标核心位图
+ * @param va 起始虚拟地址
+ * @param size 刷新范围
+ */
+void smp_tlb_shootdown(uint64_t mask, uint64_t va, uint64_t size)
+{
+    uint64_t gens[NCPU];
+    register_t sie = disable_si();
+    mask &= READ_ONCE(cpu_online_mask) & ~(1ul << cpuid());
+    if (mask == 0)
+    {
+        restore_si(sie);
+        return;
+    }
+    uint64_t start = ADDRALIGNDOWN(va, PAGE_SIZE);
+    uint64_t end = ADDRALIGNUP(va + size, PAGE_SIZE);
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        if (!(mask & (1ul << cpu)))
+        {
+            continue;
+        }
+        ipi_data_t *d = &ipi_datas[cpu];
+        mutex_lock(&d->ipi_tlb_lock);
+        if (d->ipi_tlb_end == 0)
+        {
+            d->ipi_tlb_start = start;
+            d->ipi_tlb_end = end;
+        }
+        else
+        {
+            /* 与未处理的请求合并*/
+            d->ipi_tlb_start = start < d->ipi_tlb_start ? start : d->ipi_tlb_start;
+            d->ipi_tlb_end = end > d->ipi_tlb_end ? end : d->ipi_tlb_end;
+        }
+        gens[cpu] = ++d->ipi_tlb_gen;
+        mutex_unlock(&d->ipi_tlb_lock);
+        ipi_send(cpu, IPI_TLB_SHOOTDOWN);
+    }
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        if (mask & (1ul << cpu))
+        {
+            while (__atomic_load_n(&ipi_datas[cpu].ipi_tlb_done, __ATOMIC_ACQUIRE) < gens[cpu])
+            {
+                ipi_poll();
+            }
+        }
+    }
+    restore_si(sie);
+}
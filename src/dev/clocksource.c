@@ -0,0 +1,138 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/platform.h"
+#include "common/rv64.h"
+#include "dev/clocksource.h"
+#include "dev/vdso.h"
+#include "dev/timer.h"
+#include "dev/dtb.h"
+#include "mmu/mmu.h"
+#include "lib/printf.h"
+
+/* 换算参数，设备树解析前使用QEMU VIRT的默认频率*/
+clocksource_t clocksource = {
+    .cs_freq = QEMU_VIRT_CPU_FREQ,
+    .cs_mult_ns = (NSEC_PER_SEC << CS_SHIFT) / QEMU_VIRT_CPU_FREQ,
+    .cs_mult_us = (1000000ul << CS_SHIFT) / QEMU_VIRT_CPU_FREQ,
+    .cs_mult_cyc = ((QEMU_VIRT_CPU_FREQ << CS_SHIFT) + NSEC_PER_SEC - 1) / NSEC_PER_SEC,
+    .cs_tick_cycles = QEMU_VIRT_CPU_FREQ / JAEOS_TIME_FREQ,
+    .cs_mult_jiffies = ~0ul / (QEMU_VIRT_CPU_FREQ / JAEOS_TIME_FREQ),
+};
+timekeeper_t timekeeper;
+/* 用户态时钟数据页(独占一页，映射到每个进程的VVAR_VMA)*/
+vvar_data_t vvar __attribute__((section(".vvar"), aligned(PAGE_SIZE)));
+
+/**
+ * @brief 计算换算乘数：(1 << CS_SHIFT) * to / from
+ *        拆成整数部分和余数部分分别做64位除法(内核不链接libgcc，不能用128位除法)，
+ *        from小于2^32时余数左移CS_SHIFT不会溢出，结果与128位除法相同
+ *
+ * @param to
+ * @param from
+ * @param round_up 是否向上取整
+ * @return uint64_t
+ */
+static uint64_t clocksource_calc_mult(uint64_t to, uint64_t from, bool round_up)
+{
+    uint64_t rem = (to % from) << CS_SHIFT;
+    if (round_up)
+    {
+        rem += from - 1;
+    }
+    return ((to / from) << CS_SHIFT) + rem / from;
+}
+/**
+ * @brief 读取goldfish RTC(自1970年以来的纳秒数)
+ *
+ * @return uint64_t
+ */
+static uint64_t rtc_read_ns(void)
+{
+    volatile uint32_t *rtc = (volatile uint32_t *)RTC_BASE;
+    /* 先读低32位，同时锁存高32位*/
+    uint64_t low = rtc[RTC_TIME_LOW / sizeof(uint32_t)];
+    uint64_t high = rtc[RTC_TIME_HIGH / sizeof(uint32_t)];
+    return (high << 32) | low;
+}
+/**
+ * @brief 把计时器基准同步到用户态时钟数据页(需持有tk_lock)
+ *        vvar的序列计数器与tk_lock的序列计数器相互独立，用户态只读取vvar
+ */
+void vvar_update(void)
+{
+    write_seqcount_begin(&vvar.vv_seq);
+    vvar.vv_shift = CS_SHIFT;
+    vvar.vv_mult = clocksource.cs_mult_ns;
+    vvar.vv_cycle_last = timekeeper.tk_cycle_last;
+    vvar.vv_base_ns[CLOCK_REALTIME] = timekeeper.tk_real_ns;
+    vvar.vv_base_ns[CLOCK_MONOTONIC] = timekeeper.tk_mono_ns;
+    write_seqcount_end(&vvar.vv_seq);
+}
+/**
+ * @brief 时钟源初始化：按设备树中的计数频率计算换算参数，从RTC读取实时时间(需要在RTC映射之后调用)
+ *
+ */
+void clocksource_init(void)
+{
+    uint64_t freq = cpu_info.timebase_freq ? cpu_info.timebase_freq : QEMU_VIRT_CPU_FREQ;
+    clocksource.cs_freq = freq;
+    clocksource.cs_mult_ns = clocksource_calc_mult(NSEC_PER_SEC, freq, false);
+    clocksource.cs_mult_us = clocksource_calc_mult(1000000ul, freq, false);
+    clocksource.cs_mult_cyc = clocksource_calc_mult(freq, NSEC_PER_SEC, true);
+    clocksource.cs_tick_cycles = freq / JAEOS_TIME_FREQ;
+    clocksource.cs_mult_jiffies = ~0ul / clocksource.cs_tick_cycles;
+
+    seqlock_init(&timekeeper.tk_lock, "timekeeper");
+    write_seqlock(&timekeeper.tk_lock);
+    timekeeper.tk_cycle_last = read_rdtime();
+    timekeeper.tk_mono_ns = clocksource_cyc2ns(timekeeper.tk_cycle_last);
+    timekeeper.tk_real_ns = rtc_read_ns();
+    vvar_update();
+    write_sequnlock(&timekeeper.tk_lock);
+
+    printf("[JaeOS]Clocksource: %lu Hz, mult %lu, shift %d\n", freq, clocksource.cs_mult_ns, CS_SHIFT);
+    printf("[JaeOS]Realtime: %lu s\n", timekeeper.tk_real_ns / NSEC_PER_SEC);
+}
+/**
+ * @brief 读取时钟
+ *
+ * @param clockid CLOCK_REALTIME或CLOCK_MONOTONIC
+ * @param ns 返回纳秒数
+ * @return err_t 不支持的时钟返回-EINVAL
+ */
+err_t clock_gettime_ns(int32_t clockid, uint64_t *ns)
+{
+    switch (clockid)
+    {
+    case CLOCK_REALTIME:
+        *ns = clock_real_ns();
+        return 0;
+    case CLOCK_MONOTONIC:
+        *ns = clock_mono_ns();
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+/**
+ * @brief 设置时钟(只有CLOCK_REALTIME可以设置)，以当前时刻为新的基准
+ *
+ * @param clockid
+ * @param ns 自1970年以来的纳秒数
+ * @return err_t
+ */
+err_t clock_settime_ns(int32_t clockid, uint64_t ns)
+{
+    if (clockid != CLOCK_REALTIME)
+    {
+        return -EINVAL;
+    }
+    write_seqlock(&timekeeper.tk_lock);
+    uint64_t now = read_rdtime();
+    timekeeper.tk_mono_ns += clocksource_cyc2ns(now - timekeeper.tk_cycle_last);
+    timekeeper.tk_cycle_last = now;
+    timekeeper.tk_real_ns = ns;
+    vvar_update();
+    write_sequnlock(&timekeeper.tk_lock);
+    return 0;
+}
@@ -18,6 +18,9 @@
 /* 全局地址 */
 MEM_INFO mem_info;
 
+/* CPU信息*/
+CPU_INFO cpu_info;
+
 /* dtb入口地址*/
 uint64_t dtb_entry;
 /**
@@ -101,6 +104,79 @@ static uint8_t *fdt_get_string(FDT_Head *fdt_head, uint32_t offset)
 {
     return (uint8_t *)fdt_head + fdt_head->dt_strings_offset + offset;
 }
+/**
+ * @brief 比较长度为len的字符串片段与以'\0'结尾的字符串
+ *
+ * @param s
+ * @param len
+ * @param name
+ * @return bool
+ */
+static bool dtb_token_equal(const uint8_t *s, uint32_t len, const char *name)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (name[i] == '\0' || s[i] != (uint8_t)name[i])
+        {
+            return false;
+        }
+    }
+    return name[len] == '\0';
+}
+/**
+ * @brief riscv,isa字符串中是否包含扩展ext
+ *        格式："rv64imafdch_zicsr_zifencei_sstc"，多字母扩展以'_'分隔
+ *
+ * @param isa
+ * @param len 属性长度(包含'\0')
+ * @param ext
+ * @return bool
+ */
+static bool dtb_isa_has_ext(const uint8_t *isa, uint32_t len, const char *ext)
+{
+    uint32_t start = 0;
+    for (uint32_t i = 0; i <= len; i++)
+    {
+        if (i == len || isa[i] == '_' || isa[i] == '\0')
+        {
+            if (dtb_token_equal(isa + start, i - start, ext))
+            {
+                return true;
+            }
+            if (i == len || isa[i] == '\0')
+            {
+                break;
+            }
+            start = i + 1;
+        }
+    }
+    return false;
+}
+/**
+ * @brief riscv,isa-extensions字符串列表中是否包含扩展ext
+ *        格式："i\0m\0a\0...\0sstc\0"
+ *
+ * @param list
+ * @param len
+ * @param ext
+ * @return bool
+ */
+static bool dtb_isa_list_has_ext(const uint8_t *list, uint32_t len, const char *ext)
+{
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (list[i] == '\0')
+        {
+            if (dtb_token_equal(list + start, i - start, ext))
+            {
+                return true;
+            }
+            start = i + 1;
+        }
+    }
+    return false;
+}
 /**
  * @brief 设备树是一个树形结构，一个典型的包含关系：根节点->总线节点->设备节点->寄存器节点...
  *        每个节点的解析流程相同，对于树形结构的数据，通常采用递归，根节点的深度是0
@@ -117,6 +193,9 @@ static uint8_t *dtb_node_parse(FDT_Head *fdt_head, uint8_t *ptr, uint8_t *parent
     uint8_t prop_width = 25;
     /* 获取dtb结束地址*/
     uint8_t *dtb_end = (uint8_t *)fdt_head + fdt_head->totalsize;
+    /* 当前节点的指令集扩展(仅核心节点有)*/
+    bool isa_node = false;
+    bool isa_sstc = false;
     /* 读取节点的开始标记*/
     uint32_t token = get_big_endian_data(ptr, sizeof(uint32_t));
     if (token != FDT_BEGIN_NODE)
@@ -183,6 +262,22 @@ static uint8_t *dtb_node_parse(FDT_Head *fdt_head, uint8_t *ptr, uint8_t *parent
                 mem_info.start = _start;
                 mem_info.size = _size;
             }
+            /* 处理特定属性:rdtime计数频率*/
+            if (strcmp((const char *)node_name, "cpus") == 0 && strcmp((const char *)prop_name, "timebase-frequency") == 0)
+            {
+                cpu_info.timebase_freq = get_big_endian_data(prop_data, fdt_prop->len == 8 ? 8 : 4);
+            }
+            /* 处理特定属性:核心支持的指令集扩展(旧写法riscv,isa，新写法riscv,isa-extensions)*/
+            if (strcmp((const char *)prop_name, "riscv,isa") == 0)
+            {
+                isa_node = true;
+                isa_sstc |= dtb_isa_has_ext(prop_data, fdt_prop->len, "sstc");
+            }
+            else if (strcmp((const char *)prop_name, "riscv,isa-extensions") == 0)
+            {
+                isa_node = true;
+                isa_sstc |= dtb_isa_list_has_ext(prop_data, fdt_prop->len, "sstc");
+            }
             /* 更新ptr*/
             ptr += sizeof(FDT_Node_Property) + fdt_prop->len - 4;
             /* 四字节对齐*/
@@ -196,6 +291,12 @@ static uint8_t *dtb_node_parse(FDT_Head *fdt_head, uint8_t *ptr, uint8_t *parent
         }
         case FDT_END_NODE:
         {
+            /* 核心节点解析完成，统计指令集扩展*/
+            if (isa_node && strcmp((const char *)parent, "cpus") == 0)
+            {
+                cpu_info.cpus++;
+                cpu_info.sstc_cpus += isa_sstc;
+            }
             return ptr;
         }
         case FDT_END:
@@ -263,4 +364,8 @@ void dtb_prase(uint64_t _dtb_entry)
     /* 打印全局内存信息*/
     printf("[JaeOS]Memory Info:\n");
     printf("       Start: 0x%016lX, Size:%lu MB\n", mem_info.start, mem_info.size / 1024 / 1024);
+    /* 打印指令集扩展信息*/
+    printf("[JaeOS]CPU Info:\n");
+    printf("       Timebase: %lu Hz\n", cpu_info.timebase_freq);
+    printf("       Sstc: %u/%u cpus\n", cpu_info.sstc_cpus, cpu_info.cpus);
 }
\ No newline at end of file
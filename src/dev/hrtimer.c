@@ -0,0 +1,413 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/rv64.h"
+#include "common/atomic.h"
+#include "common/platform.h"
+#include "lock/mutex.h"
+#include "cpu/cpu.h"
+#include "dev/timer.h"
+#include "dev/hrtimer.h"
+#include "dev/clocksource.h"
+#include "process/sched.h"
+#include "trap/softirq.h"
+
+static hrtimer_base_t hrtimer_bases[NCPU];
+
+/**
+ * @brief 睡眠线程使用的定时器(分配在睡眠线程的栈上)
+ *
+ */
+typedef struct
+{
+    hrtimer_t hs_timer; /* 定时器*/
+    thread_t *hs_td;    /* 睡眠的线程*/
+} hrtimer_sleeper_t;
+
+/**
+ * @brief 初始化所有核心的hrtimer队列(主核在定时器初始化时调用)
+ *
+ */
+void hrtimer_bases_init(void)
+{
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        hrtimer_base_t *base = &hrtimer_bases[cpu];
+        mutex_init(&base->hb_lock, "hrtimer_base", MUTEX_TYPE_SPIN);
+        base->hb_cpu = cpu;
+        base->hb_nr = 0;
+        TAILQ_INIT(&base->hb_soft);
+        base->hb_running = NULL;
+        base->hb_in_irq = false;
+    }
+    open_softirq(SOFTIRQ_HRTIMER, hrtimer_run_soft);
+}
+/**
+ * @brief 初始化定时器
+ *
+ * @param hr
+ * @param func 到期回调
+ * @param mode HRTIMER_MODE_HARD或HRTIMER_MODE_SOFT
+ */
+void hrtimer_init(hrtimer_t *hr, hrtimer_restart_t (*func)(hrtimer_t *), uint8_t mode)
+{
+    hr->hr_expires = 0;
+    hr->hr_func = func;
+    hr->hr_base = NULL;
+    hr->hr_index = HRTIMER_INDEX_NONE;
+    hr->hr_mode = mode;
+}
+/**
+ * @brief 交换堆中两个位置的定时器
+ *
+ * @param base
+ * @param i
+ * @param j
+ */
+static inline void hr_heap_swap(hrtimer_base_t *base, uint32_t i, uint32_t j)
+{
+    hrtimer_t *t = base->hb_heap[i];
+    base->hb_heap[i] = base->hb_heap[j];
+    base->hb_heap[j] = t;
+    base->hb_heap[i]->hr_index = i;
+    base->hb_heap[j]->hr_index = j;
+}
+/**
+ * @brief 上浮
+ *
+ * @param base
+ * @param i
+ */
+static void hr_heap_up(hrtimer_base_t *base, uint32_t i)
+{
+    while (i > 0)
+    {
+        uint32_t parent = (i - 1) / 2;
+        if (base->hb_heap[parent]->hr_expires <= base->hb_heap[i]->hr_expires)
+        {
+            break;
+        }
+        hr_heap_swap(base, i, parent);
+        i = parent;
+    }
+}
+/**
+ * @brief 下沉
+ *
+ * @param base
+ * @param i
+ */
+static void hr_heap_down(hrtimer_base_t *base, uint32_t i)
+{
+    while (1)
+    {
+        uint32_t min = i;
+        uint32_t left = 2 * i + 1;
+        uint32_t right = left + 1;
+        if (left < base->hb_nr && base->hb_heap[left]->hr_expires < base->hb_heap[min]->hr_expires)
+        {
+            min = left;
+        }
+        if (right < base->hb_nr && base->hb_heap[right]->hr_expires < base->hb_heap[min]->hr_expires)
+        {
+            min = right;
+        }
+        if (min == i)
+        {
+            break;
+        }
+        hr_heap_swap(base, i, min);
+        i = min;
+    }
+}
+/**
+ * @brief 加入最小堆(需持有hb_lock)
+ *
+ * @param base
+ * @param hr
+ */
+static void hr_heap_insert(hrtimer_base_t *base, hrtimer_t *hr)
+{
+    if (base->hb_nr == HRTIMER_HEAP_MAX)
+    {
+        /* 超出系统要求*/
+        while (1)
+            ;
+    }
+    uint32_t i = base->hb_nr++;
+    base->hb_heap[i] = hr;
+    hr->hr_index = i;
+    hr_heap_up(base, i);
+}
+/**
+ * @brief 从最小堆中删除(需持有hb_lock)，用最后一个元素填补空位
+ *
+ * @param base
+ * @param hr
+ */
+static void hr_heap_remove(hrtimer_base_t *base, hrtimer_t *hr)
+{
+    uint32_t i = hr->hr_index;
+    uint32_t last = --base->hb_nr;
+    hr->hr_index = HRTIMER_INDEX_NONE;
+    if (i == last)
+    {
+        return;
+    }
+    base->hb_heap[i] = base->hb_heap[last];
+    base->hb_heap[i]->hr_index = i;
+    hr_heap_up(base, i);
+    hr_heap_down(base, base->hb_heap[i]->hr_index);
+}
+/**
+ * @brief 从队列中移除(排队中或等待延迟执行)，需持有hb_lock
+ *
+ * @param base
+ * @param hr
+ * @return bool 是否处于活动状态
+ */
+static bool hrtimer_dequeue(hrtimer_base_t *base, hrtimer_t *hr)
+{
+    if (hr->hr_index == HRTIMER_INDEX_SOFT)
+    {
+        TAILQ_REMOVE(&base->hb_soft, hr, hr_softlink);
+        hr->hr_index = HRTIMER_INDEX_NONE;
+        return true;
+    }
+    if (hr->hr_index != HRTIMER_INDEX_NONE)
+    {
+        hr_heap_remove(base, hr);
+        return true;
+    }
+    return false;
+}
+/**
+ * @brief 将本核心的硬件比较器编程为堆顶的到期时间(需持有hb_lock)
+ *        其他核心的队列不能编程，过时的比较值最多产生一次多余的中断
+ *
+ * @param base
+ */
+static void hrtimer_program(hrtimer_base_t *base)
+{
+    if (base->hb_cpu != cpuid() || base->hb_in_irq)
+    {
+        return;
+    }
+    uint64_t next = base->hb_nr ? base->hb_heap[0]->hr_expires : TIMER_EVENT_NONE;
+    if (next == cpu_this.cpu_next_event)
+    {
+        return;
+    }
+    cpu_this.cpu_next_event = next;
+    timer_program(next);
+}
+/**
+ * @brief 在当前核心启动(或重新启动)定时器
+ *
+ * @param hr
+ * @param expires 到期时间(rdtime)
+ */
+void hrtimer_start(hrtimer_t *hr, uint64_t expires)
+{
+    register_t sie = disable_si();
+    hrtimer_base_t *base = &hrtimer_bases[cpuid()];
+    hrtimer_base_t *old = hr->hr_base;
+    if (old != NULL && old != base)
+    {
+        /* 从其他核心的队列迁移过来*/
+        mutex_lock(&old->hb_lock);
+        hrtimer_dequeue(old, hr);
+        mutex_unlock(&old->hb_lock);
+    }
+    mutex_lock(&base->hb_lock);
+    if (old == base && hr->hr_index < base->hb_nr && hr->hr_expires == expires)
+    {
+        /* 已经按相同的时间排队*/
+        mutex_unlock(&base->hb_lock);
+        restore_si(sie);
+        return;
+    }
+    if (old == base)
+    {
+        hrtimer_dequeue(base, hr);
+    }
+    hr->hr_base = base;
+    hr->hr_expires = expires;
+    hr_heap_insert(base, hr);
+    hrtimer_program(base);
+    mutex_unlock(&base->hb_lock);
+    restore_si(sie);
+}
+/**
+ * @brief 尝试取消定时器，不等待正在执行的回调
+ *
+ * @param hr
+ * @return int32_t 1：取消了活动的定时器 0：定时器不活动 -1：回调正在执行
+ */
+int32_t hrtimer_try_cancel(hrtimer_t *hr)
+{
+    hrtimer_base_t *base = READ_ONCE(hr->hr_base);
+    if (base == NULL)
+    {
+        return 0;
+    }
+    int32_t ret = 0;
+    mutex_lock(&base->hb_lock);
+    if (hrtimer_dequeue(base, hr))
+    {
+        ret = 1;
+        hrtimer_program(base);
+    }
+    else if (base->hb_running == hr)
+    {
+        ret = -1;
+    }
+    mutex_unlock(&base->hb_lock);
+    return ret;
+}
+/**
+ * @brief 取消定时器，返回时回调一定已经执行完成(不能在该定时器自己的回调中调用)
+ *
+ * @param hr
+ * @return bool 定时器是否处于活动状态
+ */
+bool hrtimer_cancel(hrtimer_t *hr)
+{
+    int32_t ret;
+    while ((ret = hrtimer_try_cancel(hr)) < 0)
+        ;
+    return ret > 0;
+}
+/**
+ * @brief 将到期时间按interval推进到now之后(用于回调中实现周期定时器)
+ *
+ * @param hr
+ * @param now
+ * @param interval
+ * @return uint64_t 推进的周期数(大于1表示错过了到期)
+ */
+uint64_t hrtimer_forward(hrtimer_t *hr, uint64_t now, uint64_t interval)
+{
+    if (now < hr->hr_expires)
+    {
+        return 0;
+    }
+    uint64_t overruns = (now - hr->hr_expires) / interval + 1;
+    hr->hr_expires += overruns * interval;
+    return overruns;
+}
+/**
+ * @brief 执行回调(需持有hb_lock，执行期间释放)，回调要求重启且没有被重新启动时重新排队
+ *
+ * @param base
+ * @param hr
+ */
+static void hrtimer_run(hrtimer_base_t *base, hrtimer_t *hr)
+{
+    base->hb_running = hr;
+    mutex_unlock(&base->hb_lock);
+    hrtimer_restart_t ret = hr->hr_func(hr);
+    mutex_lock(&base->hb_lock);
+    base->hb_running = NULL;
+    if (ret == HRTIMER_RESTART && hr->hr_index == HRTIMER_INDEX_NONE && hr->hr_base == base)
+    {
+        hr_heap_insert(base, hr);
+    }
+}
+/**
+ * @brief 定时器中断：执行所有到期的HARD定时器，SOFT定时器挂入延迟链表，最后编程下一次中断
+ *
+ */
+void hrtimer_interrupt(void)
+{
+    hrtimer_base_t *base = &hrtimer_bases[cpuid()];
+    mutex_lock(&base->hb_lock);
+    /* 已编程的比较值已经过期，结束时必须重新编程*/
+    cpu_this.cpu_next_event = 0;
+    base->hb_in_irq = true;
+    uint64_t now = read_rdtime();
+    while (base->hb_nr != 0 && base->hb_heap[0]->hr_expires <= now)
+    {
+        hrtimer_t *hr = base->hb_heap[0];
+        hr_heap_remove(base, hr);
+        if (hr->hr_mode == HRTIMER_MODE_SOFT)
+        {
+            TAILQ_INSERT_TAIL(&base->hb_soft, hr, hr_softlink);
+            hr->hr_index = HRTIMER_INDEX_SOFT;
+            raise_softirq(SOFTIRQ_HRTIMER);
+            continue;
+        }
+        hrtimer_run(base, hr);
+        /* 回调可能耗时，顺便处理期间到期的定时器*/
+        now = read_rdtime();
+    }
+    base->hb_in_irq = false;
+    hrtimer_program(base);
+    mutex_unlock(&base->hb_lock);
+}
+/**
+ * @brief HRTIMER软中断：执行已到期的SOFT定时器
+ *
+ */
+void hrtimer_run_soft(void)
+{
+    hrtimer_base_t *base = &hrtimer_bases[cpuid()];
+    if (TAILQ_EMPTY(&base->hb_soft))
+    {
+        return;
+    }
+    mutex_lock(&base->hb_lock);
+    hrtimer_t *hr;
+    while ((hr = TAILQ_FIRST(&base->hb_soft)) != NULL)
+    {
+        TAILQ_REMOVE(&base->hb_soft, hr, hr_softlink);
+        hr->hr_index = HRTIMER_INDEX_NONE;
+        hrtimer_run(base, hr);
+    }
+    hrtimer_program(base);
+    mutex_unlock(&base->hb_lock);
+}
+/**
+ * @brief 睡眠定时器回调：唤醒睡眠的线程
+ *
+ * @param hr
+ * @return hrtimer_restart_t
+ */
+static hrtimer_restart_t hrtimer_wakeup(hrtimer_t *hr)
+{
+    hrtimer_sleeper_t *sl = (hrtimer_sleeper_t *)hr;
+    wakeup_thread(sl->hs_td, sl);
+    return HRTIMER_NORESTART;
+}
+/**
+ * @brief 高精度睡眠(nanosleep/clock_nanosleep的实现)
+ *
+ * @param ns 睡眠时长(纳秒)，abs为true时为单调时钟的绝对时间
+ * @param abs 是否为绝对时间
+ * @return err_t
+ */
+err_t hrtimer_nanosleep(uint64_t ns, bool abs)
+{
+    /* CLOCK_MONOTONIC与rdtime同源，绝对时间直接换算为rdtime*/
+    uint64_t now = read_rdtime();
+    uint64_t cycles = clocksource_ns2cyc(ns);
+    if (!abs && cycles >= TIMER_EVENT_NONE - now)
+    {
+        return -EINVAL;
+    }
+    uint64_t expires = abs ? cycles : now + cycles;
+    if (expires <= now)
+    {
+        return 0;
+    }
+    hrtimer_sleeper_t sl;
+    hrtimer_init(&sl.hs_timer, hrtimer_wakeup, HRTIMER_MODE_HARD);
+    sl.hs_td = cpu_this.cpu_running;
+    /* 关中断直到线程进入睡眠队列：定时器挂在本核心，不会在睡眠之前到期而丢失唤醒*/
+    register_t sie = disable_si();
+    hrtimer_start(&sl.hs_timer, expires);
+    sleep(&sl, NULL, "nanosleep");
+    restore_si(sie);
+    /* 等待可能仍在其他核心上执行的回调结束，之后才能释放栈上的定时器*/
+    hrtimer_cancel(&sl.hs_timer);
+    return 0;
+}
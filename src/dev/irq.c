@@ -0,0 +1,278 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/atomic.h"
+#include "common/rv64.h"
+#include "lock/mutex.h"
+#include "cpu/cpu.h"
+#include "dev/clocksource.h"
+#include "dev/hrtimer.h"
+#include "dev/plic.h"
+#include "dev/irq.h"
+#include "trap/trapstat.h"
+
+/**
+ * @brief 中断源描述符(除id_count外受irq_lock保护)
+ *
+ */
+typedef struct
+{
+    irq_handler_t id_handler; /* 处理函数(NULL表示未注册)*/
+    uint32_t id_priority;     /* PLIC优先级*/
+    uint64_t id_affinity;     /* 允许处理的核心*/
+    uint64_t id_target;       /* 当前路由到的核心*/
+    uint64_t id_count[NCPU];  /* 每个核心处理的次数(只由该核心修改)*/
+    uint64_t id_last;         /* 上一次均衡时的总次数*/
+    uint64_t id_rate;         /* 上一个均衡周期内的次数*/
+} irq_desc_t;
+
+static irq_desc_t irq_descs[IRQ_NUM]; /* 中断源描述符*/
+static hrtimer_t irq_balance_timer;   /* 周期均衡定时器*/
+
+/**
+ * @brief 把中断源路由到target(需持有irq_lock)
+ *
+ * @param irq
+ * @param target IRQ_TARGET_NONE表示关闭
+ */
+static void irq_route(uint32_t irq, uint64_t target)
+{
+    irq_desc_t *desc = &irq_descs[irq];
+    if (desc->id_target == target)
+    {
+        return;
+    }
+    /* 先使能新目标再关闭旧目标：迁移期间到达的中断至少有一个核心能claim*/
+    if (target != IRQ_TARGET_NONE)
+    {
+        plic_set_enable(irq, target, true);
+    }
+    if (desc->id_target != IRQ_TARGET_NONE)
+    {
+        plic_set_enable(irq, desc->id_target, false);
+    }
+    desc->id_target = target;
+}
+/**
+ * @brief 在亲和性允许的在线核心中选择负载最低的(负载相同时保持当前目标，避免来回迁移)
+ *
+ * @param desc
+ * @param load 每个核心的负载
+ * @return uint64_t 没有可用核心时返回IRQ_TARGET_NONE
+ */
+static uint64_t irq_pick(irq_desc_t *desc, const uint64_t *load)
+{
+    uint64_t allowed = desc->id_affinity & READ_ONCE(cpu_online_mask);
+    uint64_t best = IRQ_TARGET_NONE;
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        if (!(allowed & (1ul << cpu)))
+        {
+            continue;
+        }
+        if (best == IRQ_TARGET_NONE || load[cpu] < load[best] ||
+            (load[cpu] == load[best] && cpu == desc->id_target))
+        {
+            best = cpu;
+        }
+    }
+    return best;
+}
+/**
+ * @brief 按已路由的中断源数量统计每个核心的负载(需持有irq_lock)
+ *
+ * @param load
+ */
+static void irq_route_load(uint64_t *load)
+{
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        load[cpu] = 0;
+    }
+    for (uint32_t irq = 1; irq < IRQ_NUM; irq++)
+    {
+        if (irq_descs[irq].id_target != IRQ_TARGET_NONE)
+        {
+            load[irq_descs[irq].id_target]++;
+        }
+    }
+}
+/**
+ * @brief 均衡定时器回调
+ *
+ * @param hr
+ * @return hrtimer_restart_t
+ */
+static hrtimer_restart_t irq_balance_fn(hrtimer_t *hr)
+{
+    irq_balance();
+    hrtimer_forward(hr, read_rdtime(), clocksource_ns2cyc(IRQ_BALANCE_INTERVAL_MS * NSEC_PER_MSEC));
+    return HRTIMER_RESTART;
+}
+/**
+ * @brief 初始化中断源描述符，启动周期均衡
+ *
+ */
+void irq_init(void)
+{
+    mutex_init(&irq_lock, "irq_lock", MUTEX_TYPE_SPIN);
+    for (uint32_t irq = 0; irq < IRQ_NUM; irq++)
+    {
+        irq_descs[irq].id_handler = NULL;
+        irq_descs[irq].id_target = IRQ_TARGET_NONE;
+    }
+    hrtimer_init(&irq_balance_timer, irq_balance_fn, HRTIMER_MODE_SOFT);
+    hrtimer_start(&irq_balance_timer, read_rdtime() + clocksource_ns2cyc(IRQ_BALANCE_INTERVAL_MS * NSEC_PER_MSEC));
+}
+/**
+ * @brief 注册外部中断处理函数
+ *
+ * @param irq PLIC中断源ID
+ * @param handler 处理函数
+ * @param priority PLIC优先级(PLIC_PRIORITY_MIN~PLIC_PRIORITY_MAX)，越大越优先，可以打断低优先级中断源的处理
+ * @param cpumask 允许处理该中断的核心
+ * @return err_t
+ */
+err_t request_irq(uint32_t irq, irq_handler_t handler, uint32_t priority, uint64_t cpumask)
+{
+    if (irq == 0 || irq >= IRQ_NUM || handler == NULL || cpumask == 0)
+    {
+        return -EINVAL;
+    }
+    if (priority < PLIC_PRIORITY_MIN || priority > PLIC_PRIORITY_MAX)
+    {
+        return -EINVAL;
+    }
+    irq_desc_t *desc = &irq_descs[irq];
+    mutex_lock(&irq_lock);
+    if (desc->id_handler != NULL)
+    {
+        mutex_unlock(&irq_lock);
+        return -EBUSY;
+    }
+    desc->id_priority = priority;
+    desc->id_affinity = cpumask;
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        desc->id_count[cpu] = 0;
+    }
+    desc->id_last = 0;
+    desc->id_rate = 0;
+    /* 先发布处理函数，再设置优先级并使能*/
+    WRITE_ONCE(desc->id_handler, handler);
+    plic_set_priority(irq, priority);
+    uint64_t load[NCPU];
+    irq_route_load(load);
+    irq_route(irq, irq_pick(desc, load));
+    mutex_unlock(&irq_lock);
+    return 0;
+}
+/**
+ * @brief 修改中断源的亲和性，当前目标不再允许时立即迁移
+ *
+ * @param irq
+ * @param cpumask
+ * @return err_t
+ */
+err_t irq_set_affinity(uint32_t irq, uint64_t cpumask)
+{
+    if (irq == 0 || irq >= IRQ_NUM || cpumask == 0)
+    {
+        return -EINVAL;
+    }
+    irq_desc_t *desc = &irq_descs[irq];
+    mutex_lock(&irq_lock);
+    if (desc->id_handler == NULL)
+    {
+        mutex_unlock(&irq_lock);
+        return -EINVAL;
+    }
+    desc->id_affinity = cpumask;
+    if (desc->id_target == IRQ_TARGET_NONE || !(cpumask & (1ul << desc->id_target)))
+    {
+        uint64_t load[NCPU];
+        irq_route_load(load);
+        irq_route(irq, irq_pick(desc, load));
+    }
+    mutex_unlock(&irq_lock);
+    return 0;
+}
+/**
+ * @brief 按上一个周期的触发次数重新分配路由：从最频繁的中断源开始，依次分配给负载最低的核心
+ *        核心上线后也需要调用，把中断源分散到新核心
+ */
+void irq_balance(void)
+{
+    uint64_t load[NCPU] = {0};
+    bool placed[IRQ_NUM];
+    mutex_lock(&irq_lock);
+    for (uint32_t irq = 1; irq < IRQ_NUM; irq++)
+    {
+        irq_desc_t *desc = &irq_descs[irq];
+        placed[irq] = desc->id_handler == NULL;
+        if (placed[irq])
+        {
+            continue;
+        }
+        uint64_t total = 0;
+        for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+        {
+            total += READ_ONCE(desc->id_count[cpu]);
+        }
+        desc->id_rate = total - desc->id_last;
+        desc->id_last = total;
+    }
+    while (1)
+    {
+        irq_desc_t *max = NULL;
+        uint32_t max_irq = 0;
+        for (uint32_t irq = 1; irq < IRQ_NUM; irq++)
+        {
+            if (!placed[irq] && (max == NULL || irq_descs[irq].id_rate > max->id_rate))
+            {
+                max = &irq_descs[irq];
+                max_irq = irq;
+            }
+        }
+        if (max == NULL)
+        {
+            break;
+        }
+        placed[max_irq] = true;
+        uint64_t target = irq_pick(max, load);
+        irq_route(max_irq, target);
+        if (target != IRQ_TARGET_NONE)
+        {
+            /* 加一：没有触发过的中断源也按数量分散*/
+            load[target] += max->id_rate + 1;
+        }
+    }
+    mutex_unlock(&irq_lock);
+}
+/**
+ * @brief 外部中断分发：循环claim直到没有送到本核心的中断源
+ *        处理期间把阈值提高到当前中断源的优先级并开中断，只有更高优先级的中断源(以及定时器/核间中断)可以嵌套
+ */
+void irq_dispatch(void)
+{
+    uint64_t hart = cpuid();
+    uint32_t irq;
+    while ((irq = plic_claim(hart)) != 0)
+    {
+        irq_handler_t handler = irq < IRQ_NUM ? READ_ONCE(irq_descs[irq].id_handler) : NULL;
+        if (handler != NULL)
+        {
+            irq_desc_t *desc = &irq_descs[irq];
+            uint32_t threshold = plic_get_threshold(hart);
+            plic_set_threshold(hart, desc->id_priority);
+            uint64_t start = read_rdtime();
+            enable_si();
+            handler(irq);
+            disable_si();
+            /* 包含嵌套进来的更高优先级中断*/
+            trapstat_record(&trapstat_this.tc_external[irq], read_rdtime() - start);
+            plic_set_threshold(hart, threshold);
+            desc->id_count[hart]++;
+        }
+        plic_complete(irq, hart);
+    }
+}
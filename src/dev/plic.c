@@ -7,13 +7,15 @@
  */
 void plic_init(uint64_t hart_id)
 {
-    /* 使能VirtIO_0中断*/
-    uint32_t *senable_reg = (uint32_t *)PLIC_SENABLE(hart_id);
-    *senable_reg = (1 << VIRTIO_0_IR_ID);
+    /* 关闭所有中断源，由request_irq按亲和性使能*/
+    volatile uint32_t *senable_reg = (volatile uint32_t *)PLIC_SENABLE(hart_id);
+    for (uint32_t i = 0; i <= PLIC_MAX_IR_ID / 32; i++)
+    {
+        senable_reg[i] = 0;
+    }
 
 	/* 设置中断优先级阈值寄存器*/
-    uint32_t *spriority_reg = (uint32_t *)PLIC_SPRIORITY(hart_id);
-    *spriority_reg = 0;
+    plic_set_threshold(hart_id, 0);
 }
 /**
  * @brief 向PLIC索要当前的中断源ID
@@ -36,4 +38,56 @@ void plic_complete(uint32_t interrupt_id, uint64_t hart_id)
 {
     uint32_t *sclaim_reg = (uint32_t *)PLIC_SCLAIM(hart_id);
     *sclaim_reg = interrupt_id;
-}
\ No newline at end of file
+}
+/**
+ * @brief 设置中断源的优先级
+ *
+ * @param interrupt_id
+ * @param priority 0表示屏蔽
+ */
+void plic_set_priority(uint32_t interrupt_id, uint32_t priority)
+{
+    volatile uint32_t *priority_reg = (volatile uint32_t *)PLIC_PRIORITY(interrupt_id);
+    *priority_reg = priority;
+}
+/**
+ * @brief 使能/关闭某个核心上的中断源(调用者负责互斥，读-改-写同一个使能字)
+ *
+ * @param interrupt_id
+ * @param hart_id
+ * @param enable
+ */
+void plic_set_enable(uint32_t interrupt_id, uint64_t hart_id, bool enable)
+{
+    volatile uint32_t *senable_reg = (volatile uint32_t *)PLIC_SENABLE(hart_id) + interrupt_id / 32;
+    if (enable)
+    {
+        *senable_reg |= (1u << (interrupt_id % 32));
+    }
+    else
+    {
+        *senable_reg &= ~(1u << (interrupt_id % 32));
+    }
+}
+/**
+ * @brief 读取核心的优先级阈值
+ *
+ * @param hart_id
+ * @return uint32_t
+ */
+uint32_t plic_get_threshold(uint64_t hart_id)
+{
+    volatile uint32_t *spriority_reg = (volatile uint32_t *)PLIC_SPRIORITY(hart_id);
+    return *spriority_reg;
+}
+/**
+ * @brief 设置核心的优先级阈值：只有优先级高于阈值的中断源才会送到该核心
+ *
+ * @param hart_id
+ * @param threshold
+ */
+void plic_set_threshold(uint64_t hart_id, uint32_t threshold)
+{
+    volatile uint32_t *spriority_reg = (volatile uint32_t *)PLIC_SPRIORITY(hart_id);
+    *spriority_reg = threshold;
+}
@@ -2,31 +2,155 @@
 #include "dev/timer.h"
 #include "sbi/sbi.h"
 #include "common/rv64.h"
+#include "lock/rcu.h"
+#include "process/sched.h"
+#include "process/tsleep.h"
+#include "cpu/cpu.h"
+#include "dev/dtb.h"
+#include "dev/hrtimer.h"
+#include "dev/clocksource.h"
+#include "lib/printf.h"
+#include "trap/trapstat.h"
 
+#define TIMER_BENCH_ROUNDS (256ul) /* 测量编程开销的重复次数*/
+
+static bool timer_sstc;              /* 所有核心都支持Sstc：直接写stimecmp，不经过SBI*/
+static hrtimer_t tick_timers[NCPU]; /* 每个核心的tick定时器*/
+
+/**
+ * @brief 编程硬件定时器比较值(由hrtimer调用)
+ *
+ * @param stime_value 绝对时间(rdtime)，TIMER_EVENT_NONE表示关闭
+ */
+void timer_program(uint64_t stime_value)
+{
+    if (timer_sstc)
+    {
+        write_stimecmp(stime_value);
+    }
+    else
+    {
+        sbi_set_timer(stime_value);
+    }
+}
+/**
+ * @brief 测量一次定时器编程的平均开销(纳秒)，编程为最大值不会触发中断
+ *
+ * @param sstc 是否测量stimecmp路径
+ * @return uint64_t
+ */
+static uint64_t timer_bench(bool sstc)
+{
+    uint64_t start = read_rdtime();
+    for (uint64_t i = 0; i < TIMER_BENCH_ROUNDS; i++)
+    {
+        if (sstc)
+        {
+            write_stimecmp(TIMER_EVENT_NONE);
+        }
+        else
+        {
+            sbi_set_timer(TIMER_EVENT_NONE);
+        }
+    }
+    uint64_t cycles = read_rdtime() - start;
+    return clocksource_cyc2ns(cycles) / TIMER_BENCH_ROUNDS;
+}
+/**
+ * @brief tick定时器回调：推进RCU、睡眠超时时间轮和调度器，然后按需要重新启动自己
+ *
+ * @param hr
+ * @return hrtimer_restart_t
+ */
+static hrtimer_restart_t timer_tick(hrtimer_t *hr)
+{
+    /* 推进RCU宽限期，执行就绪的回调*/
+    rcu_check_callbacks();
+    /* 唤醒睡眠超时的线程*/
+    tsleep_check();
+    /* 统计运行时间，处理时间片*/
+    sched_tick();
+    /* 启动下一次tick(不需要时保持停止)*/
+    timer_reprogram();
+    return HRTIMER_NORESTART;
+}
 /**
  * @brief QEMU VIRT时钟频率为10MHz，JaeOS时钟频率为1KHz(1ms)
  *        当前函数配置定时器首次触发时间
+ *        主核根据设备树选择定时器编程方式(Sstc或SBI)，并打印编程开销
  */
 void timer_init(void)
 {
-    sbi_set_timer(read_rdtime() + JAEOS_TIME_CYCLES);
+    if (cpuid() == 0)
+    {
+        hrtimer_bases_init();
+        timer_sstc = cpu_info.cpus != 0 && cpu_info.sstc_cpus == cpu_info.cpus;
+        printf("[JaeOS]Timer Reprogram Cost: SBI %lu ns", timer_bench(false));
+        if (timer_sstc)
+        {
+            printf(", Sstc %lu ns", timer_bench(true));
+        }
+        printf(" (using %s)\n", timer_sstc ? "stimecmp" : "sbi_set_timer");
+    }
+    /* 允许用户态读取time，vdso不需要陷入内核即可获取时间*/
+    write_scounteren(SCOUNTEREN_TM);
+    cpu_this.cpu_next_event = TIMER_EVENT_NONE;
+    cpu_this.cpu_tick_stopped = 0;
+    timer_program(TIMER_EVENT_NONE);
+    hrtimer_init(&tick_timers[cpuid()], timer_tick, HRTIMER_MODE_HARD);
+    hrtimer_start(&tick_timers[cpuid()], timer_next_tick(read_rdtime()));
 }
 /**
- * @brief 在发生时钟中断时设置下一个tick的值
+ * @brief 计算当前核心下一次需要tick的时间
  *
+ * @return uint64_t 绝对时间(rdtime)，TIMER_EVENT_NONE表示没有事件
  */
-static void feed_timer(void)
+static uint64_t timer_next_event(void)
 {
-    sbi_set_timer(read_rdtime() + JAEOS_TIME_CYCLES);
+    uint64_t now = read_rdtime();
+    uint64_t next = sched_next_event(now);
+    uint64_t sleep = tsleep_next_event();
+    next = sleep < next ? sleep : next;
+    if (rcu_pending())
+    {
+        /* RCU回调或宽限期需要tick推进*/
+        uint64_t tick = timer_next_tick(now);
+        next = tick < next ? tick : next;
+    }
+    return next;
 }
 /**
- * @brief 定时器中断处理函数
- * 
+ * @brief 按最早的待处理事件启动或停止tick定时器(需关闭中断)
+ *        到期时间不变时hrtimer不重新排队，比较器不变时不重复编程
+ */
+void timer_reprogram(void)
+{
+    uint64_t next = timer_next_event();
+    uint64_t tick = timer_next_tick(read_rdtime());
+    /* 下一次事件晚于下一个tick：周期tick已停止*/
+    cpu_this.cpu_tick_stopped = next > tick;
+    if (next == TIMER_EVENT_NONE)
+    {
+        /* 可能在tick回调中调用，不能等待回调结束*/
+        hrtimer_try_cancel(&tick_timers[cpuid()]);
+        return;
+    }
+    hrtimer_start(&tick_timers[cpuid()], next);
+}
+/**
+ * @brief 定时器中断处理函数：统计相对比较器编程值的延迟和处理耗时
+ *
  */
 void timer_interrupt_handler(void)
 {
-    /* 更新时钟tick*/
-    feed_timer();
+    uint64_t deadline = cpu_this.cpu_next_event;
+    uint64_t start = read_rdtime();
+    if (deadline != 0 && deadline != TIMER_EVENT_NONE && start >= deadline)
+    {
+        trapstat_record(&trapstat_this.tc_timer_late, start - deadline);
+    }
+    hrtimer_interrupt();
+    trapstat_record(&trapstat_this.tc_timer, read_rdtime() - start);
 }
 /**
  * @brief 启动定时器
@@ -38,4 +162,4 @@ void enable_timer_interrupt(void)
     asm volatile("csrr %0, sie" : "=r"(sie));
     sie |= (1 << 5); // STIE 是第 5 位
     asm volatile("csrw sie, %0" : : "r"(sie));
-}
\ No newline at end of file
+}
@@ -0,0 +1,340 @@
+#include "common/types.h"
+#include "lib/rbtree.h"
+
+/**
+ * @brief 节点颜色(空节点为黑色)
+ *
+ * @param node
+ * @return uint8_t
+ */
+static inline uint8_t rb_color(const rb_node_t *node)
+{
+    return node == NULL ? RB_BLACK : node->rb_color;
+}
+/**
+ * @brief 用v替换u在父节点中的位置
+ *
+ * @param root
+ * @param u
+ * @param v 可以为NULL
+ */
+static void rb_transplant(rb_root_t *root, rb_node_t *u, rb_node_t *v)
+{
+    if (u->rb_parent == NULL)
+    {
+        root->rb_node = v;
+    }
+    else if (u == u->rb_parent->rb_left)
+    {
+        u->rb_parent->rb_left = v;
+    }
+    else
+    {
+        u->rb_parent->rb_right = v;
+    }
+    if (v != NULL)
+    {
+        v->rb_parent = u->rb_parent;
+    }
+}
+/**
+ * @brief 左旋：x的右子节点成为x的父节点
+ *
+ * @param root
+ * @param x
+ */
+static void rb_rotate_left(rb_root_t *root, rb_node_t *x)
+{
+    rb_node_t *y = x->rb_right;
+    x->rb_right = y->rb_left;
+    if (y->rb_left != NULL)
+    {
+        y->rb_left->rb_parent = x;
+    }
+    rb_transplant(root, x, y);
+    y->rb_left = x;
+    x->rb_parent = y;
+}
+/**
+ * @brief 右旋：x的左子节点成为x的父节点
+ *
+ * @param root
+ * @param x
+ */
+static void rb_rotate_right(rb_root_t *root, rb_node_t *x)
+{
+    rb_node_t *y = x->rb_left;
+    x->rb_left = y->rb_right;
+    if (y->rb_right != NULL)
+    {
+        y->rb_right->rb_parent = x;
+    }
+    rb_transplant(root, x, y);
+    y->rb_right = x;
+    x->rb_parent = y;
+}
+/**
+ * @brief 插入节点
+ *
+ * @param root
+ * @param node 待插入节点
+ * @param less 比较函数：a < b时返回true
+ */
+void rb_insert(rb_root_t *root, rb_node_t *node, bool (*less)(const rb_node_t *, const rb_node_t *))
+{
+    rb_node_t *parent = NULL;
+    rb_node_t **link = &root->rb_node;
+    bool leftmost = true;
+    while (*link != NULL)
+    {
+        parent = *link;
+        if (less(node, parent))
+        {
+            link = &parent->rb_left;
+        }
+        else
+        {
+            link = &parent->rb_right;
+            leftmost = false;
+        }
+    }
+    node->rb_parent = parent;
+    node->rb_left = NULL;
+    node->rb_right = NULL;
+    node->rb_color = RB_RED;
+    *link = node;
+    if (leftmost)
+    {
+        root->rb_leftmost = node;
+    }
+
+    /* 修复连续的红色节点*/
+    rb_node_t *z = node;
+    rb_node_t *p;
+    while ((p = z->rb_parent) != NULL && p->rb_color == RB_RED)
+    {
+        rb_node_t *g = p->rb_parent;
+        if (p == g->rb_left)
+        {
+            rb_node_t *u = g->rb_right;
+            if (rb_color(u) == RB_RED)
+            {
+                p->rb_color = RB_BLACK;
+                u->rb_color = RB_BLACK;
+                g->rb_color = RB_RED;
+                z = g;
+                continue;
+            }
+            if (z == p->rb_right)
+            {
+                rb_rotate_left(root, p);
+                z = p;
+                p = z->rb_parent;
+            }
+            p->rb_color = RB_BLACK;
+            g->rb_color = RB_RED;
+            rb_rotate_right(root, g);
+        }
+        else
+        {
+            rb_node_t *u = g->rb_left;
+            if (rb_color(u) == RB_RED)
+            {
+                p->rb_color = RB_BLACK;
+                u->rb_color = RB_BLACK;
+                g->rb_color = RB_RED;
+                z = g;
+                continue;
+            }
+            if (z == p->rb_left)
+            {
+                rb_rotate_right(root, p);
+                z = p;
+                p = z->rb_parent;
+            }
+            p->rb_color = RB_BLACK;
+            g->rb_color = RB_RED;
+            rb_rotate_left(root, g);
+        }
+    }
+    root->rb_node->rb_color = RB_BLACK;
+}
+/**
+ * @brief 删除黑色节点后修复黑高
+ *
+ * @param root
+ * @param x 替代被删除节点的节点(可以为NULL)
+ * @param parent x的父节点
+ */
+static void rb_erase_fixup(rb_root_t *root, rb_node_t *x, rb_node_t *parent)
+{
+    while (x != root->rb_node && rb_color(x) == RB_BLACK)
+    {
+        if (x == parent->rb_left)
+        {
+            rb_node_t *w = parent->rb_right;
+            if (w->rb_color == RB_RED)
+            {
+                w->rb_color = RB_BLACK;
+                parent->rb_color = RB_RED;
+                rb_rotate_left(root, parent);
+                w = parent->rb_right;
+            }
+            if (rb_color(w->rb_left) == RB_BLACK && rb_color(w->rb_right) == RB_BLACK)
+            {
+                w->rb_color = RB_RED;
+                x = parent;
+                parent = x->rb_parent;
+                continue;
+            }
+            if (rb_color(w->rb_right) == RB_BLACK)
+            {
+                w->rb_left->rb_color = RB_BLACK;
+                w->rb_color = RB_RED;
+                rb_rotate_right(root, w);
+                w = parent->rb_right;
+            }
+            w->rb_color = parent->rb_color;
+            parent->rb_color = RB_BLACK;
+            w->rb_right->rb_color = RB_BLACK;
+            rb_rotate_left(root, parent);
+        }
+        else
+        {
+            rb_node_t *w = parent->rb_left;
+            if (w->rb_color == RB_RED)
+            {
+                w->rb_color = RB_BLACK;
+                parent->rb_color = RB_RED;
+                rb_rotate_right(root, parent);
+                w = parent->rb_left;
+            }
+            if (rb_color(w->rb_left) == RB_BLACK && rb_color(w->rb_right) == RB_BLACK)
+            {
+                w->rb_color = RB_RED;
+                x = parent;
+                parent = x->rb_parent;
+                continue;
+            }
+            if (rb_color(w->rb_left) == RB_BLACK)
+            {
+                w->rb_right->rb_color = RB_BLACK;
+                w->rb_color = RB_RED;
+                rb_rotate_left(root, w);
+                w = parent->rb_left;
+            }
+            w->rb_color = parent->rb_color;
+            parent->rb_color = RB_BLACK;
+            w->rb_left->rb_color = RB_BLACK;
+            rb_rotate_right(root, parent);
+        }
+        x = root->rb_node;
+        break;
+    }
+    if (x != NULL)
+    {
+        x->rb_color = RB_BLACK;
+    }
+}
+/**
+ * @brief 删除节点
+ *
+ * @param root
+ * @param node 树中的节点
+ */
+void rb_erase(rb_root_t *root, rb_node_t *node)
+{
+    if (root->rb_leftmost == node)
+    {
+        root->rb_leftmost = rb_next(node);
+    }
+    rb_node_t *x;
+    rb_node_t *parent;
+    uint8_t color = node->rb_color;
+    if (node->rb_left == NULL)
+    {
+        x = node->rb_right;
+        parent = node->rb_parent;
+        rb_transplant(root, node, node->rb_right);
+    }
+    else if (node->rb_right == NULL)
+    {
+        x = node->rb_left;
+        parent = node->rb_parent;
+        rb_transplant(root, node, node->rb_left);
+    }
+    else
+    {
+        /* 用后继节点y替换node*/
+        rb_node_t *y = node->rb_right;
+        while (y->rb_left != NULL)
+        {
+            y = y->rb_left;
+        }
+        color = y->rb_color;
+        x = y->rb_right;
+        if (y->rb_parent == node)
+        {
+            parent = y;
+        }
+        else
+        {
+            parent = y->rb_parent;
+            rb_transplant(root, y, y->rb_right);
+            y->rb_right = node->rb_right;
+            y->rb_right->rb_parent = y;
+        }
+        rb_transplant(root, node, y);
+        y->rb_left = node->rb_left;
+        y->rb_left->rb_parent = y;
+        y->rb_color = node->rb_color;
+    }
+    if (color == RB_BLACK)
+    {
+        rb_erase_fixup(root, x, parent);
+    }
+}
+/**
+ * @brief 中序遍历的下一个节点
+ *
+ * @param node
+ * @return rb_node_t* 没有后继时返回NULL
+ */
+rb_node_t *rb_next(const rb_node_t *node)
+{
+    if (node->rb_right != NULL)
+    {
+        node = node->rb_right;
+        while (node->rb_left != NULL)
+        {
+            node = node->rb_left;
+        }
+        return (rb_node_t *)node;
+    }
+    rb_node_t *parent = node->rb_parent;
+    while (parent != NULL && node == parent->rb_right)
+    {
+        node = parent;
+        parent = node->rb_parent;
+    }
+    return parent;
+}
+/**
+ * @brief 最大节点
+ *
+ * @param root
+ * @return rb_node_t*
+ */
+rb_node_t *rb_last(const rb_root_t *root)
+{
+    rb_node_t *node = root->rb_node;
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    while (node->rb_right != NULL)
+    {
+        node = node->rb_right;
+    }
+    return node;
+}
@@ -95,4 +95,22 @@ void *memset(void *dst, int32_t c, uint64_t n)
         }
     }
     return dst;
-}
\ No newline at end of file
+}
+/**
+ * @brief 
+ * 
+ * @param dest 
+ * @param src 
+ * @param count 
+ * @return void* 
+ */
+void *memcpy(void *dest, const void *src, uint64_t count)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    while (count--)
+    {
+        *d++ = *s++;
+    }
+    return dest;
+}
@@ -0,0 +1,217 @@
+#include "common/types.h"
+#include "common/rv64.h"
+#include "lock/mutex.h"
+#include "lock/lockstat.h"
+#include "lib/list.h"
+#include "lib/printf.h"
+#include "lib/string.h"
+#include "cpu/cpu.h"
+
+#ifdef JAEOS_LOCKSTAT
+/**
+ * @brief 所有已初始化mutex组成的统计链表
+ *        mutex自身不能用于保护该链表，使用原子标志作为自旋锁
+ */
+static LIST_HEAD(mutex_t) lockstat_list;
+static uint32_t lockstat_list_locked;
+
+/**
+ * @brief 将mutex加入统计链表(mutex_init调用)
+ *
+ * @param m
+ */
+void lockstat_register(mutex_t *m)
+{
+    if (m->mutex_stat.ls_registered)
+    {
+        return;
+    }
+    register_t sie = disable_si();
+    while (__atomic_exchange_n(&lockstat_list_locked, 1, __ATOMIC_ACQUIRE))
+        ;
+    m->mutex_stat.ls_registered = true;
+    LIST_INSERT_HEAD_RCU(&lockstat_list, m, mutex_statlink);
+    __atomic_store_n(&lockstat_list_locked, 0, __ATOMIC_RELEASE);
+    restore_si(sie);
+}
+/**
+ * @brief 记录一次锁获取(持有锁时调用)
+ *
+ * @param m
+ * @param wait 自旋等待时间
+ * @param contended 是否发生竞争
+ */
+void lockstat_acquired(mutex_t *m, uint64_t wait, bool contended)
+{
+    lockstat_t *ls = &m->mutex_stat;
+    ls->ls_acquired++;
+    if (contended)
+    {
+        ls->ls_contended++;
+        ls->ls_wait_total += wait;
+        if (wait > ls->ls_wait_max)
+        {
+            ls->ls_wait_max = wait;
+        }
+    }
+    ls->ls_hold_start = read_rdtime();
+}
+/**
+ * @brief 记录一次锁释放(仍持有锁时调用)
+ *
+ * @param m
+ */
+void lockstat_released(mutex_t *m)
+{
+    lockstat_t *ls = &m->mutex_stat;
+    uint64_t hold = read_rdtime() - ls->ls_hold_start;
+    ls->ls_hold_total += hold;
+    if (hold > ls->ls_hold_max)
+    {
+        ls->ls_hold_max = hold;
+    }
+}
+/**
+ * @brief 当前核心开始关中断
+ *
+ */
+void lockstat_irqoff_begin(void)
+{
+    cpu_this.irqoff_start = read_rdtime();
+}
+/**
+ * @brief 当前核心即将开中断，更新最长关中断时间
+ *
+ */
+void lockstat_irqoff_end(void)
+{
+    uint64_t irqoff = read_rdtime() - cpu_this.irqoff_start;
+    if (irqoff > cpu_this.irqoff_max)
+    {
+        cpu_this.irqoff_max = irqoff;
+    }
+}
+/**
+ * @brief 判断a是否比b更值得关注(竞争次数优先，其次累计等待时间)
+ *
+ */
+static bool lockstat_hotter(mutex_t *a, mutex_t *b)
+{
+    if (a->mutex_stat.ls_contended != b->mutex_stat.ls_contended)
+    {
+        return a->mutex_stat.ls_contended > b->mutex_stat.ls_contended;
+    }
+    return a->mutex_stat.ls_wait_total > b->mutex_stat.ls_wait_total;
+}
+/**
+ * @brief 按竞争次数降序取出最热的LOCKSTAT_DUMP_MAX个锁
+ *
+ * @param top 输出
+ * @return int32_t 锁数量
+ */
+static int32_t lockstat_top(mutex_t *top[LOCKSTAT_DUMP_MAX])
+{
+    int32_t n = 0;
+    mutex_t *m;
+
+    /* 插入排序，只保留最热的LOCKSTAT_DUMP_MAX个锁*/
+    LIST_FOREACH_RCU(m, &lockstat_list, mutex_statlink)
+    {
+        if (m->mutex_stat.ls_acquired == 0)
+        {
+            continue;
+        }
+        int32_t i = n < LOCKSTAT_DUMP_MAX ? n++ : LOCKSTAT_DUMP_MAX;
+        while (i > 0 && lockstat_hotter(m, top[i - 1]))
+        {
+            if (i < LOCKSTAT_DUMP_MAX)
+            {
+                top[i] = top[i - 1];
+            }
+            i--;
+        }
+        if (i < LOCKSTAT_DUMP_MAX)
+        {
+            top[i] = m;
+        }
+    }
+    return n;
+}
+/**
+ * @brief 按竞争次数降序输出锁统计信息以及每个核心的最长关中断时间
+ *
+ */
+void lockstat_dump(void)
+{
+    mutex_t *top[LOCKSTAT_DUMP_MAX];
+    int32_t n = lockstat_top(top);
+
+    printf("[JaeOS]Lock Statistics (rdtime cycles):\n");
+    printf("       %-20s %10s %10s %12s %10s %12s %10s\n", "name", "acquired", "contended", "wait-total", "wait-max", "hold-total", "hold-max");
+    for (int32_t i = 0; i < n; i++)
+    {
+        lockstat_t *ls = &top[i]->mutex_stat;
+        printf("       %-20s %10lu %10lu %12lu %10lu %12lu %10lu\n", top[i]->mutex_name,
+               ls->ls_acquired, ls->ls_contended, ls->ls_wait_total, ls->ls_wait_max, ls->ls_hold_total, ls->ls_hold_max);
+    }
+    for (int32_t i = 0; i < NCPU; i++)
+    {
+        if (cpu_online_mask & (1ul << i))
+        {
+            printf("       [CPU%d]Max Interrupts-off Window: %lu\n", i, cpus[i].irqoff_max);
+        }
+    }
+}
+/**
+ * @brief 按竞争次数降序读取锁统计记录(trapstat系统调用)
+ *
+ * @param recs 输出
+ * @param max recs能容纳的记录数
+ * @return int32_t 写入的记录数(不超过LOCKSTAT_DUMP_MAX)
+ */
+int32_t lockstat_read(lockstat_record_t *recs, int32_t max)
+{
+    mutex_t *top[LOCKSTAT_DUMP_MAX];
+    int32_t n = lockstat_top(top);
+    n = n < max ? n : max;
+    for (int32_t i = 0; i < n; i++)
+    {
+        lockstat_t *ls = &top[i]->mutex_stat;
+        lockstat_record_t *r = &recs[i];
+        memset(r->lr_name, 0, LOCKSTAT_NAME_LEN);
+        for (int32_t j = 0; j < LOCKSTAT_NAME_LEN - 1 && top[i]->mutex_name[j]; j++)
+        {
+            r->lr_name[j] = top[i]->mutex_name[j];
+        }
+        r->lr_acquired = ls->ls_acquired;
+        r->lr_contended = ls->ls_contended;
+        r->lr_wait_total = ls->ls_wait_total;
+        r->lr_wait_max = ls->ls_wait_max;
+        r->lr_hold_total = ls->ls_hold_total;
+        r->lr_hold_max = ls->ls_hold_max;
+    }
+    return n;
+}
+/**
+ * @brief 清空所有统计信息
+ *
+ */
+void lockstat_reset(void)
+{
+    mutex_t *m;
+    LIST_FOREACH_RCU(m, &lockstat_list, mutex_statlink)
+    {
+        lockstat_t *ls = &m->mutex_stat;
+        ls->ls_acquired = 0;
+        ls->ls_contended = 0;
+        ls->ls_wait_total = 0;
+        ls->ls_wait_max = 0;
+        ls->ls_hold_total = 0;
+        ls->ls_hold_max = 0;
+    }
+    for (int32_t i = 0; i < NCPU; i++)
+    {
+        cpus[i].irqoff_max = 0;
+    }
+}
+#endif
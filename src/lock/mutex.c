@@ -2,6 +2,7 @@
 #include "lock/mutex.h"
 #include "common/rv64.h"
 #include "cpu/cpu.h"
+#include "lock/lockstat.h"
 mutex_t first_thread_lock; /* 保护第一个线程的创建过程*/
 mutex_t td_tid_lock;	   /* 保护线程ID的分配与回收*/
 mutex_t wait_lock;		   /* 等待锁:保证父进程等待和子进程退出按顺序依次发生*/
@@ -9,11 +10,16 @@ mutex_t pid_lock;		   /* 保护进程ID的分配与回收*/
 mutex_t pr_lock;		   /* printf输出语句锁*/
 mutex_t kvm_lock;		   /* 虚拟内存映射锁*/
 mutex_t sigevent_lock;	   /* 信号事件锁*/
+mutex_t rcu_lock;		   /* RCU宽限期状态锁*/
+mutex_t dl_bw_lock;		   /* 截止时间调度类带宽统计锁*/
+mutex_t uring_lock;		   /* 提交/完成队列创建与超时事件池锁*/
+mutex_t irq_lock;		   /* 外部中断注册与路由锁*/
+mutex_t sighand_lock;	   /* 信号动作表锁*/
 
 mutex_t *mutexs; /* 进程与线程使用的mutex数组(每个进程或线程对应其中一个mutex)*/
 /**
- * @brief 进入临界区：关闭中断，获取锁
- *        不支持多核心
+ * @brief 进入临界区：关闭中断，记录锁
+ *
  * @param m
  */
 static void mutex_enter_critical(mutex_t *m)
@@ -30,6 +36,11 @@ static void mutex_enter_critical(mutex_t *m)
 	if (cpu_this.mutex_depth == 0)
 	{
 		cpu_this.sstatus = pre_sie;
+		if (pre_sie)
+		{
+			/* 关中断窗口开始*/
+			lockstat_irqoff_begin();
+		}
 	}
 	/* 记录锁*/
 	cpu_this.mutexs[cpu_this.mutex_depth] = m;
@@ -56,22 +67,33 @@ static void mutex_leave_critical(mutex_t *m)
 		while (1)
 			;
 	}
-	/* 获取待解锁*/
-	if (cpu_this.mutexs[cpu_this.mutex_depth - 1] == m)
+	/* 获取待解锁：sleep()需要在持有线程锁时释放外层锁，因此允许不按顺序释放*/
+	int64_t i = cpu_this.mutex_depth - 1;
+	while (i >= 0 && cpu_this.mutexs[i] != m)
 	{
-		/* 获取成功*/
-		cpu_this.mutexs[cpu_this.mutex_depth - 1] = NULL;
+		i--;
 	}
-	else
+	if (i < 0)
 	{
-		/* 锁没有按顺序释放：error*/
+		/* 释放未持有的锁：error*/
 		while (1)
 			;
 	}
+	/* 移除该锁，上层的锁依次下移*/
+	for (; i < (int64_t)cpu_this.mutex_depth - 1; i++)
+	{
+		cpu_this.mutexs[i] = cpu_this.mutexs[i + 1];
+	}
+	cpu_this.mutexs[cpu_this.mutex_depth - 1] = NULL;
 	/* 更新锁的深度*/
 	cpu_this.mutex_depth--;
 	if (cpu_this.mutex_depth == 0)
 	{
+		if (cpu_this.sstatus)
+		{
+			/* 关中断窗口结束*/
+			lockstat_irqoff_end();
+		}
 		restore_si(cpu_this.sstatus);
 	}
 }
@@ -91,9 +113,38 @@ void mutex_init(mutex_t *m, char *m_name, uint8_t m_type)
 			;
 	}
 	m->mutex_name = (uint8_t *)m_name;
+	m->mutex_locked = 0;
 	m->mutex_owner = NULL;
 	m->mutex_type = m_type;
 	m->mutex_depth = 0;
+	/* 加入锁统计链表*/
+	lockstat_register(m);
+}
+/**
+ * @brief 自旋获取锁：mutex_locked记录持有锁的核心(hartid + 1)，0表示空闲
+ *
+ * @param m
+ * @param self 当前核心的标识
+ */
+static void mutex_spin_acquire(mutex_t *m, uint64_t self)
+{
+	uint64_t expected = 0;
+	uint64_t wait_start = 0;
+	bool contended = false;
+	while (!__atomic_compare_exchange_n(&m->mutex_locked, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	{
+		if (!contended)
+		{
+			/* 锁被其他核心持有：记录等待开始时间*/
+			contended = true;
+			wait_start = read_rdtime();
+		}
+		/* 只读自旋，避免反复写缓存行*/
+		while (__atomic_load_n(&m->mutex_locked, __ATOMIC_RELAXED) != 0)
+			;
+		expected = 0;
+	}
+	lockstat_acquired(m, contended ? read_rdtime() - wait_start : 0, contended);
 }
 /**
  * @brief 自旋锁加锁(互斥锁mutex)
@@ -107,25 +158,24 @@ void mutex_lock(mutex_t *m)
 	{
 		/* 进入临界区*/
 		mutex_enter_critical(m);
-		/* 判断当前锁是否支持重入*/
-		if (m->mutex_type & MUTEX_RECURSE)
+		uint64_t self = cpuid() + 1;
+		/* 判断当前核心是否已经持有该锁*/
+		if (__atomic_load_n(&m->mutex_locked, __ATOMIC_RELAXED) == self)
 		{
-			/* 增加重入深度，不在此退出临界区*/
-			m->mutex_depth++;
-		}
-		else
-		{
-			/* 不支持重入：判断当前锁是否可以获取*/
-			if (m->mutex_depth == 1)
+			if (m->mutex_type & MUTEX_RECURSE)
 			{
-				/* 不能重入，离开临界区*/
-				mutex_leave_critical(m);
-				while (1)
-					;
+				/* 增加重入深度，不在此退出临界区*/
+				m->mutex_depth++;
+				return;
 			}
-			/* 获取自旋锁*/
-			m->mutex_depth = 1;
+			/* 不能重入，离开临界区*/
+			mutex_leave_critical(m);
+			while (1)
+				;
 		}
+		/* 获取自旋锁*/
+		mutex_spin_acquire(m, self);
+		m->mutex_depth = 1;
 	}
 	else
 	{
@@ -164,6 +214,9 @@ void mutex_unlock(mutex_t *m)
 		{
 			/* 非重入*/
 			m->mutex_depth = 0;
+			lockstat_released(m);
+			/* 释放自旋锁：之前的写操作先于解锁可见*/
+			__atomic_store_n(&m->mutex_locked, 0, __ATOMIC_RELEASE);
 			/* 离开临界区*/
 			mutex_leave_critical(m);
 		}
@@ -0,0 +1,272 @@
+#include "common/types.h"
+#include "common/atomic.h"
+#include "lock/rcu.h"
+#include "lock/mutex.h"
+#include "cpu/cpu.h"
+#include "cpu/smp.h"
+#include "process/sched.h"
+#include "dev/timer.h"
+
+/**
+ * @brief RCU全局状态(受rcu_lock保护)
+ *        rs_gp_seq == rs_gp_completed时没有正在进行的宽限期
+ */
+typedef struct
+{
+    uint64_t rs_gp_seq;       /* 最近一次启动的宽限期编号*/
+    uint64_t rs_gp_completed; /* 最近一次完成的宽限期编号*/
+    uint64_t rs_qs_mask;      /* 当前宽限期中尚未报告静止状态的核心位图*/
+    uint64_t rs_idle_mask;    /* 处于空闲(扩展静止状态)的核心位图，宽限期不等待这些核心*/
+} rcu_state_t;
+
+/**
+ * @brief 每个核心的RCU数据(回调链表只由所属核心访问)
+ *
+ */
+typedef struct
+{
+    uint64_t rd_qs_gp;      /* 本核心已报告静止状态的宽限期编号*/
+    rcu_head_t *rd_cbhead;  /* 回调链表头(按rh_gp递增排列)*/
+    rcu_head_t **rd_cbtail; /* 回调链表尾部next字段的地址*/
+} rcu_data_t;
+
+static rcu_state_t rcu_state;
+static rcu_data_t rcu_datas[NCPU];
+
+/**
+ * @brief RCU初始化
+ *
+ */
+void rcu_init(void)
+{
+    mutex_init(&rcu_lock, "rcu_lock", MUTEX_TYPE_SPIN);
+    rcu_state.rs_gp_seq = 0;
+    rcu_state.rs_gp_completed = 0;
+    rcu_state.rs_qs_mask = 0;
+    rcu_state.rs_idle_mask = 0;
+    for (int i = 0; i < NCPU; i++)
+    {
+        rcu_datas[i].rd_qs_gp = 0;
+        rcu_datas[i].rd_cbhead = NULL;
+        rcu_datas[i].rd_cbtail = &rcu_datas[i].rd_cbhead;
+    }
+}
+/**
+ * @brief 清除核心在当前宽限期中的等待位，全部清除时宽限期结束(需持有rcu_lock)
+ *
+ * @param cpu
+ */
+static void rcu_report_qs(uint64_t cpu)
+{
+    if (rcu_state.rs_gp_completed != rcu_state.rs_gp_seq)
+    {
+        rcu_state.rs_qs_mask &= ~(1ul << cpu);
+        if (rcu_state.rs_qs_mask == 0)
+        {
+            /* 所有核心都经过了静止状态，宽限期结束*/
+            WRITE_ONCE(rcu_state.rs_gp_completed, rcu_state.rs_gp_seq);
+        }
+    }
+}
+/**
+ * @brief 启动一个新的宽限期，返回能够覆盖当前所有读者的宽限期编号(需持有rcu_lock)
+ *        若已有宽限期正在进行，部分核心可能已经报告过静止状态，因此需要等待下一个宽限期
+ *        空闲核心不参与宽限期；停止了tick的核心通过IPI恢复tick以报告静止状态
+ *
+ * @return uint64_t
+ */
+static uint64_t rcu_gp_target(void)
+{
+    if (rcu_state.rs_gp_completed == rcu_state.rs_gp_seq)
+    {
+        /* 没有正在进行的宽限期，立即启动*/
+        uint64_t mask = READ_ONCE(cpu_online_mask) & ~rcu_state.rs_idle_mask;
+        rcu_state.rs_qs_mask = mask;
+        WRITE_ONCE(rcu_state.rs_gp_seq, rcu_state.rs_gp_seq + 1);
+        if (mask == 0)
+        {
+            WRITE_ONCE(rcu_state.rs_gp_completed, rcu_state.rs_gp_seq);
+        }
+        for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+        {
+            if ((mask & (1ul << cpu)) && READ_ONCE(cpus[cpu].cpu_tick_stopped))
+            {
+                smp_send_tick(cpu);
+            }
+        }
+        return rcu_state.rs_gp_seq;
+    }
+    /* 下一个宽限期在当前宽限期结束后由rcu_check_callbacks启动*/
+    return rcu_state.rs_gp_seq + 1;
+}
+/**
+ * @brief 报告当前核心经过了一个静止状态
+ *        调用时机：上下文切换、陷阱返回、时钟中断
+ *
+ */
+void rcu_note_qs(void)
+{
+    /* 仍处于读临界区，不是静止状态*/
+    if (cpu_this.rcu_nesting)
+    {
+        return;
+    }
+    rcu_data_t *rd = &rcu_datas[cpuid()];
+    uint64_t gp_seq = READ_ONCE(rcu_state.rs_gp_seq);
+    /* 快速路径：本核心已经报告过当前宽限期*/
+    if (rd->rd_qs_gp == gp_seq)
+    {
+        return;
+    }
+    mutex_lock(&rcu_lock);
+    rcu_report_qs(cpuid());
+    rd->rd_qs_gp = rcu_state.rs_gp_seq;
+    mutex_unlock(&rcu_lock);
+}
+/**
+ * @brief 核心进入空闲(需关闭中断)：空闲期间不可能处于读临界区，视为扩展静止状态
+ *        报告正在进行的宽限期，之后启动的宽限期不等待本核心，空闲核心可以停止tick
+ */
+void rcu_idle_enter(void)
+{
+    rcu_data_t *rd = &rcu_datas[cpuid()];
+    mutex_lock(&rcu_lock);
+    rcu_state.rs_idle_mask |= (1ul << cpuid());
+    rcu_report_qs(cpuid());
+    rd->rd_qs_gp = rcu_state.rs_gp_seq;
+    mutex_unlock(&rcu_lock);
+}
+/**
+ * @brief 核心离开空闲(需关闭中断)，空闲期间启动的宽限期不需要本核心报告
+ *
+ */
+void rcu_idle_exit(void)
+{
+    rcu_data_t *rd = &rcu_datas[cpuid()];
+    mutex_lock(&rcu_lock);
+    rcu_state.rs_idle_mask &= ~(1ul << cpuid());
+    rd->rd_qs_gp = rcu_state.rs_gp_seq;
+    mutex_unlock(&rcu_lock);
+}
+/**
+ * @brief 当前核心是否还需要时钟中断推进RCU(存在回调或宽限期在等待本核心)
+ *
+ * @return bool
+ */
+bool rcu_pending(void)
+{
+    rcu_data_t *rd = &rcu_datas[cpuid()];
+    if (rd->rd_cbhead != NULL)
+    {
+        return true;
+    }
+    return rd->rd_qs_gp != READ_ONCE(rcu_state.rs_gp_seq);
+}
+/**
+ * @brief 时钟中断中调用：报告静止状态，执行宽限期已经结束的回调
+ *
+ */
+void rcu_check_callbacks(void)
+{
+    rcu_data_t *rd = &rcu_datas[cpuid()];
+    rcu_note_qs();
+    if (rd->rd_cbhead == NULL)
+    {
+        return;
+    }
+
+    /* 摘下所有已就绪的回调(链表按rh_gp递增排列)*/
+    rcu_head_t *ready = NULL;
+    rcu_head_t **ready_tail = &ready;
+    register_t sie = disable_si();
+    uint64_t completed = READ_ONCE(rcu_state.rs_gp_completed);
+    while (rd->rd_cbhead != NULL && rd->rd_cbhead->rh_gp <= completed)
+    {
+        rcu_head_t *rh = rd->rd_cbhead;
+        rd->rd_cbhead = rh->rh_next;
+        rh->rh_next = NULL;
+        *ready_tail = rh;
+        ready_tail = &rh->rh_next;
+    }
+    if (rd->rd_cbhead == NULL)
+    {
+        rd->rd_cbtail = &rd->rd_cbhead;
+    }
+    else if (rcu_state.rs_gp_completed == READ_ONCE(rcu_state.rs_gp_seq))
+    {
+        /* 剩余回调需要新的宽限期*/
+        mutex_lock(&rcu_lock);
+        rcu_gp_target();
+        mutex_unlock(&rcu_lock);
+    }
+    restore_si(sie);
+
+    /* 不持有任何锁执行回调*/
+    while (ready != NULL)
+    {
+        rcu_head_t *rh = ready;
+        ready = rh->rh_next;
+        rh->rh_func(rh);
+    }
+}
+/**
+ * @brief 注册回调，宽限期结束后由当前核心执行func(head)
+ *
+ * @param head 嵌入在待释放对象中的rcu_head
+ * @param func 回调函数
+ */
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *))
+{
+    head->rh_func = func;
+    head->rh_next = NULL;
+    /* mutex_lock关闭中断，保证回调链表只被本核心访问*/
+    mutex_lock(&rcu_lock);
+    head->rh_gp = rcu_gp_target();
+    rcu_data_t *rd = &rcu_datas[cpuid()];
+    *rd->rd_cbtail = head;
+    rd->rd_cbtail = &head->rh_next;
+    mutex_unlock(&rcu_lock);
+    if (cpu_this.cpu_tick_stopped)
+    {
+        /* 回调需要tick推进，恢复本核心的tick*/
+        register_t sie = disable_si();
+        timer_reprogram();
+        restore_si(sie);
+    }
+}
+/**
+ * @brief 等待宽限期结束：返回时，调用前进入读临界区的读者都已经离开
+ *        不能在读临界区中调用
+ *
+ */
+void synchronize_rcu(void)
+{
+    if (cpu_this.rcu_nesting)
+    {
+        /* 读临界区中等待宽限期会导致死锁*/
+        while (1)
+            ;
+    }
+    mutex_lock(&rcu_lock);
+    uint64_t target = rcu_gp_target();
+    mutex_unlock(&rcu_lock);
+
+    while (READ_ONCE(rcu_state.rs_gp_completed) < target)
+    {
+        /* 本核心不在读临界区，直接报告静止状态，其他核心在时钟中断中报告*/
+        rcu_note_qs();
+        if (cpu_this.cpu_running != NULL && cpu_this.mutex_depth == 0)
+        {
+            /* 线程上下文中让出CPU，等待其他核心经过静止状态*/
+            yield();
+        }
+        if (READ_ONCE(rcu_state.rs_gp_completed) == READ_ONCE(rcu_state.rs_gp_seq) &&
+            READ_ONCE(rcu_state.rs_gp_seq) < target)
+        {
+            /* 上一个宽限期已经结束，启动目标宽限期*/
+            mutex_lock(&rcu_lock);
+            rcu_gp_target();
+            mutex_unlock(&rcu_lock);
+        }
+    }
+}
@@ -7,9 +7,20 @@
 #include "mmu/vmm.h"
 #include "trap/trap.h"
 #include "dev/timer.h"
+#include "dev/clocksource.h"
 #include "dev/plic.h"
+#include "dev/irq.h"
 #include "process/thread.h"
 #include "process/proc.h"
+#include "cpu/cpu.h"
+#include "lock/rcu.h"
+#include "cpu/smp.h"
+#include "process/sched.h"
+#include "process/tsleep.h"
+#include "process/futex.h"
+#include "process/uring.h"
+#include "process/workqueue.h"
+#include "trap/softirq.h"
 extern char end[]; /* .ld文件中定义的堆起始地址(JaeOS不区分堆栈)*/
 uint64_t hart_id;
 /**
@@ -25,6 +36,9 @@ int main()
     /* 主核hart0*/
     if (hart_id == 0L)
     {
+        /* 主核上线*/
+        cpu_online_mask |= (1ul << hart_id);
+
         /* 初始化串口*/
         uart_init();
         early_printf("\n[JaeOS]UART Init Successful.\n");
@@ -52,10 +66,22 @@ int main()
         vm_enable();
         printf("\n[JaeOS]VM Enable Successful.\n");
 
+        /* 初始化时钟源(依赖设备树和RTC映射)*/
+        clocksource_init();
+        printf("\n[JaeOS]Clocksource Init Successful.\n");
+
         /* 设置异常向量表*/
         set_trap_handle();
         printf("\n[JaeOS]Set Trap Vector Successful.\n");
 
+        /* 初始化核间中断*/
+        smp_init();
+        printf("\n[JaeOS]IPI Init Successful.\n");
+
+        /* 初始化软中断(SOFT定时器在软中断中执行)*/
+        softirq_init();
+        printf("\n[JaeOS]Softirq Init Successful.\n");
+
         /* 定时器初始化*/
         timer_init();
         printf("\n[JaeOS]Timer Init Successful.\n");
@@ -63,18 +89,49 @@ int main()
         /* 初始化PLIC(启动中断)*/
         plic_init(hart_id);
         printf("\n[JaeOS]PLIC Init Successful.\n");
+
+        /* 初始化外部中断注册与路由(依赖hrtimer)*/
+        irq_init();
+        printf("\n[JaeOS]IRQ Init Successful.\n");
         
+        /* 初始化RCU*/
+        rcu_init();
+        printf("\n[JaeOS]RCU Init Successful.\n");
+
         /* 初始化线程*/
         thread_init();
         printf("\n[JaeOS]Thread Init Successful.\n");
 
+        /* 初始化调度器*/
+        sched_init();
+        printf("\n[JaeOS]Scheduler Init Successful.\n");
+
+        /* 初始化睡眠超时时间轮*/
+        tsleep_init();
+        printf("\n[JaeOS]Tsleep Init Successful.\n");
+
+        /* 初始化工作队列，启动本核心的kworker*/
+        workqueue_init();
+        workqueue_cpu_online(hart_id);
+        printf("\n[JaeOS]Workqueue Init Successful.\n");
+
         /* 初始化进程*/
         proc_init();
         printf("\n[JaeOS]Process Init Successful.\n");
 
+        /* 初始化futex*/
+        futex_init();
+        printf("\n[JaeOS]Futex Init Successful.\n");
+
+        /* 初始化提交/完成队列*/
+        uring_init();
+        printf("\n[JaeOS]Uring Init Successful.\n");
+
         /* 初始化信号*/
         signal_init();
         printf("\n[JaeOS]Signal Init Successful.\n");
+        /* 启动从核*/
+        smp_boot_secondary();
         /* Logo打印放到最后*/
         logo_init();
     }
@@ -83,6 +140,25 @@ int main()
     {
         /* not to here*/
     }
-    while (1)
-        ;
+    /* 进入调度循环(不会返回)*/
+    scheduler();
+}
+/**
+ * @brief 从核初始化：共享主核建立的内核页表，上线后进入调度循环
+ *
+ */
+void main_secondary(void)
+{
+    vm_enable();
+    set_trap_handle();
+    timer_init();
+    plic_init(cpuid());
+    __atomic_fetch_or(&cpu_online_mask, 1ul << cpuid(), __ATOMIC_RELEASE);
+    /* 把已注册的外部中断分散到新上线的核心*/
+    irq_balance();
+    workqueue_cpu_online(cpuid());
+    printf("\n[JaeOS]Hart %ld Online.\n", cpuid());
+    /* 主核已经在线，测试修改亲和性时就绪线程的迁移*/
+    sched_affinity_test();
+    scheduler();
 }
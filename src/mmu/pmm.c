@@ -242,9 +242,6 @@ void pmm_init(void)
     /* 全局mutex数组*/
     mutexs = pm_init(freemem_start_addr, (MAX_PROC_NUM + MAX_THREAD_NUM) * sizeof(mutex_t), &freemem_start_addr, "Global Mutex Array");
 
-    /* 全局信号动作数组*/
-    sigactions = pm_init(freemem_start_addr, MAX_THREAD_NUM * MAX_SIGNAL_NUM * sizeof(sigaction_t), &freemem_start_addr, "Global Signal Actions Array");
-
     /* 全局信号事件数组*/
     sigevents = pm_init(freemem_start_addr, MAX_SIGEVENT_NUM * sizeof(sigevent_t), &freemem_start_addr, "Global Signal Event Array");
 
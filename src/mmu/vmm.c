@@ -7,6 +7,10 @@
 #include "lib/printf.h"
 #include "common/rv64.h"
 #include "lock/mutex.h"
+#include "cpu/cpu.h"
+#include "cpu/smp.h"
+#include "common/errno.h"
+#include "lib/string.h"
 /**
  * @brief 内核虚拟地址空间的三级页表(根页表 level 2)对应的物理页地址
  *
@@ -20,21 +24,41 @@ uint64_t kernel_root_pte_va;
 /* .text作为内核代码段*/
 extern char __text_end[]; /* .ld文件中定义的.text段结束地址*/
 /**
- * @brief 刷新所有核心的TLB，只许成功，不许失败
+ * @brief 刷新使用该页表的核心的TLB，只许成功，不许失败
+ *        本核心直接执行sfence.vma，其他核心通过TLB刷新核间中断完成，不再经过M-Mode的rfence调用
+ *        1.内核页表所有在线核心都在使用；用户页表只有正在用户态运行该地址空间的核心需要刷新
+ *          (进入内核时trampoline切换satp并刷新整个TLB，内核态不会残留用户页表的TLB项)
+ *        2.远程刷新会关中断等待其他核心应答，调用时不能持有kvm_lock：
+ *          其他核心可能正关中断自旋等待kvm_lock，无法处理刷新请求
  *
+ * @param pt_address 修改的根页表地址
  * @param va
  */
-void tlb_flush(uint64_t va)
+void tlb_flush(uint64_t pt_address, uint64_t va)
 {
     /* 获取va所在页的起始地址*/
     va = ADDRALIGNDOWN(va, PAGE_SIZE);
-    /* 调用SBI，所有核心刷新TLB*/
-    SBI_RET ret = sbi_rfence_fence_vma((1ull << NCPU) - 1, 0, va, PAGE_SIZE);
-    if (ret.error)
+    /* 刷新本核心TLB*/
+    sfence_vma(va);
+    /* 页表项的修改先于读取cpu_user_pt，与user_trap_return的"先声明页表再切换satp"配对*/
+    smp_mb();
+    uint64_t mask = 0;
+    if (pt_address == kernel_root_pte_pa)
     {
-        while (1)
-            ;
+        mask = READ_ONCE(cpu_online_mask);
     }
+    else
+    {
+        for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+        {
+            if (READ_ONCE(cpus[cpu].cpu_user_pt) == pt_address)
+            {
+                mask |= 1ul << cpu;
+            }
+        }
+    }
+    /* 同步刷新其他核心的TLB*/
+    smp_tlb_shootdown(mask, va, PAGE_SIZE);
 }
 /**
  * @brief 当pte有效且指向合法的物理页时，减少对物理页面的引用计数
@@ -170,9 +194,10 @@ static void pte_modify(pte_t *pte, pte_t value)
  * @param page_table_address 顶级页表的起始地址(第一个pte的地址)
  * @param va
  * @param create_flag
+ * @param created 创建了中间层级页表时置为true，调用者释放kvm_lock后刷新TLB(可以为NULL)
  * @return pte_t*
  */
-static pte_t *walk_page_table(uint64_t page_table_address, uint64_t va, uint64_t create_flag)
+static pte_t *walk_page_table(uint64_t page_table_address, uint64_t va, uint64_t create_flag, bool *created)
 {
     /* 获取顶级页表(页表的第一个pte)*/
     /* 同时，根页表有512个pte*/
@@ -200,8 +225,11 @@ static pte_t *walk_page_table(uint64_t page_table_address, uint64_t va, uint64_t
                 Page *new_page = alloc_k_page();
                 /* 将新的中间层级物理页地址写入当前页表项*/
                 pte_modify(current_pte, Page2Pte(new_page) | PTE_V);
-                /* 刷新tlb*/
-                tlb_flush(va);
+                /* 需要刷新tlb(由调用者在释放kvm_lock后执行)*/
+                if (created != NULL)
+                {
+                    *created = true;
+                }
                 /* 将新页表的物理赋值给current_pt*/
                 current_pt = (pte_t *)Page2Pa(new_page);
             }
@@ -230,7 +258,7 @@ static void map_pa2va(uint64_t pa, uint64_t va, uint64_t len, uint64_t perm)
     /* 按页遍历内存区域*/
     for (uint64_t i = 0; i < len; i += PAGE_SIZE)
     {
-        pte_t *temp_pte = walk_page_table(kernel_root_pte_pa, va + i, true);
+        pte_t *temp_pte = walk_page_table(kernel_root_pte_pa, va + i, true, NULL);
         /* 映射*/
         // early_printf("va = %lx, cnt = %lu\n", va + i, ++cnt);
         *temp_pte = (Pa2Pte(pa + i) | perm | PTE_V);
@@ -246,7 +274,7 @@ static void map_pa2va(uint64_t pa, uint64_t va, uint64_t len, uint64_t perm)
  */
 static pte_t pt_check(uint64_t pt_address, uint64_t va)
 {
-    pte_t *_pte = walk_page_table(pt_address, va, false);
+    pte_t *_pte = walk_page_table(pt_address, va, false, NULL);
     return _pte == NULL ? 0 : *_pte;
 }
 /**
@@ -275,11 +303,8 @@ static void mem_test(void)
  */
 void vm_enable(void)
 {
-    uint64_t satp_mode = 8ul << SATP_MODE_SHIFT;
-    uint64_t satp_ppn = (kernel_root_pte_pa >> PAGE_SHIFT) & PTE_PPN_MASK;
-
     /* 写satp寄存器*/
-    write_satp(satp_mode | satp_ppn);
+    write_satp(make_satp(kernel_root_pte_pa));
 
     /* 刷新TLB(必须的操作，否则会导致旧的TLB缓存未清空，地址翻译错误)*/
     asm volatile("sfence.vma zero, zero");
@@ -346,9 +371,10 @@ void vmm_init(void)
  */
 err_t pt_map(uint64_t pt_address, uint64_t va, uint64_t pa, uint64_t perm)
 {
+    bool created = false;
     mutex_lock(&kvm_lock);
     /* 遍历页表尝试获得va对应的页表项地址(没有则创建)*/
-    pte_t *pte = walk_page_table(pt_address, va, true);
+    pte_t *pte = walk_page_table(pt_address, va, true, &created);
     //printf("vma: %lx, pma: %lx\n", va, pa);
     //printf("pte address:%p, pte val: %lx\n", pte, *pte);
     if (*pte & PTE_V)
@@ -367,7 +393,11 @@ err_t pt_map(uint64_t pt_address, uint64_t va, uint64_t pa, uint64_t perm)
         /* 映射到物理地址0表示：延迟分配物理页，进程实际访问该虚拟地址时才分配物理页*/
         pte_modify(pte, perm);
         mutex_unlock(&kvm_lock);
-        /* 直接返回，不用刷新TLB*/
+        /* 只有新建了中间层级页表时才需要刷新TLB*/
+        if (created)
+        {
+            tlb_flush(pt_address, va);
+        }
         return 0;
     }
     else
@@ -377,8 +407,111 @@ err_t pt_map(uint64_t pt_address, uint64_t va, uint64_t pa, uint64_t perm)
             pte_modify(pte, Pa2Pte(pa) | perm | PTE_V);
     }
 
-    /* 刷新TLB*/
-    tlb_flush(va);
     mutex_unlock(&kvm_lock);
+    /* 释放kvm_lock后再刷新TLB*/
+    tlb_flush(pt_address, va);
+    return 0;
+}
+/**
+ * @brief 取消映射，释放页表项对物理页的引用
+ *
+ * @param pt_address 根页表地址
+ * @param va 虚拟地址
+ */
+void pt_unmap(uint64_t pt_address, uint64_t va)
+{
+    mutex_lock(&kvm_lock);
+    pte_t *pte = walk_page_table(pt_address, va, false, NULL);
+    if (pte == NULL || !(*pte & PTE_V))
+    {
+        mutex_unlock(&kvm_lock);
+        return;
+    }
+    pte_modify(pte, 0);
+    mutex_unlock(&kvm_lock);
+    /* 释放kvm_lock后再刷新TLB*/
+    tlb_flush(pt_address, va);
+}
+/**
+ * @brief 用户虚拟地址转换为物理地址，检查PTE_U和访问权限
+ *
+ * @param pt_address 用户页表根地址
+ * @param va 用户虚拟地址
+ * @param perm 需要的访问权限(PTE_R/PTE_W)
+ * @param pa 返回的物理地址
+ * @return err_t 未映射或权限不足返回-EFAULT
+ */
+err_t pt_user_addr(uint64_t pt_address, uint64_t va, uint64_t perm, uint64_t *pa)
+{
+    if (va > MAX_VMA)
+    {
+        return -EFAULT;
+    }
+    uint64_t need = PTE_V | PTE_U | perm;
+    mutex_lock(&kvm_lock);
+    pte_t *pte = walk_page_table(pt_address, va, false, NULL);
+    pte_t value = pte == NULL ? 0 : *pte;
+    mutex_unlock(&kvm_lock);
+    if ((value & need) != need)
+    {
+        return -EFAULT;
+    }
+    *pa = Pte2Pa(value) + (va & (PAGE_SIZE - 1));
     return 0;
-}
\ No newline at end of file
+}
+/**
+ * @brief 从用户空间拷贝数据到内核(按页查询用户页表，内核直接访问物理地址)
+ *
+ * @param pt_address 用户页表根地址
+ * @param dst 内核地址
+ * @param srcva 用户虚拟地址
+ * @param len
+ * @return err_t 用户地址非法返回-EFAULT
+ */
+err_t copyin(uint64_t pt_address, void *dst, uint64_t srcva, uint64_t len)
+{
+    uint8_t *d = (uint8_t *)dst;
+    while (len > 0)
+    {
+        uint64_t pa;
+        if (pt_user_addr(pt_address, srcva, PTE_R, &pa) < 0)
+        {
+            return -EFAULT;
+        }
+        uint64_t n = PAGE_SIZE - (srcva & (PAGE_SIZE - 1));
+        n = n < len ? n : len;
+        memcpy(d, (const void *)pa, n);
+        d += n;
+        srcva += n;
+        len -= n;
+    }
+    return 0;
+}
+/**
+ * @brief 从内核拷贝数据到用户空间
+ *
+ * @param pt_address 用户页表根地址
+ * @param dstva 用户虚拟地址
+ * @param src 内核地址
+ * @param len
+ * @return err_t 用户地址非法或不可写返回-EFAULT
+ */
+err_t copyout(uint64_t pt_address, uint64_t dstva, const void *src, uint64_t len)
+{
+    const uint8_t *s = (const uint8_t *)src;
+    while (len > 0)
+    {
+        uint64_t pa;
+        if (pt_user_addr(pt_address, dstva, PTE_W, &pa) < 0)
+        {
+            return -EFAULT;
+        }
+        uint64_t n = PAGE_SIZE - (dstva & (PAGE_SIZE - 1));
+        n = n < len ? n : len;
+        memcpy((void *)pa, s, n);
+        s += n;
+        dstva += n;
+        len -= n;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/atomic.h"
+#include "lock/mutex.h"
+#include "mmu/vmm.h"
+#include "process/sched.h"
+#include "process/tsleep.h"
+#include "process/futex.h"
+
+static mutex_t futex_locks[FUTEX_HASH_SIZE]; /* 按futex字的物理地址散列的锁*/
+
+/**
+ * @brief futex初始化
+ *
+ */
+void futex_init(void)
+{
+    for (int i = 0; i < FUTEX_HASH_SIZE; i++)
+    {
+        mutex_init(&futex_locks[i], "futex_lock", MUTEX_TYPE_SPIN);
+    }
+}
+/**
+ * @brief 查找futex字对应的锁
+ *
+ * @param pa futex字的物理地址
+ * @return mutex_t*
+ */
+static inline mutex_t *futex_lock_of(uint64_t pa)
+{
+    return &futex_locks[(pa * 0x9E3779B97F4A7C15ul) >> (64 - FUTEX_HASH_BITS)];
+}
+/**
+ * @brief 用户地址转换为futex字的物理地址(需要4字节对齐)
+ *
+ * @param pt_address
+ * @param uaddr
+ * @param pa
+ * @return err_t
+ */
+static err_t futex_key(uint64_t pt_address, uint64_t uaddr, uint64_t *pa)
+{
+    if (uaddr & (sizeof(uint32_t) - 1))
+    {
+        return -EINVAL;
+    }
+    return pt_user_addr(pt_address, uaddr, PTE_R, pa);
+}
+/**
+ * @brief futex字的值等于val时睡眠，直到被futex_wake唤醒或超时
+ *
+ * @param pt_address 用户页表根地址
+ * @param uaddr futex字的用户地址
+ * @param val 期望值
+ * @param wakeus 唤醒时间(单调时钟微秒)，为0时不超时
+ * @return err_t 值不相等返回-EAGAIN，超时返回-ETIMEDOUT
+ */
+err_t futex_wait(uint64_t pt_address, uint64_t uaddr, uint32_t val, uint64_t wakeus)
+{
+    uint64_t pa;
+    err_t err = futex_key(pt_address, uaddr, &pa);
+    if (err < 0)
+    {
+        return err;
+    }
+    mutex_t *lock = futex_lock_of(pa);
+    mutex_lock(lock);
+    if (READ_ONCE(*(volatile uint32_t *)pa) != val)
+    {
+        mutex_unlock(lock);
+        return -EAGAIN;
+    }
+    err = tsleep((void *)pa, lock, "futex", wakeus);
+    mutex_unlock(lock);
+    return err;
+}
+/**
+ * @brief 唤醒最多nr个在futex字上等待的线程
+ *
+ * @param pt_address 用户页表根地址
+ * @param uaddr futex字的用户地址
+ * @param nr
+ * @return int64_t 唤醒的线程数
+ */
+int64_t futex_wake(uint64_t pt_address, uint64_t uaddr, uint64_t nr)
+{
+    uint64_t pa;
+    err_t err = futex_key(pt_address, uaddr, &pa);
+    if (err < 0)
+    {
+        return err;
+    }
+    mutex_t *lock = futex_lock_of(pa);
+    mutex_lock(lock);
+    uint64_t woken = wakeup_n((void *)pa, nr);
+    mutex_unlock(lock);
+    return (int64_t)woken;
+}
@@ -8,6 +8,7 @@
 #include "mmu/vmm.h"
 #include "mmu/pmm.h"
 #include "lib/printf.h"
+#include "dev/vdso.h"
 
 proc_t *procs = NULL;     /* 全局进程数组*/
 proclist_t proc_freelist; /* 空闲进程链表*/
@@ -42,6 +43,12 @@ void proc_init(void)
         p->p_pt = 0;
         /* 初始化进程的上下文*/
         p->p_trapframe = NULL;
+        /* 提交/完成队列按需创建*/
+        p->p_uring = NULL;
+        /* 进程级待处理信号*/
+        sigemptyset(&p->p_sigpending);
+        TAILQ_INIT(&p->p_sigqueue);
+        p->p_sighand = NULL;
         /* 初始化进程的用户栈*/
         p->p_brk = 0;
         printf("process %d\n", i);
@@ -63,6 +70,10 @@ void proc_upt_init(proc_t *p)
     /* SIGNAL_TRAMPOLINE_VMA*/
     pt_map(p->p_pt, SIGNAL_TRAMPOLINE_VMA, (uint64_t)user_sig_ret, PTE_R | PTE_X | PTE_U);
 
+    /* 用户态时钟：代码页与只读数据页由所有进程共享，用户态读取时间不需要陷入内核*/
+    pt_map(p->p_pt, VDSO_VMA, (uint64_t)vdso_page, PTE_R | PTE_X | PTE_U);
+    pt_map(p->p_pt, VVAR_VMA, (uint64_t)&vvar, PTE_R | PTE_U);
+
     /* 进程的trapframe*/
     uint64_t page_addr = Page2Pa(alloc_k_page());
     p->p_trapframe = (trapframe_t *)page_addr;
@@ -0,0 +1,920 @@
+#include "common/types.h"
+#include "common/rv64.h"
+#include "process/sched.h"
+#include "process/thread.h"
+#include "lock/mutex.h"
+#include "lock/rcu.h"
+#include "cpu/cpu.h"
+#include "lib/queue.h"
+#include "common/atomic.h"
+#include "common/errno.h"
+#include "cpu/smp.h"
+#include "dev/timer.h"
+#include "lib/printf.h"
+
+static runq_t runqs[NCPU];
+
+/* 调度类按优先级从高到低排列*/
+static const sched_class_t *const sched_classes[] = {
+    &dl_sched_class,
+    &rt_sched_class,
+    &fair_sched_class,
+};
+#define SCHED_NR_CLASSES (sizeof(sched_classes) / sizeof(sched_classes[0]))
+
+/**
+ * @brief 线程所属调度类的序号(越小优先级越高)
+ *
+ * @param td
+ * @return uint64_t
+ */
+static uint64_t sched_class_rank(thread_t *td)
+{
+    if (td->td_policy == SCHED_DEADLINE)
+    {
+        return 0;
+    }
+    if (td->td_policy == SCHED_FIFO || td->td_policy == SCHED_RR)
+    {
+        return 1;
+    }
+    return 2;
+}
+/**
+ * @brief 调度器初始化
+ *
+ */
+void sched_init(void)
+{
+    for (int i = 0; i < NCPU; i++)
+    {
+        runq_t *rq = &runqs[i];
+        mutex_init(&rq->rq_lock, "runq", MUTEX_TYPE_SPIN);
+        rq->rq_cpu = i;
+        rq->rq_nr = 0;
+        rq->rq_rt_bitmap = 0;
+        for (int j = 0; j < RT_PRIO_LEVELS; j++)
+        {
+            TAILQ_INIT(&rq->rq_rt_queue[j]);
+        }
+        rb_init(&rq->rq_fair_root);
+        rq->rq_fair_nr = 0;
+        rq->rq_fair_load = 0;
+        rq->rq_min_vruntime = 0;
+        rb_init(&rq->rq_dl_root);
+        TAILQ_INIT(&rq->rq_dl_throttled);
+    }
+    sched_dl_init();
+}
+/**
+ * @brief 核心的负载：就绪线程数量加上正在运行的线程
+ *
+ * @param cpu
+ * @return uint64_t
+ */
+static uint64_t runq_load(uint64_t cpu)
+{
+    return READ_ONCE(runqs[cpu].rq_nr) + (READ_ONCE(cpus[cpu].cpu_running) != NULL);
+}
+/**
+ * @brief 为被唤醒的线程选择核心
+ *        优先选择线程上次运行的核心(缓存亲和)，该核心过载时选择负载最低的核心
+ *
+ * @param td
+ * @return uint64_t
+ */
+static uint64_t sched_select_cpu(thread_t *td)
+{
+    uint64_t allowed = td->td_affinity & READ_ONCE(cpu_online_mask);
+    if (allowed == 0)
+    {
+        /* 亲和的核心都不在线，留在当前核心*/
+        return cpuid();
+    }
+    uint64_t best = NCPU;
+    uint64_t best_load = ~0ul;
+    for (uint64_t i = 0; i < NCPU; i++)
+    {
+        if (!(allowed & (1ul << i)))
+        {
+            continue;
+        }
+        uint64_t load = runq_load(i);
+        if (load < best_load)
+        {
+            best = i;
+            best_load = load;
+        }
+    }
+    uint64_t last = td->td_lastcpu;
+    if (last < NCPU && (allowed & (1ul << last)) &&
+        runq_load(last) <= best_load + SCHED_IMBALANCE)
+    {
+        return last;
+    }
+    return best;
+}
+/**
+ * @brief 被唤醒的线程td是否应抢占cpu上正在运行的线程
+ *
+ * @param cpu
+ * @param td
+ * @return bool
+ */
+static bool sched_should_preempt(uint64_t cpu, thread_t *td)
+{
+    thread_t *curr = READ_ONCE(cpus[cpu].cpu_running);
+    if (curr == NULL)
+    {
+        return false;
+    }
+    uint64_t rank = sched_class_rank(td);
+    uint64_t curr_rank = sched_class_rank(curr);
+    if (rank != curr_rank)
+    {
+        return rank < curr_rank;
+    }
+    return sched_classes[rank]->sc_preempt(curr, td);
+}
+/**
+ * @brief 线程加入cpu的运行队列后通知该核心(需持有td_lock，不持有rq_lock)
+ *        线程优先级高于目标核心正在运行的线程时立即抢占，空闲或停止tick的核心需要唤醒
+ *
+ * @param cpu
+ * @param td
+ */
+static void runq_notify(uint64_t cpu, thread_t *td)
+{
+    /* 与sched_idle配对：入队先于读取cpu_idle*/
+    smp_mb();
+    if (cpu == cpuid())
+    {
+        if (td != cpu_this.cpu_running && sched_should_preempt(cpu, td))
+        {
+            cpu_this.cpu_need_resched = 1;
+        }
+        else if (cpu_this.cpu_tick_stopped)
+        {
+            /* 出现了竞争者，恢复tick*/
+            timer_reprogram();
+        }
+    }
+    else if (READ_ONCE(cpus[cpu].cpu_idle) || sched_should_preempt(cpu, td))
+    {
+        /* 唤醒空闲核心或通知目标核心抢占*/
+        smp_send_reschedule(cpu);
+    }
+    else if (READ_ONCE(cpus[cpu].cpu_tick_stopped))
+    {
+        smp_send_tick(cpu);
+    }
+}
+/**
+ * @brief 将线程加入所选核心的运行队列(需持有td_lock)
+ *        线程优先级高于目标核心正在运行的线程时立即抢占
+ *
+ * @param td
+ * @param flags 入队标志
+ */
+static void runq_add(thread_t *td, uint32_t flags)
+{
+    uint64_t cpu = sched_select_cpu(td);
+    const sched_class_t *sc = sched_classes[sched_class_rank(td)];
+    if (!(flags & SCHED_ENQUEUE_WAKEUP) && cpu != td->td_lastcpu)
+    {
+        /* 让出或被抢占的线程放到其他核心：先相对原队列保存(vruntime)，再按迁移入队*/
+        runq_t *src = &runqs[td->td_lastcpu];
+        mutex_lock(&src->rq_lock);
+        if (sc->sc_detach != NULL)
+        {
+            sc->sc_detach(src, td);
+        }
+        mutex_unlock(&src->rq_lock);
+        flags |= SCHED_ENQUEUE_MIGRATED;
+    }
+    runq_t *rq = &runqs[cpu];
+    mutex_lock(&rq->rq_lock);
+    sc->sc_enqueue(rq, td, flags);
+    rq->rq_nr++;
+    td->td_rq = rq;
+    mutex_unlock(&rq->rq_lock);
+    runq_notify(cpu, td);
+}
+/**
+ * @brief 从负载最重的核心批量窃取线程到当前核心
+ *        按调度类优先级窃取，先窃取缓存冷的线程，不够时再窃取缓存热的线程
+ *
+ * @return uint64_t 窃取的线程数量
+ */
+static uint64_t sched_steal(void)
+{
+    uint64_t self = cpuid();
+    uint64_t busiest = NCPU;
+    uint64_t busiest_nr = 0;
+    for (uint64_t i = 0; i < NCPU; i++)
+    {
+        uint64_t nr = READ_ONCE(runqs[i].rq_nr);
+        if (i != self && nr > busiest_nr)
+        {
+            busiest = i;
+            busiest_nr = nr;
+        }
+    }
+    if (busiest == NCPU)
+    {
+        return 0;
+    }
+
+    /* 按核心编号顺序同时持有两个运行队列锁：线程摘下后立即放入本队列，
+       修改调度参数时不会遇到不在任何队列中的就绪线程*/
+    uint64_t count = 0;
+    runq_t *src = &runqs[busiest];
+    runq_t *rq = &runqs[self];
+    runq_t *first = busiest < self ? src : rq;
+    runq_t *second = busiest < self ? rq : src;
+    mutex_lock(&first->rq_lock);
+    mutex_lock(&second->rq_lock);
+    /* 最多窃取一半*/
+    uint64_t batch = (src->rq_nr + 1) / 2;
+    if (batch > SCHED_STEAL_BATCH)
+    {
+        batch = SCHED_STEAL_BATCH;
+    }
+    for (int pass = 0; pass < 2 && count < batch; pass++)
+    {
+        for (uint64_t c = 0; c < SCHED_NR_CLASSES && count < batch; c++)
+        {
+            thread_t *td;
+            while (count < batch && (td = sched_classes[c]->sc_steal(src, self, pass == 0)) != NULL)
+            {
+                src->rq_nr--;
+                sched_classes[c]->sc_enqueue(rq, td, SCHED_ENQUEUE_MIGRATED);
+                rq->rq_nr++;
+                td->td_rq = rq;
+                count++;
+            }
+        }
+    }
+    mutex_unlock(&second->rq_lock);
+    mutex_unlock(&first->rq_lock);
+    return count;
+}
+/**
+ * @brief 统计当前线程自上次统计以来的运行时间(需持有rq_lock)
+ *
+ * @param rq
+ * @param td
+ */
+static void sched_update_curr_locked(runq_t *rq, thread_t *td)
+{
+    uint64_t now = read_rdtime();
+    uint64_t delta = now - td->td_ststamp;
+    td->td_ststamp = now;
+    td->td_sum_exec += delta;
+    const sched_class_t *sc = sched_classes[sched_class_rank(td)];
+    if (sc->sc_update != NULL)
+    {
+        sc->sc_update(rq, td, delta);
+    }
+}
+/**
+ * @brief 统计当前线程的运行时间
+ *        必须在线程重新入队之前调用，否则会修改已在队列中的排序键
+ *
+ * @param td
+ */
+static void sched_update_curr(thread_t *td)
+{
+    runq_t *rq = &runqs[cpuid()];
+    mutex_lock(&rq->rq_lock);
+    sched_update_curr_locked(rq, td);
+    if (td->td_status == SLEEPING && sched_classes[sched_class_rank(td)]->sc_detach != NULL)
+    {
+        sched_classes[sched_class_rank(td)]->sc_detach(rq, td);
+    }
+    mutex_unlock(&rq->rq_lock);
+}
+/**
+ * @brief 按调度类优先级从当前核心的运行队列取出一个线程
+ *
+ * @param rq
+ * @return thread_t*
+ */
+static thread_t *runq_pick(runq_t *rq)
+{
+    for (uint64_t c = 0; c < SCHED_NR_CLASSES; c++)
+    {
+        thread_t *td = sched_classes[c]->sc_pick(rq);
+        if (td != NULL)
+        {
+            rq->rq_nr--;
+            /* 选中后即属于本核心：修改调度参数时按正在运行的线程处理*/
+            td->td_rq = NULL;
+            td->td_lastcpu = rq->rq_cpu;
+            return td;
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief 从当前核心的运行队列取出一个线程，队列为空时尝试窃取
+ *
+ * @return thread_t* 没有可运行的线程时返回NULL
+ */
+static thread_t *runq_choose(void)
+{
+    runq_t *rq = &runqs[cpuid()];
+    for (int retry = 0; retry < 2; retry++)
+    {
+        mutex_lock(&rq->rq_lock);
+        thread_t *td = runq_pick(rq);
+        mutex_unlock(&rq->rq_lock);
+        if (td != NULL || sched_steal() == 0)
+        {
+            return td;
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief 当前核心是否有可以立即运行的线程(需持有rq_lock)
+ *
+ * @param rq
+ * @return bool
+ */
+static bool runq_ready(runq_t *rq)
+{
+    for (uint64_t c = 0; c < SCHED_NR_CLASSES; c++)
+    {
+        if (sched_classes[c]->sc_ready(rq))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/**
+ * @brief 没有可运行的线程：停止tick，在wfi中等待中断
+ *        关中断后检查运行队列再执行wfi，检查之后到达的中断会使wfi立即返回，不会丢失唤醒
+ */
+static void sched_idle(void)
+{
+    runq_t *rq = &runqs[cpuid()];
+    cpu_this.cpu_idle = 1;
+    /* 与runq_add配对：设置cpu_idle先于检查运行队列*/
+    smp_mb();
+    disable_si();
+    rcu_idle_enter();
+    timer_reprogram();
+    mutex_lock(&rq->rq_lock);
+    bool ready = runq_ready(rq);
+    mutex_unlock(&rq->rq_lock);
+    if (!ready)
+    {
+        wfi();
+    }
+    rcu_idle_exit();
+    /* 打开中断，处理唤醒wfi的中断*/
+    enable_si();
+}
+/**
+ * @brief 下一次调度器需要定时器的时间
+ *        有其他就绪线程时需要周期tick划分时间片，调度类可以要求更早的事件
+ *
+ * @param now
+ * @return uint64_t 绝对时间(rdtime)，TIMER_EVENT_NONE表示不需要
+ */
+uint64_t sched_next_event(uint64_t now)
+{
+    runq_t *rq = &runqs[cpuid()];
+    thread_t *curr = cpu_this.cpu_running;
+    uint64_t next = TIMER_EVENT_NONE;
+    mutex_lock(&rq->rq_lock);
+    bool ready = runq_ready(rq);
+    for (uint64_t c = 0; c < SCHED_NR_CLASSES; c++)
+    {
+        if (sched_classes[c]->sc_next_event != NULL)
+        {
+            uint64_t event = sched_classes[c]->sc_next_event(rq, curr, now);
+            next = event < next ? event : next;
+        }
+    }
+    mutex_unlock(&rq->rq_lock);
+    if (curr != NULL && ready)
+    {
+        uint64_t tick = timer_next_tick(now);
+        next = tick < next ? tick : next;
+    }
+    return next;
+}
+/**
+ * @brief 每个核心的调度循环，不会返回
+ *        进入调度循环后当前核心不再运行任何线程，cpu_context保存调度循环的上下文
+ */
+void scheduler(void)
+{
+    cpu_this.cpu_running = NULL;
+    while (1)
+    {
+        /* 打开中断：所有线程都在等待时，由中断唤醒*/
+        enable_si();
+        thread_t *td = runq_choose();
+        if (td == NULL)
+        {
+            sched_idle();
+            continue;
+        }
+        cpu_this.cpu_idle = 0;
+
+        bool reap = false;
+        mutex_lock(td->td_lock);
+        if (td->td_status == RUNNABLE)
+        {
+            td->td_status = RUNNING;
+            td->td_slice = TD_TIME_SLICE;
+            td->td_lastcpu = cpuid();
+            td->td_ststamp = read_rdtime();
+            td->td_prev_sum_exec = td->td_sum_exec;
+            cpu_this.cpu_running = td;
+            cpu_this.cpu_need_resched = 0;
+            /* 按新线程的需要编程定时器(可能停止tick)*/
+            timer_reprogram();
+            /* 切换到线程，线程通过sched()切换回来时仍持有td_lock*/
+            swtch(&cpu_this.cpu_context, &td->td_kcontext);
+            cpu_this.cpu_running = NULL;
+            td->td_lastran = read_rdtime();
+            /* 上下文切换是静止状态*/
+            rcu_note_qs();
+            reap = td->td_status == ZOMBIE;
+        }
+        mutex_unlock(td->td_lock);
+        if (reap)
+        {
+            sched_dl_release(td);
+            /* 线程已经离开自己的内核栈，可以回收*/
+            thread_free(td);
+        }
+    }
+}
+/**
+ * @brief 切换到调度器
+ *        调用者必须只持有当前线程的td_lock，且已经修改了线程状态
+ *        线程可能在其他核心上恢复执行，因此返回后需要重新读取cpu_this
+ */
+void sched(void)
+{
+    thread_t *td = cpu_this.cpu_running;
+    if (td->td_status != RUNNABLE)
+    {
+        /* 就绪的线程在入队前已经统计过*/
+        sched_update_curr(td);
+    }
+    if (cpu_this.mutex_depth != 1 || cpu_this.mutexs[0] != td->td_lock)
+    {
+        /* 持有其他锁时切换会导致死锁*/
+        while (1)
+            ;
+    }
+    if (td->td_status == RUNNING || get_si() || cpu_this.rcu_nesting)
+    {
+        /* 调度状态错误*/
+        while (1)
+            ;
+    }
+    /* 关中断前的中断状态属于当前线程，而不是当前核心*/
+    register_t sie = cpu_this.sstatus;
+    td->td_nswitch++;
+    swtch(&td->td_kcontext, &cpu_this.cpu_context);
+    cpu_this.sstatus = sie;
+}
+/**
+ * @brief 主动让出CPU，线程保持就绪状态
+ *
+ */
+void yield(void)
+{
+    thread_t *td = cpu_this.cpu_running;
+    mutex_lock(td->td_lock);
+    sched_update_curr(td);
+    td->td_status = RUNNABLE;
+    runq_add(td, 0);
+    sched();
+    mutex_unlock(td->td_lock);
+}
+/**
+ * @brief 将线程设置为就绪状态并加入运行队列(需持有td_lock)
+ *
+ * @param td
+ */
+void setrunnable(thread_t *td)
+{
+    td->td_status = RUNNABLE;
+    runq_add(td, SCHED_ENQUEUE_WAKEUP);
+}
+/**
+ * @brief 在chan上睡眠，原子地释放mtx，被唤醒后重新获取mtx
+ *        先获取chan所在桶的锁再释放mtx，保证wakeup不会在线程进入睡眠队列之前发生
+ *
+ * @param chan 等待的地址
+ * @param mtx 保护等待条件的锁(可以为NULL)
+ * @param msg 等待原因
+ */
+void sleep(void *chan, mutex_t *mtx, const char *msg)
+{
+    thread_t *td = cpu_this.cpu_running;
+    threadq_t *sq = sleepq_lookup((uintptr_t)chan);
+    mutex_lock(&sq->tq_lock);
+    mutex_lock(td->td_lock);
+    if (mtx != NULL)
+    {
+        mutex_unlock(mtx);
+    }
+    td->td_wchan = (uintptr_t)chan;
+    td->td_wmesg = msg;
+    td->td_status = SLEEPING;
+    TAILQ_INSERT_TAIL(&sq->tq_head, td, td_sleepq);
+    mutex_unlock(&sq->tq_lock);
+
+    sched();
+
+    td->td_wchan = 0;
+    td->td_wmesg = NULL;
+    mutex_unlock(td->td_lock);
+    if (mtx != NULL)
+    {
+        mutex_lock(mtx);
+    }
+}
+/**
+ * @brief 唤醒所有在chan上睡眠的线程(只遍历chan所在的桶)
+ *
+ * @param chan
+ */
+void wakeup(void *chan)
+{
+    wakeup_n(chan, ~0ul);
+}
+/**
+ * @brief 按睡眠顺序唤醒最多nr个在chan上睡眠的线程
+ *
+ * @param chan
+ * @param nr
+ * @return uint64_t 唤醒的线程数
+ */
+uint64_t wakeup_n(void *chan, uint64_t nr)
+{
+    uint64_t woken = 0;
+    threadq_t *sq = sleepq_lookup((uintptr_t)chan);
+    mutex_lock(&sq->tq_lock);
+    thread_t *td = TAILQ_FIRST(&sq->tq_head);
+    while (td != NULL && woken < nr)
+    {
+        thread_t *next = TAILQ_NEXT(td, td_sleepq);
+        /* td_wchan在持有桶锁时写入，此处读取是一致的；同一个桶中可能有其他通道的线程*/
+        if (td->td_wchan == (uintptr_t)chan)
+        {
+            mutex_lock(td->td_lock);
+            TAILQ_REMOVE(&sq->tq_head, td, td_sleepq);
+            setrunnable(td);
+            mutex_unlock(td->td_lock);
+            woken++;
+        }
+        td = next;
+    }
+    mutex_unlock(&sq->tq_lock);
+    return woken;
+}
+/**
+ * @brief 唤醒在chan上睡眠的指定线程(用于超时唤醒，不影响同一通道上的其他线程)
+ *
+ * @param td
+ * @param chan
+ * @return bool 线程是否被唤醒(已经被wakeup唤醒时返回false)
+ */
+bool wakeup_thread(thread_t *td, void *chan)
+{
+    bool woken = false;
+    threadq_t *sq = sleepq_lookup((uintptr_t)chan);
+    mutex_lock(&sq->tq_lock);
+    mutex_lock(td->td_lock);
+    if (td->td_status == SLEEPING && td->td_wchan == (uintptr_t)chan)
+    {
+        /* 线程在chan的桶中，直接摘除*/
+        TAILQ_REMOVE(&sq->tq_head, td, td_sleepq);
+        setrunnable(td);
+        woken = true;
+    }
+    mutex_unlock(td->td_lock);
+    mutex_unlock(&sq->tq_lock);
+    return woken;
+}
+/**
+ * @brief 时钟中断中调用：处理调度类的定时事件，统计运行时间，由调度类处理时间片
+ *        更高优先级调度类有就绪线程时重新调度
+ */
+void sched_tick(void)
+{
+    thread_t *td = cpu_this.cpu_running;
+    runq_t *rq = &runqs[cpuid()];
+    bool resched = false;
+    mutex_lock(&rq->rq_lock);
+    uint64_t now = read_rdtime();
+    for (uint64_t c = 0; c < SCHED_NR_CLASSES; c++)
+    {
+        if (sched_classes[c]->sc_timer != NULL && sched_classes[c]->sc_timer(rq, now))
+        {
+            resched = true;
+        }
+    }
+    if (td == NULL)
+    {
+        /* 空闲核心的调度循环会取出重新就绪的线程*/
+        mutex_unlock(&rq->rq_lock);
+        return;
+    }
+    uint64_t rank = sched_class_rank(td);
+    sched_update_curr_locked(rq, td);
+    if (sched_classes[rank]->sc_tick(rq, td))
+    {
+        resched = true;
+    }
+    bool higher = false;
+    for (uint64_t c = 0; c < rank && !higher; c++)
+    {
+        /* 错过了唤醒时的抢占*/
+        higher = sched_classes[c]->sc_ready(rq);
+    }
+    mutex_unlock(&rq->rq_lock);
+    if (resched || higher)
+    {
+        cpu_this.cpu_need_resched = 1;
+    }
+}
+/**
+ * @brief 中断返回前调用：需要重新调度时抢占当前线程
+ *        被打断的代码持有锁或处于RCU读临界区时不抢占，等待下一次中断
+ */
+void sched_preempt(void)
+{
+    thread_t *td = cpu_this.cpu_running;
+    if (!cpu_this.cpu_need_resched || td == NULL)
+    {
+        return;
+    }
+    if (cpu_this.mutex_depth || cpu_this.rcu_nesting || cpu_this.cpu_in_softirq)
+    {
+        return;
+    }
+    /* sepc/sstatus属于被打断的线程，切换期间可能被其他陷阱覆盖*/
+    uint64_t sepc = read_sepc();
+    uint64_t sstatus = read_sstatus();
+    yield();
+    write_sepc(sepc);
+    write_sstatus(sstatus);
+}
+/**
+ * @brief 通知正在运行td的核心重新调度(需持有td_lock)
+ *
+ * @param td
+ */
+void sched_kick(thread_t *td)
+{
+    if (td->td_status != RUNNING)
+    {
+        return;
+    }
+    if (td->td_lastcpu == cpuid())
+    {
+        cpu_this.cpu_need_resched = 1;
+    }
+    else
+    {
+        smp_send_reschedule(td->td_lastcpu);
+    }
+}
+/**
+ * @brief 设置线程的CPU亲和性
+ *        1.在不允许的核心的就绪队列中：摘下后放入允许的核心的队列(runq_pick不检查亲和性)
+ *        2.正在不允许的核心上运行：通知该核心重新调度，线程重新入队时迁移
+ *
+ * @param td
+ * @param mask 允许运行的核心位图
+ * @return err_t 成功返回0，mask中没有在线核心时返回-EINVAL
+ */
+err_t sched_setaffinity(thread_t *td, uint64_t mask)
+{
+    if ((mask & READ_ONCE(cpu_online_mask)) == 0)
+    {
+        return -EINVAL;
+    }
+    sched_change_t sch;
+    mutex_lock(td->td_lock);
+    sched_change_begin(td, &sch);
+    td->td_affinity = mask;
+    sched_change_end(td, &sch);
+    mutex_unlock(td->td_lock);
+    return 0;
+}
+/**
+ * @brief 亲和性测试线程(什么也不做，直接退出)
+ *
+ * @param arg
+ */
+static void sched_affinity_test_fn(void *arg)
+{
+}
+/**
+ * @brief 测试修改亲和性时就绪线程是否迁移(从核上线后、进入调度循环前调用)
+ *        创建一个只允许在本核心运行的线程，本核心还没有调度，线程停留在本核心的队列中，
+ *        再把亲和性改为其他在线核心，线程必须离开本核心的队列
+ *
+ */
+void sched_affinity_test(void)
+{
+    uint64_t self = cpuid();
+    uint64_t others = READ_ONCE(cpu_online_mask) & ~(1ul << self);
+    if (others == 0)
+    {
+        return;
+    }
+    thread_t *td = kthread_alloc(sched_affinity_test_fn, NULL, "affinity_test");
+    if (td == NULL)
+    {
+        return;
+    }
+    mutex_lock(td->td_lock);
+    td->td_affinity = 1ul << self;
+    setrunnable(td);
+    bool queued = td->td_rq == &runqs[self];
+    mutex_unlock(td->td_lock);
+
+    sched_setaffinity(td, others);
+
+    mutex_lock(td->td_lock);
+    /* 仍在队列中时必须在其他核心的队列；已被其他核心选中时td_lastcpu为该核心*/
+    bool moved = td->td_rq != NULL ? td->td_rq->rq_cpu != self : td->td_lastcpu != self;
+    mutex_unlock(td->td_lock);
+    if (!queued || !moved)
+    {
+        printf("[JaeOS]Hart %ld Sched Affinity Test Failed.\n", self);
+        while (1)
+            ;
+    }
+    printf("[JaeOS]Hart %ld Passed Sched Affinity Test!\n", self);
+}
+/**
+ * @brief 开始修改线程的调度参数(需持有td_lock)
+ *        1.在就绪队列中：锁住所在队列，从原调度类摘下
+ *        2.正在运行或已被选中即将运行：锁住所在核心的队列，统计运行时间后离开原调度类
+ *        3.其他状态(睡眠、新建)：不需要加锁
+ *        返回后修改td_policy/td_prio/td_nice等参数，再调用sched_change_end
+ *
+ * @param td
+ * @param sch
+ */
+void sched_change_begin(thread_t *td, sched_change_t *sch)
+{
+    sch->sch_rq = NULL;
+    sch->sch_queued = false;
+    sch->sch_curr = false;
+    while (1)
+    {
+        /* 持有td_lock时线程不会入队，但可能被选中或窃取，加锁后重新检查*/
+        runq_t *rq = READ_ONCE(td->td_rq);
+        bool curr = false;
+        if (rq == NULL)
+        {
+            curr = td->td_status == RUNNING || td->td_status == RUNNABLE;
+            if (!curr)
+            {
+                return;
+            }
+            rq = &runqs[READ_ONCE(td->td_lastcpu)];
+        }
+        mutex_lock(&rq->rq_lock);
+        if (td->td_rq == rq)
+        {
+            sched_classes[sched_class_rank(td)]->sc_dequeue(rq, td);
+            rq->rq_nr--;
+            td->td_rq = NULL;
+            sch->sch_queued = true;
+        }
+        else if (!(curr && td->td_rq == NULL && &runqs[td->td_lastcpu] == rq))
+        {
+            mutex_unlock(&rq->rq_lock);
+            continue;
+        }
+        else
+        {
+            const sched_class_t *sc = sched_classes[sched_class_rank(td)];
+            if (td->td_status == RUNNING)
+            {
+                /* 按原调度类统计到目前为止的运行时间*/
+                sched_update_curr_locked(rq, td);
+            }
+            if (sc->sc_detach != NULL)
+            {
+                sc->sc_detach(rq, td);
+            }
+            sch->sch_curr = true;
+        }
+        sch->sch_rq = rq;
+        return;
+    }
+}
+/**
+ * @brief 结束修改调度参数：放入新调度类，需要时重新调度(需持有td_lock)
+ *        就绪线程所在的核心不再被亲和性允许时，改为放入sched_select_cpu选择的核心
+ *
+ * @param td
+ * @param sch sched_change_begin的结果
+ */
+void sched_change_end(thread_t *td, sched_change_t *sch)
+{
+    runq_t *rq = sch->sch_rq;
+    if (rq == NULL)
+    {
+        return;
+    }
+    const sched_class_t *sc = sched_classes[sched_class_rank(td)];
+    if (sch->sch_queued && !(td->td_affinity & (1ul << rq->rq_cpu)))
+    {
+        /* 线程不在任何队列中且持有td_lock，不会被选中或窃取*/
+        mutex_unlock(&rq->rq_lock);
+        rq = &runqs[sched_select_cpu(td)];
+        mutex_lock(&rq->rq_lock);
+    }
+    if (sch->sch_queued)
+    {
+        /* 摘下时已保存为相对值，按迁移处理*/
+        sc->sc_enqueue(rq, td, SCHED_ENQUEUE_MIGRATED);
+        rq->rq_nr++;
+        td->td_rq = rq;
+    }
+    else if (sc->sc_attach != NULL)
+    {
+        sc->sc_attach(rq, td);
+    }
+    mutex_unlock(&rq->rq_lock);
+    if (sch->sch_queued)
+    {
+        runq_notify(rq->rq_cpu, td);
+    }
+    else if (sch->sch_curr)
+    {
+        /* 正在运行的线程可能不再是最高优先级*/
+        sched_kick(td);
+    }
+}
+/**
+ * @brief 设置线程的调度策略与实时优先级(截止时间线程使用sched_setattr_deadline)
+ *        已经在就绪队列中的线程立即移到新调度类，正在运行的线程立即重新调度
+ *
+ * @param td
+ * @param policy SCHED_NORMAL/SCHED_FIFO/SCHED_RR
+ * @param prio 实时优先级(SCHED_NORMAL时忽略)
+ * @return err_t 成功返回0，参数非法时返回-EINVAL
+ */
+err_t sched_setscheduler(thread_t *td, int32_t policy, int32_t prio)
+{
+    if (policy != SCHED_NORMAL && policy != SCHED_FIFO && policy != SCHED_RR)
+    {
+        return -EINVAL;
+    }
+    if (policy != SCHED_NORMAL && (prio < 0 || prio >= RT_PRIO_LEVELS))
+    {
+        return -EINVAL;
+    }
+    sched_change_t sch;
+    mutex_lock(td->td_lock);
+    sched_change_begin(td, &sch);
+    /* 离开截止时间类，释放带宽*/
+    sched_dl_release(td);
+    td->td_policy = policy;
+    td->td_prio = policy == SCHED_NORMAL ? 0 : prio;
+    sched_change_end(td, &sch);
+    mutex_unlock(td->td_lock);
+    return 0;
+}
+/**
+ * @brief 设置普通线程的nice值
+ *
+ * @param td
+ * @param nice NICE_MIN ~ NICE_MAX
+ * @return err_t 成功返回0，参数非法时返回-EINVAL
+ */
+err_t sched_setnice(thread_t *td, int32_t nice)
+{
+    if (nice < NICE_MIN || nice > NICE_MAX)
+    {
+        return -EINVAL;
+    }
+    sched_change_t sch;
+    mutex_lock(td->td_lock);
+    /* 重新入队时按新的权重计入rq_fair_load*/
+    sched_change_begin(td, &sch);
+    td->td_nice = nice;
+    sched_change_end(td, &sch);
+    mutex_unlock(td->td_lock);
+    return 0;
+}
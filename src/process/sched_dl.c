@@ -0,0 +1,383 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/platform.h"
+#include "common/rv64.h"
+#include "common/atomic.h"
+#include "common/bitops.h"
+#include "process/sched.h"
+#include "process/thread.h"
+#include "lock/mutex.h"
+#include "lib/rbtree.h"
+#include "lib/queue.h"
+#include "cpu/cpu.h"
+#include "dev/timer.h"
+#include "dev/clocksource.h"
+
+/**
+ * 截止时间调度类(EDF + CBS)
+ * 1.每个线程有(runtime, deadline, period)三个参数：每个period内，在相对deadline之前运行runtime
+ * 2.就绪线程按绝对截止时间排序，总是运行截止时间最早的线程(EDF)
+ * 3.恒定带宽服务器(CBS)：运行时间从预算中扣除，预算耗尽时被节流，直到当前截止时间再补充预算并推迟截止时间
+ * 4.唤醒时若剩余预算按剩余时间计算的带宽超过runtime/deadline，则重新开始一个周期，防止睡眠线程透支带宽
+ * 5.准入控制：所有截止时间线程的runtime/period之和不超过在线核心数的95%
+ */
+
+#define DL_BW_SHIFT (20)                                   /* 带宽定点数的小数位数*/
+#define DL_BW_UNIT (1ul << DL_BW_SHIFT)                    /* 带宽1.0*/
+#define DL_BW_LIMIT_PER_CPU (DL_BW_UNIT * 95 / 100)        /* 每个核心允许的截止时间类带宽：95%*/
+#define DL_RUNTIME_US_MIN (100ul)                          /* 最小运行时间预算：100us*/
+#define DL_US_TO_CYCLES(us) clocksource_us2cyc(us)
+
+static uint64_t dl_total_bw; /* 已接纳的截止时间线程带宽之和(受dl_bw_lock保护)*/
+
+/**
+ * @brief 线程参数对应的带宽
+ *
+ * @param runtime
+ * @param period
+ * @return uint64_t
+ */
+static inline uint64_t dl_bw(uint64_t runtime, uint64_t period)
+{
+    return (runtime << DL_BW_SHIFT) / period;
+}
+/**
+ * @brief 截止时间比较(允许回绕)
+ *
+ * @param a
+ * @param b
+ * @return bool a早于b
+ */
+static inline bool dl_time_before(uint64_t a, uint64_t b)
+{
+    return (int64_t)(a - b) < 0;
+}
+/**
+ * @brief 红黑树比较函数
+ *
+ * @param a
+ * @param b
+ * @return bool
+ */
+static bool dl_less(const rb_node_t *a, const rb_node_t *b)
+{
+    return dl_time_before(rb_entry(a, thread_t, td_rbnode)->td_dl_abs_deadline,
+                          rb_entry(b, thread_t, td_rbnode)->td_dl_abs_deadline);
+}
+/**
+ * @brief 截止时间类初始化
+ *
+ */
+void sched_dl_init(void)
+{
+    mutex_init(&dl_bw_lock, "dl_bw_lock", MUTEX_TYPE_SPIN);
+    dl_total_bw = 0;
+}
+/**
+ * @brief 开始新的周期：补满预算，截止时间设置为now + deadline
+ *
+ * @param td
+ * @param now
+ */
+static void dl_new_period(thread_t *td, uint64_t now)
+{
+    td->td_dl_abs_deadline = now + td->td_dl_deadline;
+    td->td_dl_remaining = td->td_dl_runtime;
+    td->td_dl_throttled = 0;
+}
+/**
+ * @brief 唤醒时检查CBS规则：剩余预算在剩余时间内的带宽超过线程带宽时重新开始周期
+ *        remaining / (deadline - now) > runtime / deadline
+ *
+ * @param td
+ * @param now
+ */
+static void dl_check_wakeup(thread_t *td, uint64_t now)
+{
+    if (td->td_dl_throttled)
+    {
+        return;
+    }
+    if (!dl_time_before(now, td->td_dl_abs_deadline))
+    {
+        dl_new_period(td, now);
+        return;
+    }
+    uint64_t left = td->td_dl_abs_deadline - now;
+    if (td->td_dl_remaining > 0 &&
+        (uint64_t)td->td_dl_remaining * td->td_dl_deadline > left * td->td_dl_runtime)
+    {
+        dl_new_period(td, now);
+    }
+}
+/**
+ * @brief 加入就绪红黑树，被节流的线程加入节流队列
+ *
+ * @param rq
+ * @param td
+ * @param flags
+ */
+static void dl_enqueue(runq_t *rq, thread_t *td, uint32_t flags)
+{
+    if (flags & SCHED_ENQUEUE_WAKEUP)
+    {
+        dl_check_wakeup(td, read_rdtime());
+    }
+    if (td->td_dl_throttled)
+    {
+        TAILQ_INSERT_TAIL(&rq->rq_dl_throttled, td, td_runq);
+        return;
+    }
+    rb_insert(&rq->rq_dl_root, &td->td_rbnode, dl_less);
+}
+/**
+ * @brief 从就绪红黑树或节流队列中移除指定线程(修改调度参数前调用)
+ *
+ * @param rq
+ * @param td
+ */
+static void dl_dequeue(runq_t *rq, thread_t *td)
+{
+    if (td->td_dl_throttled)
+    {
+        TAILQ_REMOVE(&rq->rq_dl_throttled, td, td_runq);
+        return;
+    }
+    rb_erase(&rq->rq_dl_root, &td->td_rbnode);
+}
+/**
+ * @brief 取出截止时间最早的线程
+ *
+ * @param rq
+ * @return thread_t*
+ */
+static thread_t *dl_pick(runq_t *rq)
+{
+    rb_node_t *left = rb_first(&rq->rq_dl_root);
+    if (left == NULL)
+    {
+        return NULL;
+    }
+    thread_t *td = rb_entry(left, thread_t, td_rbnode);
+    rb_erase(&rq->rq_dl_root, left);
+    return td;
+}
+/**
+ * @brief 按截止时间从早到晚查找一个允许迁移到cpu的线程(不迁移被节流的线程)
+ *
+ * @param rq
+ * @param cpu
+ * @param cold
+ * @return thread_t*
+ */
+static thread_t *dl_steal(runq_t *rq, uint64_t cpu, bool cold)
+{
+    uint64_t now = read_rdtime();
+    for (rb_node_t *node = rb_first(&rq->rq_dl_root); node != NULL; node = rb_next(node))
+    {
+        thread_t *td = rb_entry(node, thread_t, td_rbnode);
+        if ((td->td_affinity & (1ul << cpu)) && (!cold || sched_cache_cold(td, now)))
+        {
+            rb_erase(&rq->rq_dl_root, node);
+            return td;
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief 截止时间更早的线程抢占当前线程
+ *
+ * @param curr
+ * @param td
+ * @return bool
+ */
+static bool dl_preempt(thread_t *curr, thread_t *td)
+{
+    return dl_time_before(td->td_dl_abs_deadline, curr->td_dl_abs_deadline);
+}
+/**
+ * @brief 从预算中扣除运行时间，预算耗尽时节流
+ *
+ * @param rq
+ * @param td
+ * @param delta
+ */
+static void dl_update(runq_t *rq, thread_t *td, uint64_t delta)
+{
+    if (td->td_policy != SCHED_DEADLINE)
+    {
+        return;
+    }
+    td->td_dl_remaining -= (int64_t)delta;
+    if (td->td_dl_remaining <= 0)
+    {
+        td->td_dl_throttled = 1;
+    }
+}
+/**
+ * @brief 被节流或有截止时间更早的线程就绪时重新调度
+ *
+ * @param rq
+ * @param td
+ * @return bool
+ */
+static bool dl_tick(runq_t *rq, thread_t *td)
+{
+    if (td->td_dl_throttled)
+    {
+        return true;
+    }
+    rb_node_t *left = rb_first(&rq->rq_dl_root);
+    return left != NULL && dl_preempt(td, rb_entry(left, thread_t, td_rbnode));
+}
+/**
+ * @brief 是否有就绪的截止时间线程
+ *
+ * @param rq
+ * @return bool
+ */
+static bool dl_ready(runq_t *rq)
+{
+    return !rb_empty(&rq->rq_dl_root);
+}
+/**
+ * @brief 补充到达截止时间的节流线程：预算按周期补充，截止时间按周期推迟
+ *
+ * @param rq
+ * @param now
+ * @return bool 是否有线程重新就绪
+ */
+static bool dl_timer(runq_t *rq, uint64_t now)
+{
+    bool ready = false;
+    thread_t *td = TAILQ_FIRST(&rq->rq_dl_throttled);
+    while (td != NULL)
+    {
+        thread_t *next = TAILQ_NEXT(td, td_runq);
+        if (!dl_time_before(now, td->td_dl_abs_deadline))
+        {
+            TAILQ_REMOVE(&rq->rq_dl_throttled, td, td_runq);
+            while (td->td_dl_remaining <= 0)
+            {
+                td->td_dl_abs_deadline += td->td_dl_period;
+                td->td_dl_remaining += td->td_dl_runtime;
+            }
+            if (dl_time_before(td->td_dl_abs_deadline, now))
+            {
+                /* 超时太久，重新开始周期*/
+                dl_new_period(td, now);
+            }
+            td->td_dl_throttled = 0;
+            rb_insert(&rq->rq_dl_root, &td->td_rbnode, dl_less);
+            ready = true;
+        }
+        td = next;
+    }
+    return ready;
+}
+/**
+ * @brief 下一次需要定时器的时间：当前线程预算耗尽时，或者最早的节流线程补充预算时
+ *
+ * @param rq
+ * @param curr 正在运行的线程(可以为NULL)
+ * @param now
+ * @return uint64_t
+ */
+static uint64_t dl_next_event(runq_t *rq, thread_t *curr, uint64_t now)
+{
+    uint64_t next = TIMER_EVENT_NONE;
+    if (curr != NULL && curr->td_policy == SCHED_DEADLINE && !curr->td_dl_throttled)
+    {
+        next = now + curr->td_dl_remaining;
+    }
+    thread_t *td;
+    TAILQ_FOREACH(td, &rq->rq_dl_throttled, td_runq)
+    {
+        if (next == TIMER_EVENT_NONE || dl_time_before(td->td_dl_abs_deadline, next))
+        {
+            next = td->td_dl_abs_deadline;
+        }
+    }
+    return next;
+}
+/**
+ * @brief 释放线程占用的带宽，清除节流状态(线程退出或离开截止时间类时调用)
+ *        离开截止时间类时线程已经通过sched_change_begin从就绪树或节流队列摘下
+ *
+ * @param td
+ */
+void sched_dl_release(thread_t *td)
+{
+    if (td->td_policy != SCHED_DEADLINE)
+    {
+        return;
+    }
+    td->td_dl_throttled = 0;
+    mutex_lock(&dl_bw_lock);
+    dl_total_bw -= dl_bw(td->td_dl_runtime, td->td_dl_period);
+    mutex_unlock(&dl_bw_lock);
+}
+/**
+ * @brief 将线程设置为截止时间线程
+ *        已经在就绪队列中的线程先摘下再按新的截止时间入队(截止时间是红黑树的键)，正在运行的线程立即重新调度
+ *
+ * @param td
+ * @param runtime_us 每个周期的运行时间预算(微秒)
+ * @param deadline_us 相对截止时间(微秒)，为0时等于周期
+ * @param period_us 周期(微秒)
+ * @return err_t 成功返回0，参数非法时返回-EINVAL，带宽不足时返回-EBUSY
+ */
+err_t sched_setattr_deadline(thread_t *td, uint64_t runtime_us, uint64_t deadline_us, uint64_t period_us)
+{
+    if (deadline_us == 0)
+    {
+        deadline_us = period_us;
+    }
+    if (runtime_us < DL_RUNTIME_US_MIN || runtime_us > deadline_us || deadline_us > period_us)
+    {
+        return -EINVAL;
+    }
+    uint64_t runtime = DL_US_TO_CYCLES(runtime_us);
+    uint64_t deadline = DL_US_TO_CYCLES(deadline_us);
+    uint64_t period = DL_US_TO_CYCLES(period_us);
+
+    mutex_lock(td->td_lock);
+    /* 准入控制*/
+    mutex_lock(&dl_bw_lock);
+    uint64_t old_bw = td->td_policy == SCHED_DEADLINE ? dl_bw(td->td_dl_runtime, td->td_dl_period) : 0;
+    uint64_t new_bw = dl_bw(runtime, period);
+    uint64_t limit = DL_BW_LIMIT_PER_CPU * hweight64(READ_ONCE(cpu_online_mask));
+    if (dl_total_bw - old_bw + new_bw > limit)
+    {
+        mutex_unlock(&dl_bw_lock);
+        mutex_unlock(td->td_lock);
+        return -EBUSY;
+    }
+    dl_total_bw = dl_total_bw - old_bw + new_bw;
+    mutex_unlock(&dl_bw_lock);
+
+    sched_change_t sch;
+    sched_change_begin(td, &sch);
+    td->td_dl_runtime = runtime;
+    td->td_dl_deadline = deadline;
+    td->td_dl_period = period;
+    dl_new_period(td, read_rdtime());
+    td->td_policy = SCHED_DEADLINE;
+    td->td_prio = 0;
+    sched_change_end(td, &sch);
+    mutex_unlock(td->td_lock);
+    return 0;
+}
+
+const sched_class_t dl_sched_class = {
+    .sc_enqueue = dl_enqueue,
+    .sc_dequeue = dl_dequeue,
+    .sc_pick = dl_pick,
+    .sc_steal = dl_steal,
+    .sc_preempt = dl_preempt,
+    .sc_tick = dl_tick,
+    .sc_update = dl_update,
+    .sc_ready = dl_ready,
+    .sc_timer = dl_timer,
+    .sc_next_event = dl_next_event,
+};
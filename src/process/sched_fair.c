@@ -0,0 +1,330 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/platform.h"
+#include "common/rv64.h"
+#include "process/sched.h"
+#include "process/thread.h"
+#include "lib/rbtree.h"
+
+/**
+ * 公平调度类(CFS)
+ * 1.线程运行delta时间，vruntime增加delta * NICE_0_WEIGHT / weight，nice值越小权重越大，vruntime增长越慢
+ * 2.就绪线程按vruntime保存在红黑树中，总是选择最左(最小)的线程
+ * 3.调度周期内每个线程按权重分得运行时间，但不少于最小粒度，限制上下文切换开销
+ * 4.睡眠线程醒来时vruntime不低于min_vruntime减去补偿，避免长时间睡眠后独占CPU
+ * 5.离开运行队列(睡眠/迁移/离开公平类)时vruntime保存为相对min_vruntime的值，重新入队时加上目标队列的min_vruntime
+ *   在队列中或正在运行时为绝对值，其余时候(包括属于其他调度类时)为相对值
+ */
+
+#define NICE_0_WEIGHT (1024ul)                                    /* nice值为0的权重*/
+#define SCHED_LATENCY_CYCLES clocksource_us2cyc(6000)             /* 调度周期：6ms*/
+#define SCHED_WAKEUP_GRAN_CYCLES clocksource_us2cyc(1000)         /* 唤醒抢占粒度：1ms*/
+#define SCHED_SLEEPER_CREDIT_CYCLES (SCHED_LATENCY_CYCLES / 2)    /* 睡眠补偿上限：半个调度周期*/
+#define SCHED_MIN_GRAN_US_MIN (100ul)                             /* 最小粒度下限：100us*/
+
+/* 最小粒度：单次调度至少运行的时间(微秒，默认0.75ms)*/
+static uint64_t sched_min_granularity_us = 750;
+
+/* nice值到权重的映射(与Linux一致)，相邻nice值的CPU份额相差约10%*/
+static const uint32_t nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+};
+
+/**
+ * @brief 线程当前nice值对应的权重
+ *
+ * @param td
+ * @return uint64_t
+ */
+static inline uint64_t fair_weight(thread_t *td)
+{
+    return nice_to_weight[td->td_nice - NICE_MIN];
+}
+/**
+ * @brief vruntime比较(允许回绕)
+ *
+ * @param a
+ * @param b
+ * @return bool a < b
+ */
+static inline bool vruntime_before(uint64_t a, uint64_t b)
+{
+    return (int64_t)(a - b) < 0;
+}
+/**
+ * @brief 红黑树比较函数
+ *
+ * @param a
+ * @param b
+ * @return bool
+ */
+static bool fair_less(const rb_node_t *a, const rb_node_t *b)
+{
+    return vruntime_before(rb_entry(a, thread_t, td_rbnode)->td_vruntime,
+                           rb_entry(b, thread_t, td_rbnode)->td_vruntime);
+}
+/**
+ * @brief 更新min_vruntime：正在运行的线程与最左线程中较小的vruntime，且单调递增
+ *
+ * @param rq
+ * @param curr 正在运行的公平类线程(可以为NULL)
+ */
+static void fair_update_min_vruntime(runq_t *rq, thread_t *curr)
+{
+    rb_node_t *left = rb_first(&rq->rq_fair_root);
+    uint64_t vruntime = rq->rq_min_vruntime;
+    if (curr != NULL)
+    {
+        vruntime = curr->td_vruntime;
+    }
+    if (left != NULL)
+    {
+        uint64_t left_vruntime = rb_entry(left, thread_t, td_rbnode)->td_vruntime;
+        if (curr == NULL || vruntime_before(left_vruntime, vruntime))
+        {
+            vruntime = left_vruntime;
+        }
+    }
+    if (vruntime_before(rq->rq_min_vruntime, vruntime))
+    {
+        rq->rq_min_vruntime = vruntime;
+    }
+}
+/**
+ * @brief 加入红黑树
+ *
+ * @param rq
+ * @param td
+ * @param flags SCHED_ENQUEUE_WAKEUP/SCHED_ENQUEUE_MIGRATED
+ */
+static void fair_enqueue(runq_t *rq, thread_t *td, uint32_t flags)
+{
+    if (flags & (SCHED_ENQUEUE_WAKEUP | SCHED_ENQUEUE_MIGRATED))
+    {
+        /* 相对值转换为本队列的vruntime*/
+        td->td_vruntime += rq->rq_min_vruntime;
+    }
+    if (flags & SCHED_ENQUEUE_WAKEUP)
+    {
+        /* 睡眠补偿有上限*/
+        uint64_t floor = rq->rq_min_vruntime - SCHED_SLEEPER_CREDIT_CYCLES;
+        if (vruntime_before(td->td_vruntime, floor))
+        {
+            td->td_vruntime = floor;
+        }
+    }
+    td->td_weight = fair_weight(td);
+    rq->rq_fair_load += td->td_weight;
+    rq->rq_fair_nr++;
+    rb_insert(&rq->rq_fair_root, &td->td_rbnode, fair_less);
+}
+/**
+ * @brief 从红黑树中移除
+ *
+ * @param rq
+ * @param td
+ */
+static void fair_remove(runq_t *rq, thread_t *td)
+{
+    rb_erase(&rq->rq_fair_root, &td->td_rbnode);
+    rq->rq_fair_load -= td->td_weight;
+    rq->rq_fair_nr--;
+}
+/**
+ * @brief 从红黑树中移除指定线程，vruntime保存为相对值(修改调度参数前调用)
+ *
+ * @param rq
+ * @param td
+ */
+static void fair_dequeue(runq_t *rq, thread_t *td)
+{
+    fair_remove(rq, td);
+    td->td_vruntime -= rq->rq_min_vruntime;
+}
+/**
+ * @brief 取出vruntime最小的线程
+ *
+ * @param rq
+ * @return thread_t*
+ */
+static thread_t *fair_pick(runq_t *rq)
+{
+    rb_node_t *left = rb_first(&rq->rq_fair_root);
+    if (left == NULL)
+    {
+        return NULL;
+    }
+    thread_t *td = rb_entry(left, thread_t, td_rbnode);
+    fair_remove(rq, td);
+    fair_update_min_vruntime(rq, td);
+    return td;
+}
+/**
+ * @brief 按vruntime从小到大查找一个允许迁移到cpu的线程
+ *
+ * @param rq
+ * @param cpu 目标核心
+ * @param cold 是否只选择缓存冷的线程
+ * @return thread_t*
+ */
+static thread_t *fair_steal(runq_t *rq, uint64_t cpu, bool cold)
+{
+    uint64_t now = read_rdtime();
+    for (rb_node_t *node = rb_first(&rq->rq_fair_root); node != NULL; node = rb_next(node))
+    {
+        thread_t *td = rb_entry(node, thread_t, td_rbnode);
+        if ((td->td_affinity & (1ul << cpu)) && (!cold || sched_cache_cold(td, now)))
+        {
+            fair_remove(rq, td);
+            /* 保存为相对值，在目标队列入队时恢复*/
+            td->td_vruntime -= rq->rq_min_vruntime;
+            return td;
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief 被唤醒线程的vruntime比当前线程小一个唤醒粒度以上时抢占
+ *
+ * @param curr
+ * @param td
+ * @return bool
+ */
+static bool fair_preempt(thread_t *curr, thread_t *td)
+{
+    return (int64_t)(curr->td_vruntime - td->td_vruntime) > (int64_t)SCHED_WAKEUP_GRAN_CYCLES;
+}
+/**
+ * @brief 累加加权的虚拟运行时间
+ *
+ * @param rq
+ * @param td
+ * @param delta 本次运行时间
+ */
+static void fair_update(runq_t *rq, thread_t *td, uint64_t delta)
+{
+    td->td_vruntime += delta * NICE_0_WEIGHT / fair_weight(td);
+    fair_update_min_vruntime(rq, td);
+}
+/**
+ * @brief 最小粒度(周期数)
+ *
+ * @return uint64_t
+ */
+static inline uint64_t fair_min_granularity(void)
+{
+    return clocksource_us2cyc(__atomic_load_n(&sched_min_granularity_us, __ATOMIC_RELAXED));
+}
+/**
+ * @brief 当前线程在本调度周期内应得的运行时间
+ *
+ * @param rq
+ * @param td
+ * @return uint64_t
+ */
+static uint64_t fair_slice(runq_t *rq, thread_t *td)
+{
+    uint64_t nr = rq->rq_fair_nr + 1;
+    uint64_t min_gran = fair_min_granularity();
+    uint64_t period = SCHED_LATENCY_CYCLES;
+    if (nr * min_gran > period)
+    {
+        /* 线程过多时拉长调度周期，保证最小粒度*/
+        period = nr * min_gran;
+    }
+    uint64_t weight = fair_weight(td);
+    uint64_t slice = period * weight / (rq->rq_fair_load + weight);
+    return slice < min_gran ? min_gran : slice;
+}
+/**
+ * @brief 用完应得的运行时间，或者领先最左线程超过应得时间时重新调度
+ *
+ * @param rq
+ * @param td
+ * @return bool
+ */
+static bool fair_tick(runq_t *rq, thread_t *td)
+{
+    rb_node_t *left = rb_first(&rq->rq_fair_root);
+    if (left == NULL)
+    {
+        return false;
+    }
+    uint64_t slice = fair_slice(rq, td);
+    uint64_t ran = td->td_sum_exec - td->td_prev_sum_exec;
+    if (ran >= slice)
+    {
+        return true;
+    }
+    if (ran < fair_min_granularity())
+    {
+        return false;
+    }
+    int64_t lead = (int64_t)(td->td_vruntime - rb_entry(left, thread_t, td_rbnode)->td_vruntime);
+    return lead > (int64_t)slice;
+}
+/**
+ * @brief 正在运行的线程睡眠或离开公平类：vruntime保存为相对值
+ *
+ * @param rq
+ * @param td
+ */
+static void fair_detach(runq_t *rq, thread_t *td)
+{
+    td->td_vruntime -= rq->rq_min_vruntime;
+}
+/**
+ * @brief 正在运行的线程切换到公平类：相对值转换为本队列的vruntime
+ *
+ * @param rq
+ * @param td
+ */
+static void fair_attach(runq_t *rq, thread_t *td)
+{
+    td->td_vruntime += rq->rq_min_vruntime;
+}
+/**
+ * @brief 是否有就绪的公平类线程
+ *
+ * @param rq
+ * @return bool
+ */
+static bool fair_ready(runq_t *rq)
+{
+    return !rb_empty(&rq->rq_fair_root);
+}
+/**
+ * @brief 设置最小粒度
+ *
+ * @param us 微秒，取值范围[100us, 调度周期]
+ * @return err_t 成功返回0，超出范围时返回-EINVAL
+ */
+err_t sched_set_min_granularity(uint64_t us)
+{
+    if (us < SCHED_MIN_GRAN_US_MIN || clocksource_us2cyc(us) > SCHED_LATENCY_CYCLES)
+    {
+        return -EINVAL;
+    }
+    __atomic_store_n(&sched_min_granularity_us, us, __ATOMIC_RELAXED);
+    return 0;
+}
+
+const sched_class_t fair_sched_class = {
+    .sc_enqueue = fair_enqueue,
+    .sc_dequeue = fair_dequeue,
+    .sc_pick = fair_pick,
+    .sc_steal = fair_steal,
+    .sc_preempt = fair_preempt,
+    .sc_tick = fair_tick,
+    .sc_update = fair_update,
+    .sc_detach = fair_detach,
+    .sc_attach = fair_attach,
+    .sc_ready = fair_ready,
+};
@@ -0,0 +1,158 @@
+#include "common/types.h"
+#include "common/bitops.h"
+#include "process/sched.h"
+#include "process/thread.h"
+#include "lib/queue.h"
+#include "common/rv64.h"
+
+/**
+ * 实时调度类
+ * 每个优先级一个TAILQ，rq_rt_bitmap记录非空的优先级
+ * 优先级p对应第63-p位，最高优先级即位图的前导零个数，选择线程的时间与就绪线程数量无关
+ */
+
+/**
+ * @brief 优先级对应的位图掩码
+ *
+ * @param prio
+ * @return uint64_t
+ */
+static inline uint64_t rt_prio_bit(int32_t prio)
+{
+    return 1ul << (RT_PRIO_LEVELS - 1 - prio);
+}
+/**
+ * @brief 加入对应优先级队列的尾部
+ *
+ * @param rq
+ * @param td
+ * @param flags 入队标志(未使用)
+ */
+static void rt_enqueue(runq_t *rq, thread_t *td, uint32_t flags)
+{
+    int32_t prio = td->td_prio;
+    TAILQ_INSERT_TAIL(&rq->rq_rt_queue[prio], td, td_runq);
+    rq->rq_rt_bitmap |= rt_prio_bit(prio);
+}
+/**
+ * @brief 从优先级队列中移除线程
+ *
+ * @param rq
+ * @param td
+ * @param prio 线程所在的队列
+ */
+static void rt_remove(runq_t *rq, thread_t *td, int32_t prio)
+{
+    TAILQ_REMOVE(&rq->rq_rt_queue[prio], td, td_runq);
+    if (TAILQ_EMPTY(&rq->rq_rt_queue[prio]))
+    {
+        rq->rq_rt_bitmap &= ~rt_prio_bit(prio);
+    }
+}
+/**
+ * @brief 从就绪队列中移除指定线程(修改调度参数前调用)
+ *
+ * @param rq
+ * @param td
+ */
+static void rt_dequeue(runq_t *rq, thread_t *td)
+{
+    rt_remove(rq, td, td->td_prio);
+}
+/**
+ * @brief 取出最高优先级队列的第一个线程：O(1)
+ *
+ * @param rq
+ * @return thread_t*
+ */
+static thread_t *rt_pick(runq_t *rq)
+{
+    if (rq->rq_rt_bitmap == 0)
+    {
+        return NULL;
+    }
+    int32_t prio = clz64(rq->rq_rt_bitmap);
+    thread_t *td = TAILQ_FIRST(&rq->rq_rt_queue[prio]);
+    rt_remove(rq, td, prio);
+    return td;
+}
+/**
+ * @brief 按优先级从高到低查找一个允许迁移到cpu的线程
+ *
+ * @param rq
+ * @param cpu 目标核心
+ * @param cold 是否只选择缓存冷的线程
+ * @return thread_t*
+ */
+static thread_t *rt_steal(runq_t *rq, uint64_t cpu, bool cold)
+{
+    uint64_t bitmap = rq->rq_rt_bitmap;
+    uint64_t now = read_rdtime();
+    while (bitmap)
+    {
+        int32_t prio = clz64(bitmap);
+        bitmap &= ~rt_prio_bit(prio);
+        thread_t *td;
+        TAILQ_FOREACH(td, &rq->rq_rt_queue[prio], td_runq)
+        {
+            if ((td->td_affinity & (1ul << cpu)) && (!cold || sched_cache_cold(td, now)))
+            {
+                rt_remove(rq, td, prio);
+                return td;
+            }
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief 优先级更高的实时线程抢占当前线程
+ *
+ * @param curr
+ * @param td
+ * @return bool
+ */
+static bool rt_preempt(thread_t *curr, thread_t *td)
+{
+    return td->td_prio < curr->td_prio;
+}
+/**
+ * @brief SCHED_RR线程时间片耗尽后让给同优先级的线程，SCHED_FIFO线程一直运行
+ *
+ * @param rq
+ * @param td
+ * @return bool
+ */
+static bool rt_tick(runq_t *rq, thread_t *td)
+{
+    if (td->td_policy != SCHED_RR)
+    {
+        return false;
+    }
+    if (td->td_slice > 0)
+    {
+        td->td_slice--;
+    }
+    /* 只有同优先级有其他线程时才需要轮转*/
+    return td->td_slice == 0 && !TAILQ_EMPTY(&rq->rq_rt_queue[td->td_prio]);
+}
+
+/**
+ * @brief 是否有就绪的实时线程
+ *
+ * @param rq
+ * @return bool
+ */
+static bool rt_ready(runq_t *rq)
+{
+    return rq->rq_rt_bitmap != 0;
+}
+
+const sched_class_t rt_sched_class = {
+    .sc_enqueue = rt_enqueue,
+    .sc_dequeue = rt_dequeue,
+    .sc_pick = rt_pick,
+    .sc_steal = rt_steal,
+    .sc_preempt = rt_preempt,
+    .sc_tick = rt_tick,
+    .sc_ready = rt_ready,
+};
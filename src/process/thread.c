@@ -7,13 +7,14 @@
 #include "mmu/mmu.h"
 #include "mmu/vmm.h"
 #include "mmu/pmm.h"
-threadq_t thread_runq;   /* 运行队列(全局)*/
+#include "process/sched.h"
+#include "lib/string.h"
+#include "cpu/cpu.h"
 threadq_t thread_freeq;  /* 空闲队列(全局)*/
-threadq_t thread_sleepq; /* 睡眠队列(全局)*/
+threadq_t thread_sleepqs[SLEEPQ_HASH_SIZE]; /* 睡眠队列(按等待通道散列)*/
 
 thread_t *threads = NULL; /* 全局线程数组*/
-
-
+static tid_t next_tid = 1; /* 下一个分配的线程ID*/
 
 /**
  * @brief 线程初始化
@@ -25,9 +26,13 @@ void thread_init(void)
     mutex_init(&first_thread_lock, "first_thread_lock", MUTEX_TYPE_SPIN);
     mutex_init(&td_tid_lock, "td_tid_lock", MUTEX_TYPE_SPIN);
     mutex_init(&wait_lock, "wait_lock", MUTEX_TYPE_SPIN);
-    TAILQ_INIT(&thread_runq.tq_head);
+    mutex_init(&thread_freeq.tq_lock, "thread_freeq", MUTEX_TYPE_SPIN);
     TAILQ_INIT(&thread_freeq.tq_head);
-    TAILQ_INIT(&thread_sleepq.tq_head);
+    for (int i = 0; i < SLEEPQ_HASH_SIZE; i++)
+    {
+        mutex_init(&thread_sleepqs[i].tq_lock, "thread_sleepq", MUTEX_TYPE_SPIN);
+        TAILQ_INIT(&thread_sleepqs[i].tq_head);
+    }
     for (int i = MAX_THREAD_NUM - 1; i >= 0; i--)
     {
         /* 获取当前线程*/
@@ -49,4 +54,123 @@ void thread_init(void)
             pt_map(kernel_root_pte_pa, va, pa, PTE_R | PTE_W);
         }
     }
-}
\ No newline at end of file
+}
+/**
+ * @brief 从空闲队列分配一个线程，清零线程属性区域
+ *
+ * @return thread_t* 没有空闲线程时返回NULL
+ */
+thread_t *thread_alloc(void)
+{
+    mutex_lock(&thread_freeq.tq_lock);
+    thread_t *td = TAILQ_FIRST(&thread_freeq.tq_head);
+    if (td == NULL)
+    {
+        mutex_unlock(&thread_freeq.tq_lock);
+        return NULL;
+    }
+    TAILQ_REMOVE(&thread_freeq.tq_head, td, td_freeq);
+    mutex_unlock(&thread_freeq.tq_lock);
+
+    /* 分配线程ID*/
+    mutex_lock(&td_tid_lock);
+    td->td_tid = next_tid++;
+    mutex_unlock(&td_tid_lock);
+
+    /* 清零属性区域[td_name, td_kstack)*/
+    memset(td->td_name, 0, (uintptr_t)&td->td_kstack - (uintptr_t)td->td_name);
+    td->td_proc = NULL;
+    td->td_lastcpu = cpuid();
+    td->td_affinity = ~0ul;
+    TAILQ_INIT(&td->td_sigqueue);
+    td->td_status = USED;
+    return td;
+}
+/**
+ * @brief 将线程放回空闲队列
+ *
+ * @param td
+ */
+void thread_free(thread_t *td)
+{
+    td->td_status = UNUSED;
+    mutex_lock(&thread_freeq.tq_lock);
+    TAILQ_INSERT_HEAD(&thread_freeq.tq_head, td, td_freeq);
+    mutex_unlock(&thread_freeq.tq_lock);
+}
+/**
+ * @brief 内核线程入口(由kthread_trampoline调用)
+ *        调度器切换过来时持有td_lock，需要先释放
+ *
+ * @param fn 线程函数
+ * @param arg 线程参数
+ */
+void kthread_entry(void (*fn)(void *), void *arg)
+{
+    mutex_unlock(cpu_this.cpu_running->td_lock);
+    fn(arg);
+    kthread_exit(0);
+}
+/**
+ * @brief 创建内核线程，不加入运行队列(调用者设置好属性后调用setrunnable)
+ *
+ * @param fn 线程函数
+ * @param arg 线程参数
+ * @param name 线程名
+ * @return thread_t* 没有空闲线程时返回NULL
+ */
+thread_t *kthread_alloc(void (*fn)(void *), void *arg, const char *name)
+{
+    extern void kthread_trampoline(void);
+    thread_t *td = thread_alloc();
+    if (td == NULL)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < MAX_THREAD_NAME_LEN - 1 && name[i]; i++)
+    {
+        td->td_name[i] = name[i];
+    }
+    /* 首次调度时从kthread_trampoline开始执行，使用内核栈(直接映射地址)的栈顶*/
+    td->td_kcontext.ra = (uint64_t)kthread_trampoline;
+    td->td_kcontext.sp = td->td_kstack + TD_KSTACK_SIZE;
+    td->td_kcontext.s1 = (uint64_t)fn;
+    td->td_kcontext.s2 = (uint64_t)arg;
+    return td;
+}
+/**
+ * @brief 创建内核线程并加入运行队列
+ *
+ * @param fn 线程函数
+ * @param arg 线程参数
+ * @param name 线程名
+ * @return thread_t* 没有空闲线程时返回NULL
+ */
+thread_t *kthread_create(void (*fn)(void *), void *arg, const char *name)
+{
+    thread_t *td = kthread_alloc(fn, arg, name);
+    if (td == NULL)
+    {
+        return NULL;
+    }
+    mutex_lock(td->td_lock);
+    setrunnable(td);
+    mutex_unlock(td->td_lock);
+    return td;
+}
+/**
+ * @brief 内核线程退出，由调度器回收
+ *
+ * @param exitcode 退出码
+ */
+void kthread_exit(err_t exitcode)
+{
+    thread_t *td = cpu_this.cpu_running;
+    mutex_lock(td->td_lock);
+    td->td_exitcode = exitcode;
+    td->td_status = ZOMBIE;
+    sched();
+    /* 僵尸线程不会再被调度*/
+    while (1)
+        ;
+}
@@ -1,211 +1,306 @@
 #include "common/types.h"
-#include "lib/list.h"
+#include "common/errno.h"
+#include "common/rv64.h"
+#include "common/atomic.h"
+#include "common/bitops.h"
 #include "lib/queue.h"
 #include "lock/mutex.h"
-#include "mmu/mmu.h"
-#include "mmu/vmm.h"
-#include "mmu/pmm.h"
+#include "cpu/cpu.h"
+#include "dev/timer.h"
+#include "dev/clocksource.h"
 #include "process/thread.h"
-#include "process/proc.h"
+#include "process/sched.h"
 #include "process/tsleep.h"
 
-tsevent_t tsevents[MAX_SLEEP_EVENT_NUM]; /* 线程睡眠事件数组*/
-tseventq_t tsevent_freeq;                /* 空闲队列*/
-tseventq_t tsevent_usedq;                /* 使用队列*/
+#define TW_INDEX_NONE (0xFFFF) /* 事件不在时间轮中*/
+
+static twheel_t twheels[NCPU]; /* 每个核心的时间轮*/
 
 /**
- * @brief 线程睡眠初始化
+ * @brief 时间轮初始化
  *
  */
 void tsleep_init(void)
 {
-    /* 初始化队列锁*/
-    mutex_init(&tsevent_freeq.tq_lock, "tse_freeq", MUTEX_TYPE_SPIN);
-    mutex_init(&tsevent_usedq.tq_lock, "tse_usedq", MUTEX_TYPE_SPIN);
-    /* 初始化队列*/
-    TAILQ_INIT(&tsevent_freeq.tq_head);
-    TAILQ_INIT(&tsevent_usedq.tq_head);
-    for (int i = MAX_SLEEP_EVENT_NUM - 1; i >= 0; i--)
+    uint64_t now = timer_jiffies();
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
     {
-        tsevent_t *tse = &tsevents[i];
-        tse->tse_waitch = NULL;
-        tse->tse_td = NULL;
-        /* 插入空闲队列*/
-        TAILQ_INSERT_HEAD(&tsevent_freeq.tq_head, tse, tse_freeq);
+        twheel_t *tw = &twheels[cpu];
+        mutex_init(&tw->tw_lock, "twheel", MUTEX_TYPE_SPIN);
+        tw->tw_clk = now;
+        tw->tw_count = 0;
+        tw->tw_next = TIMER_EVENT_NONE;
+        for (uint64_t level = 0; level < TW_LEVELS; level++)
+        {
+            tw->tw_pending[level] = 0;
+            for (uint64_t slot = 0; slot < TW_SLOTS; slot++)
+            {
+                TAILQ_INIT(&tw->tw_slots[level][slot]);
+            }
+        }
     }
 }
 /**
- * @brief 从空闲池分配一个睡眠事件对象，初始化后插入到使用队列
+ * @brief 按到期时间挂入对应层的槽(需持有tw_lock)
+ *        间隔小于64^(k+1)的事件挂入第k层，槽由到期时间的第k组6位决定
  *
- * @param td 线程对象
- * @param chan 通道标识
- * @param wakeus 唤醒时间戳
- * @return tsevent_t*
+ * @param tw
+ * @param tse
  */
-static tsevent_t *tse_alloc(thread_t *td, void *chan, uint64_t wakeus)
+static void tw_enqueue(twheel_t *tw, tsevent_t *tse)
 {
-    /* 空闲队列加锁*/
-    mutex_lock(&tsevent_freeq.tq_lock);
-    if (TAILQ_EMPTY(&tsevent_freeq.tq_head))
+    uint64_t expires = tse->tse_expires;
+    if (expires < tw->tw_clk)
     {
-        /* 空闲队列为空，超出系统要求*/
-        while (1)
-            ;
+        /* 已经到期，在下一个待处理的jiffy触发*/
+        expires = tw->tw_clk;
     }
-    /* 分配一个睡眠事件对象*/
-    tsevent_t *tse = TAILQ_FIRST(&tsevent_freeq.tq_head);
-    /* 从空闲队列中移除*/
-    TAILQ_REMOVE(&tsevent_freeq.tq_head, tse, tse_freeq);
-    /* 空闲队列解锁*/
-    mutex_unlock(&tsevent_freeq.tq_lock);
-
-    /* 初始化睡眠事件对象*/
-    tse->tse_td = td;
-    tse->tse_waitch = chan;
-    tse->tse_wakeus = wakeus;
-
-    /* 使用队列加锁*/
-    mutex_lock(&tsevent_usedq.tq_lock);
-    /* 将睡眠事件插入到合适的位置*/
-    if (wakeus)
+    uint64_t delta = expires - tw->tw_clk;
+    if (delta > TW_MAX_DELTA)
     {
-        /* 事件会自动唤醒*/
-        tsevent_t *temp_tse = NULL;
-        /* 从头开始遍历，找到第一个比wakeus大的元素，插入到其前面*/
-        for (temp_tse = tsevent_usedq.tq_head.tqh_first; temp_tse != NULL; temp_tse = temp_tse->tse_usedq.tqe_next)
-        {
-            if (temp_tse->tse_wakeus > wakeus || temp_tse->tse_wakeus == 0)
-            {
-                break;
-            }
-        }
-        if (temp_tse)
-        {
-            /* 插入到temp_tse前面*/
-            TAILQ_INSERT_BEFORE(temp_tse, tse, tse_usedq);
-        }
-        else
-        {
-            /* wakeus是队列中最大的唤醒时间，插入到最后*/
-            TAILQ_INSERT_TAIL(&tsevent_usedq.tq_head, tse, tse_usedq);
-        }
+        /* 超出时间轮范围：挂入最高层，级联时按真实到期时间重新分配*/
+        delta = TW_MAX_DELTA;
+        expires = tw->tw_clk + delta;
     }
-    else
+    uint64_t level = 0;
+    while (level < TW_LEVELS - 1 && delta >= (1ul << (TW_LEVEL_BITS * (level + 1))))
     {
-        /* 事件不会自动唤醒*/
-        TAILQ_INSERT_TAIL(&tsevent_usedq.tq_head, tse, tse_usedq);
+        level++;
     }
-    return tse;
+    uint64_t slot = (expires >> (TW_LEVEL_BITS * level)) & TW_SLOT_MASK;
+    TAILQ_INSERT_TAIL(&tw->tw_slots[level][slot], tse, tse_link);
+    tw->tw_pending[level] |= (1ul << slot);
+    tse->tse_index = level * TW_SLOTS + slot;
 }
-
-static void tse_set_unused(tsevent_t *tse, bool timeout)
+/**
+ * @brief 从所在的槽中摘除(需持有tw_lock)
+ *
+ * @param tw
+ * @param tse
+ */
+static void tw_detach(twheel_t *tw, tsevent_t *tse)
 {
-    assert(mtx_hold(&tsevent_usedq.tseq_lock));
-    assert(tse_debug(tse, 1, 0));
-    TAILQ_REMOVE(&tsevent_usedq.tseq_head, tse, tse_usedq);
-    assert(tse_debug(tse, 0, 0));
-    // warn("%08x(%08x) WAS WAKEUP(%d) at %d before %d\n", tse->tse_td->td_tid, tse->tse_td->td_proc->p_pid, timeout, getUSecs(), tse->tse_wakeus);
-    tse->tse_wchan = timeout ? (void *)-1 : NULL;
+    uint64_t level = tse->tse_index / TW_SLOTS;
+    uint64_t slot = tse->tse_index % TW_SLOTS;
+    TAILQ_REMOVE(&tw->tw_slots[level][slot], tse, tse_link);
+    if (TAILQ_EMPTY(&tw->tw_slots[level][slot]))
+    {
+        tw->tw_pending[level] &= ~(1ul << slot);
+    }
+    tse->tse_index = TW_INDEX_NONE;
 }
-
-static err_t tse_free(tsevent_t *tse)
+/**
+ * @brief 下一个需要处理的jiffy：每层下一个非空槽的级联(第0层为到期)时间中的最小值(需持有tw_lock)
+ *        第k层的槽j在tw_clk之后第一个满足低6k位为0且第k组6位等于j的时间点处理
+ *
+ * @param tw
+ * @return uint64_t TIMER_EVENT_NONE表示时间轮为空
+ */
+static uint64_t tw_next_jiffy(twheel_t *tw)
 {
-    err_t r = tse->tse_wchan == NULL ? 0 : -ETIMEDOUT;
-    tse->tse_td = NULL;
-    tse->tse_wchan = NULL;
-    tse->tse_wakeus = 0;
-
-    tseq_critical_enter(&tsevent_freeq);
-    assert(tse_debug(tse, 0, 0));
-    TAILQ_INSERT_HEAD(&tsevent_freeq.tseq_head, tse, tse_freeq);
-    assert(tse_debug(tse, 0, 1));
-    tseq_critical_exit(&tsevent_freeq);
-
-    return r;
+    uint64_t next = TIMER_EVENT_NONE;
+    for (uint64_t level = 0; level < TW_LEVELS; level++)
+    {
+        uint64_t pending = tw->tw_pending[level];
+        if (pending == 0)
+        {
+            continue;
+        }
+        uint64_t shift = TW_LEVEL_BITS * level;
+        /* 不早于tw_clk的第一个本层边界*/
+        uint64_t base = (tw->tw_clk + (1ul << shift) - 1) >> shift;
+        uint64_t rot = base & TW_SLOT_MASK;
+        /* 循环右移，使第0位对应base所在的槽*/
+        uint64_t bits = (pending >> rot) | (pending << ((TW_SLOTS - rot) & TW_SLOT_MASK));
+        uint64_t jiffy = (base + ctz64(bits)) << shift;
+        next = jiffy < next ? jiffy : next;
+    }
+    return next;
 }
-
-// 接口函数
-
 /**
- * @note sleep 的包裹，会额外注册一个超时唤醒事件
+ * @brief 把高层的一个槽重新分配到低层(需持有tw_lock)
+ *
+ * @param tw
+ * @param level
+ * @param slot
  */
-err_t tsleep(void *chan, mutex_t *mtx, const char *msg, u64 wakeus)
+static void tw_cascade(twheel_t *tw, uint64_t level, uint64_t slot)
 {
-    tsevent_t *tse = tse_alloc(cpu_this()->cpu_running, chan, wakeus);
-    // 已经获取了 tsevent_usedq 的锁，释放 mtx 后再睡眠
-    // 睡眠时先获取睡眠队列的锁，然后再释放 tsevent_usedq 的锁
-    log(0, "%08x(%08x) TSLEEP(%s) UNTIL %lu->%lu\n", cpu_this()->cpu_running->td_tid, cpu_this()->cpu_running->td_proc->p_pid, msg, time_mono_us(), wakeus);
-    if (mtx)
+    TAILQ_HEAD(tsevent_t) list;
+    TAILQ_INIT(&list);
+    tsevent_t *tse;
+    /* 先摘到临时链表，避免超出范围的事件重新挂回同一个槽*/
+    while ((tse = TAILQ_FIRST(&tw->tw_slots[level][slot])) != NULL)
     {
-        tseq_critical_exit(&tsevent_usedq);
+        TAILQ_REMOVE(&tw->tw_slots[level][slot], tse, tse_link);
+        TAILQ_INSERT_TAIL(&list, tse, tse_link);
     }
-    sleep(chan, mtx ? mtx : &tsevent_usedq.tseq_lock, msg);
-    if (mtx)
+    tw->tw_pending[level] &= ~(1ul << slot);
+    while ((tse = TAILQ_FIRST(&list)) != NULL)
     {
-        tseq_critical_enter(&tsevent_usedq);
+        TAILQ_REMOVE(&list, tse, tse_link);
+        tw_enqueue(tw, tse);
     }
-    err_t r = tse_free(tse);
-    tseq_critical_exit(&tsevent_usedq);
-    return r;
 }
-
-void twakeup(void *chan)
+/**
+ * @brief 处理tw_clk这个jiffy：级联到达边界的高层槽，唤醒第0层槽中到期的线程(需持有tw_lock)
+ *
+ * @param tw
+ */
+static void tw_run(twheel_t *tw)
 {
-    tseq_critical_enter(&tsevent_usedq);
-    tsevent_t *tse;
-    while (1)
+    uint64_t clk = tw->tw_clk;
+    for (uint64_t level = TW_LEVELS - 1; level >= 1; level--)
     {
-        int removed = 0;
-        TAILQ_FOREACH(tse, &tsevent_usedq.tseq_head, tse_usedq)
+        uint64_t shift = TW_LEVEL_BITS * level;
+        if ((clk & ((1ul << shift) - 1)) == 0)
         {
-            if (tse->tse_wchan == chan)
-            {
-                tse_set_unused(tse, false);
-                removed = 1;
-            }
+            tw_cascade(tw, level, (clk >> shift) & TW_SLOT_MASK);
         }
-        if (!removed)
-            break;
     }
-    wakeup(chan);
-    tseq_critical_exit(&tsevent_usedq);
+    uint64_t slot = clk & TW_SLOT_MASK;
+    tsevent_t *tse;
+    while ((tse = TAILQ_FIRST(&tw->tw_slots[0][slot])) != NULL)
+    {
+        tw_detach(tw, tse);
+        tw->tw_count--;
+        /* 线程可能已经被正常唤醒，此时不算超时*/
+        tse->tse_fired = wakeup_thread(tse->tse_td, tse->tse_waitch);
+    }
+    tw->tw_clk = clk + 1;
 }
-
-void tcleanup(thread_t *td)
+/**
+ * @brief 挂入超时事件(需关闭中断，事件由当前核心的时间轮处理)
+ *
+ * @param tw
+ * @param tse
+ */
+static void tw_add(twheel_t *tw, tsevent_t *tse)
 {
-    tseq_critical_enter(&tsevent_usedq);
-    tsevent_t *tse;
-    while (1)
+    mutex_lock(&tw->tw_lock);
+    tse->tse_wheel = tw;
+    tw_enqueue(tw, tse);
+    tw->tw_count++;
+    WRITE_ONCE(tw->tw_next, tw_next_jiffy(tw));
+    mutex_unlock(&tw->tw_lock);
+}
+/**
+ * @brief 取消超时事件(可以在任意核心调用)，返回时超时处理一定已经结束
+ *
+ * @param tse
+ */
+static void tw_del(tsevent_t *tse)
+{
+    twheel_t *tw = tse->tse_wheel;
+    mutex_lock(&tw->tw_lock);
+    if (tse->tse_index != TW_INDEX_NONE)
     {
-        int removed = 0;
-        TAILQ_FOREACH(tse, &tsevent_usedq.tseq_head, tse_usedq)
-        {
-            if (tse->tse_td == td)
-            {
-                tse_set_unused(tse, false);
-                removed = 1;
-            }
-        }
-        if (!removed)
-            break;
+        tw_detach(tw, tse);
+        tw->tw_count--;
+        /* tw_next可能偏早，最多产生一次多余的定时器中断*/
     }
-    tseq_critical_exit(&tsevent_usedq);
+    mutex_unlock(&tw->tw_lock);
 }
-
-void tsleep_check()
+/**
+ * @brief 计算到期jiffy：在[wakeus, wakeus + slackus]内选择低位为0最多的jiffy
+ *        相近的超时取整到同一个边界，在同一次定时器中断中一起触发
+ *
+ * @param wakeus
+ * @param slackus
+ * @return uint64_t
+ */
+static uint64_t tsleep_expires(uint64_t wakeus, uint64_t slackus)
 {
-    tseq_critical_enter(&tsevent_usedq);
-    tsevent_t *tse;
-    u64 now = time_mono_us();
-    while ((tse = TAILQ_FIRST(&tsevent_usedq.tseq_head)))
+    /* 向上取整，保证不会提前唤醒*/
+    uint64_t expires = clocksource_cyc2jiffies(clocksource_us2cyc(wakeus) + JAEOS_TIME_CYCLES - 1);
+    uint64_t limit = clocksource_cyc2jiffies(clocksource_us2cyc(wakeus + slackus));
+    if (limit <= expires)
     {
-        if (tse->tse_wakeus > now || tse->tse_wakeus == 0)
+        return expires;
+    }
+    uint64_t mask = (1ul << (fls64(expires ^ limit) - 1)) - 1;
+    return limit & ~mask;
+}
+/**
+ * @brief sleep的包裹，额外注册一个超时唤醒事件
+ *
+ * @param chan 等待的地址
+ * @param mtx 保护等待条件的锁(可以为NULL)
+ * @param msg 等待原因
+ * @param wakeus 唤醒时间(单调时钟微秒)，为0时不超时
+ * @param slackus 允许推迟唤醒的时间(微秒)
+ * @return err_t 被唤醒返回0，超时返回-ETIMEDOUT
+ */
+err_t tsleep_slack(void *chan, mutex_t *mtx, const char *msg, uint64_t wakeus, uint64_t slackus)
+{
+    if (wakeus == 0)
+    {
+        sleep(chan, mtx, msg);
+        return 0;
+    }
+    if (time_mono_us() >= wakeus)
+    {
+        return -ETIMEDOUT;
+    }
+    tsevent_t tse;
+    tse.tse_td = cpu_this.cpu_running;
+    tse.tse_waitch = chan;
+    tse.tse_fired = false;
+    tse.tse_expires = tsleep_expires(wakeus, slackus);
+    /* 关中断直到线程进入睡眠队列：超时只在本核心处理，不会在睡眠之前触发而丢失
+     * 切换到下一个线程时调度器会按新的超时重新编程定时器*/
+    register_t sie = disable_si();
+    tw_add(&twheels[cpuid()], &tse);
+    sleep(chan, mtx, msg);
+    restore_si(sie);
+    tw_del(&tse);
+    return tse.tse_fired ? -ETIMEDOUT : 0;
+}
+/**
+ * @brief 带超时的睡眠，默认松弛量为超时时长的1/256
+ *
+ * @param chan
+ * @param mtx
+ * @param msg
+ * @param wakeus 唤醒时间(单调时钟微秒)，为0时不超时
+ * @return err_t 被唤醒返回0，超时返回-ETIMEDOUT
+ */
+err_t tsleep(void *chan, mutex_t *mtx, const char *msg, uint64_t wakeus)
+{
+    uint64_t now = time_mono_us();
+    uint64_t slackus = wakeus > now ? (wakeus - now) >> TSLEEP_SLACK_SHIFT : 0;
+    return tsleep_slack(chan, mtx, msg, wakeus, slackus);
+}
+/**
+ * @brief 定时器中断中调用：推进当前核心的时间轮到当前jiffy
+ *        中间没有非空槽的jiffy直接跳过，停止tick后追赶的开销与事件数量相关，与经过的时间无关
+ */
+void tsleep_check(void)
+{
+    twheel_t *tw = &twheels[cpuid()];
+    uint64_t now = timer_jiffies();
+    mutex_lock(&tw->tw_lock);
+    while (tw->tw_clk <= now)
+    {
+        uint64_t next = tw_next_jiffy(tw);
+        if (next > now)
         {
+            tw->tw_clk = now + 1;
             break;
         }
-        void *chan = tse->tse_wchan;
-        tse_set_unused(tse, true);
-        wakeup(chan);
+        tw->tw_clk = next;
+        tw_run(tw);
     }
-    tseq_critical_exit(&tsevent_usedq);
+    WRITE_ONCE(tw->tw_next, tw_next_jiffy(tw));
+    mutex_unlock(&tw->tw_lock);
+}
+/**
+ * @brief 当前核心时间轮的下一次事件(不加锁读取缓存，持有任何锁时都可以调用)
+ *
+ * @return uint64_t 绝对时间(rdtime)，TIMER_EVENT_NONE表示没有事件
+ */
+uint64_t tsleep_next_event(void)
+{
+    uint64_t next = READ_ONCE(twheels[cpuid()].tw_next);
+    return next == TIMER_EVENT_NONE ? TIMER_EVENT_NONE : next * JAEOS_TIME_CYCLES;
 }
@@ -0,0 +1,507 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/atomic.h"
+#include "common/rv64.h"
+#include "lock/mutex.h"
+#include "mmu/mmu.h"
+#include "mmu/vmm.h"
+#include "mmu/pmm.h"
+#include "lib/string.h"
+#include "dev/uart.h"
+#include "dev/clocksource.h"
+#include "dev/hrtimer.h"
+#include "process/proc.h"
+#include "process/thread.h"
+#include "process/sched.h"
+#include "process/futex.h"
+#include "process/uring.h"
+
+#define URING_IO_CHUNK (128) /* 读写时内核缓冲区大小*/
+
+/**
+ * @brief 进程的队列(内核部分)
+ *
+ */
+typedef struct uring
+{
+    mutex_t ur_sq_lock;     /* 消费提交队列、轮询线程睡眠/唤醒*/
+    mutex_t ur_cq_lock;     /* 产生完成项、等待完成*/
+    uring_hdr_t *ur_hdr;    /* 头部(内核地址)*/
+    uring_sqe_t *ur_sqes;   /* 提交队列(内核地址)*/
+    uring_cqe_t *ur_cqes;   /* 完成队列(内核地址)*/
+    uint64_t ur_pt;         /* 所属进程的用户页表(轮询线程通过它访问用户空间)*/
+    uint32_t ur_flags;      /* URING_SETUP_*/
+    uint32_t ur_cq_waiters; /* 等待完成的线程数(受ur_cq_lock保护)*/
+    uint64_t ur_sq_idle_us; /* 轮询线程空闲多久后睡眠*/
+    thread_t *ur_sqthread;  /* 轮询线程*/
+    bool ur_setup;          /* 正在创建(受uring_lock保护)*/
+} uring_t;
+
+/**
+ * @brief 超时事件(回调中通过第一个成员找到整个结构体)
+ *
+ */
+typedef struct uring_timeout
+{
+    hrtimer_t ut_timer;            /* 定时器*/
+    uring_t *ut_ring;              /* 所属队列*/
+    uint64_t ut_user_data;         /* 完成项的user_data*/
+    struct uring_timeout *ut_next; /* 空闲链表*/
+} uring_timeout_t;
+
+static uring_t urings[MAX_PROC_NUM];                        /* 每个进程最多一组队列*/
+static uring_timeout_t uring_timeouts[URING_TIMEOUT_POOL]; /* 超时事件池*/
+static uring_timeout_t *uring_timeout_free;                 /* 空闲超时事件(受uring_lock保护)*/
+
+/**
+ * @brief 初始化队列和超时事件池
+ *
+ */
+void uring_init(void)
+{
+    mutex_init(&uring_lock, "uring_lock", MUTEX_TYPE_SPIN);
+    for (int i = 0; i < MAX_PROC_NUM; i++)
+    {
+        mutex_init(&urings[i].ur_sq_lock, "uring_sq", MUTEX_TYPE_SPIN);
+        mutex_init(&urings[i].ur_cq_lock, "uring_cq", MUTEX_TYPE_SPIN);
+    }
+    uring_timeout_free = NULL;
+    for (int i = URING_TIMEOUT_POOL - 1; i >= 0; i--)
+    {
+        uring_timeouts[i].ut_next = uring_timeout_free;
+        uring_timeout_free = &uring_timeouts[i];
+    }
+}
+/**
+ * @brief 产生一个完成项，唤醒等待完成的线程
+ *
+ * @param ur
+ * @param user_data
+ * @param res
+ */
+static void uring_post_cqe(uring_t *ur, uint64_t user_data, int32_t res)
+{
+    uring_hdr_t *hdr = ur->ur_hdr;
+    mutex_lock(&ur->ur_cq_lock);
+    uint32_t tail = hdr->cq_tail;
+    if (tail - READ_ONCE(hdr->cq_head) >= URING_CQ_ENTRIES)
+    {
+        /* 用户没有及时读取，丢弃并计数*/
+        WRITE_ONCE(hdr->cq_overflow, hdr->cq_overflow + 1);
+    }
+    else
+    {
+        uring_cqe_t *cqe = &ur->ur_cqes[tail & (URING_CQ_ENTRIES - 1)];
+        cqe->user_data = user_data;
+        cqe->res = res;
+        cqe->flags = 0;
+        /* 先写完成项，再发布cq_tail*/
+        smp_wmb();
+        WRITE_ONCE(hdr->cq_tail, tail + 1);
+    }
+    if (ur->ur_cq_waiters)
+    {
+        wakeup(&ur->ur_cq_waiters);
+    }
+    mutex_unlock(&ur->ur_cq_lock);
+}
+/**
+ * @brief 取出一个提交项(复制到内核，之后用户修改该槽不影响处理)
+ *
+ * @param ur
+ * @param sqe
+ * @return bool 提交队列为空时返回false
+ */
+static bool uring_fetch_sqe(uring_t *ur, uring_sqe_t *sqe)
+{
+    uring_hdr_t *hdr = ur->ur_hdr;
+    mutex_lock(&ur->ur_sq_lock);
+    uint32_t head = hdr->sq_head;
+    if (head == READ_ONCE(hdr->sq_tail))
+    {
+        mutex_unlock(&ur->ur_sq_lock);
+        return false;
+    }
+    /* 读到sq_tail之后再读提交项*/
+    smp_rmb();
+    *sqe = ur->ur_sqes[head & (URING_SQ_ENTRIES - 1)];
+    /* 读完提交项之后才把槽位还给用户*/
+    smp_mb();
+    WRITE_ONCE(hdr->sq_head, head + 1);
+    mutex_unlock(&ur->ur_sq_lock);
+    return true;
+}
+/**
+ * @brief 写：fd 1/2输出到控制台
+ *
+ * @param ur
+ * @param sqe
+ * @return int32_t 写入的字节数
+ */
+static int32_t uring_write(uring_t *ur, const uring_sqe_t *sqe)
+{
+    if (sqe->fd != 1 && sqe->fd != 2)
+    {
+        return -EBADF;
+    }
+    uint8_t buf[URING_IO_CHUNK];
+    uint32_t done = 0;
+    while (done < sqe->len && done < INT32_MAX)
+    {
+        uint32_t n = sqe->len - done < URING_IO_CHUNK ? sqe->len - done : URING_IO_CHUNK;
+        if (copyin(ur->ur_pt, buf, sqe->addr + done, n) < 0)
+        {
+            return done ? (int32_t)done : -EFAULT;
+        }
+        /* 一次输出一块，与printf互斥*/
+        mutex_lock(&pr_lock);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            uart_putchar(buf[i]);
+        }
+        mutex_unlock(&pr_lock);
+        done += n;
+    }
+    return (int32_t)done;
+}
+/**
+ * @brief 读：fd 0从控制台读取已经到达的字符(不阻塞)
+ *
+ * @param ur
+ * @param sqe
+ * @return int32_t 读取的字节数
+ */
+static int32_t uring_read(uring_t *ur, const uring_sqe_t *sqe)
+{
+    if (sqe->fd != 0)
+    {
+        return -EBADF;
+    }
+    uint8_t buf[URING_IO_CHUNK];
+    uint32_t done = 0;
+    while (done < sqe->len && done < INT32_MAX)
+    {
+        uint32_t n = 0;
+        uint32_t max = sqe->len - done < URING_IO_CHUNK ? sqe->len - done : URING_IO_CHUNK;
+        int8_t ch;
+        while (n < max && (ch = uart_getchar()) != -1)
+        {
+            buf[n++] = (uint8_t)ch;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        if (copyout(ur->ur_pt, sqe->addr + done, buf, n) < 0)
+        {
+            return done ? (int32_t)done : -EFAULT;
+        }
+        done += n;
+    }
+    return (int32_t)done;
+}
+/**
+ * @brief 超时回调：产生结果为-ETIME的完成项，归还超时事件
+ *
+ * @param hr
+ * @return hrtimer_restart_t
+ */
+static hrtimer_restart_t uring_timeout_fn(hrtimer_t *hr)
+{
+    uring_timeout_t *ut = (uring_timeout_t *)hr;
+    /* 进入回调后定时器不再被访问，可以立即归还*/
+    uring_post_cqe(ut->ut_ring, ut->ut_user_data, -ETIME);
+    mutex_lock(&uring_lock);
+    ut->ut_next = uring_timeout_free;
+    uring_timeout_free = ut;
+    mutex_unlock(&uring_lock);
+    return HRTIMER_NORESTART;
+}
+/**
+ * @brief 超时：启动定时器，完成项在到期时产生
+ *
+ * @param ur
+ * @param sqe
+ * @return int32_t
+ */
+static int32_t uring_timeout(uring_t *ur, const uring_sqe_t *sqe)
+{
+    timespec_t ts;
+    if (copyin(ur->ur_pt, &ts, sqe->addr, sizeof(ts)) < 0)
+    {
+        return -EFAULT;
+    }
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= (int64_t)NSEC_PER_SEC)
+    {
+        return -EINVAL;
+    }
+    uint64_t ns = timespec_to_ns(&ts);
+    mutex_lock(&uring_lock);
+    uring_timeout_t *ut = uring_timeout_free;
+    if (ut != NULL)
+    {
+        uring_timeout_free = ut->ut_next;
+    }
+    mutex_unlock(&uring_lock);
+    if (ut == NULL)
+    {
+        return -EBUSY;
+    }
+    ut->ut_ring = ur;
+    ut->ut_user_data = sqe->user_data;
+    hrtimer_init(&ut->ut_timer, uring_timeout_fn, HRTIMER_MODE_HARD);
+    hrtimer_start(&ut->ut_timer, read_rdtime() + clocksource_ns2cyc(ns));
+    return 0;
+}
+/**
+ * @brief 执行一个提交项
+ *
+ * @param ur
+ * @param sqe
+ */
+static void uring_issue(uring_t *ur, const uring_sqe_t *sqe)
+{
+    int32_t res;
+    switch (sqe->opcode)
+    {
+    case URING_OP_NOP:
+        res = 0;
+        break;
+    case URING_OP_READ:
+        res = uring_read(ur, sqe);
+        break;
+    case URING_OP_WRITE:
+        res = uring_write(ur, sqe);
+        break;
+    case URING_OP_FUTEX_WAKE:
+        res = (int32_t)futex_wake(ur->ur_pt, sqe->addr, sqe->len);
+        break;
+    case URING_OP_TIMEOUT:
+        res = uring_timeout(ur, sqe);
+        if (res == 0)
+        {
+            /* 到期时产生完成项*/
+            return;
+        }
+        break;
+    default:
+        WRITE_ONCE(ur->ur_hdr->sq_dropped, ur->ur_hdr->sq_dropped + 1);
+        res = -EINVAL;
+        break;
+    }
+    uring_post_cqe(ur, sqe->user_data, res);
+}
+/**
+ * @brief 消费最多nr个提交项
+ *
+ * @param ur
+ * @param nr
+ * @return uint32_t 消费的数量
+ */
+static uint32_t uring_submit(uring_t *ur, uint32_t nr)
+{
+    uring_sqe_t sqe;
+    uint32_t done = 0;
+    while (done < nr && uring_fetch_sqe(ur, &sqe))
+    {
+        uring_issue(ur, &sqe);
+        done++;
+    }
+    return done;
+}
+/**
+ * @brief 提交队列轮询线程：有提交时立即处理，空闲超过ur_sq_idle_us后睡眠
+ *
+ * @param arg
+ */
+static void uring_sqpoll(void *arg)
+{
+    uring_t *ur = (uring_t *)arg;
+    uring_hdr_t *hdr = ur->ur_hdr;
+    uint64_t idle_since = time_mono_us();
+    while (1)
+    {
+        if (uring_submit(ur, URING_SQ_ENTRIES) != 0)
+        {
+            idle_since = time_mono_us();
+            continue;
+        }
+        if (time_mono_us() - idle_since < ur->ur_sq_idle_us)
+        {
+            yield();
+            continue;
+        }
+        /* 先设置NEED_WAKEUP再检查提交队列：用户提交后看到该标志会通过io_uring_enter唤醒*/
+        mutex_lock(&ur->ur_sq_lock);
+        WRITE_ONCE(hdr->sq_flags, hdr->sq_flags | URING_SQ_NEED_WAKEUP);
+        smp_mb();
+        if (READ_ONCE(hdr->sq_tail) == hdr->sq_head)
+        {
+            sleep(&ur->ur_sqthread, &ur->ur_sq_lock, "uring_sqpoll");
+        }
+        WRITE_ONCE(hdr->sq_flags, hdr->sq_flags & ~URING_SQ_NEED_WAKEUP);
+        mutex_unlock(&ur->ur_sq_lock);
+        idle_since = time_mono_us();
+    }
+}
+/**
+ * @brief 取消映射并释放前n个队列页
+ *
+ * @param pt
+ * @param pages
+ * @param n
+ */
+static void uring_pages_unmap(uint64_t pt, uint64_t *pages, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        pt_unmap(pt, URING_VMA + i * PAGE_SIZE);
+        free_km(pages[i]);
+    }
+}
+/**
+ * @brief 分配队列页(分配时已清零)并映射到用户空间URING_VMA，内核通过物理地址直接访问，队列持有一个引用
+ *
+ * @param pt
+ * @param pages 输出的物理地址
+ * @return err_t 没有空闲页时返回-ENOMEM，已经映射的页全部释放
+ */
+static err_t uring_pages_map(uint64_t pt, uint64_t *pages)
+{
+    for (int i = 0; i < URING_PAGE_NUM; i++)
+    {
+        Page *page = alloc_k_page();
+        if (page == NULL)
+        {
+            uring_pages_unmap(pt, pages, i);
+            return -ENOMEM;
+        }
+        page_ref_inc(page);
+        pages[i] = Page2Pa(page);
+        if (pt_map(pt, URING_VMA + i * PAGE_SIZE, pages[i], PTE_R | PTE_W | PTE_U) < 0)
+        {
+            uring_pages_unmap(pt, pages, i + 1);
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief io_uring_setup：创建进程的队列并映射到URING_VMA
+ *
+ * @param p
+ * @param uparams uring_params_t的用户地址
+ * @return int64_t
+ */
+int64_t uring_setup(proc_t *p, uint64_t uparams)
+{
+    uring_params_t params;
+    if (copyin(p->p_pt, &params, uparams, sizeof(params)) < 0)
+    {
+        return -EFAULT;
+    }
+    if (params.flags & ~URING_SETUP_SQPOLL)
+    {
+        return -EINVAL;
+    }
+    /* 创建完成前只占位，失败时进程还可以重新创建*/
+    uring_t *ur = &urings[p - procs];
+    mutex_lock(&uring_lock);
+    if (p->p_uring != NULL || ur->ur_setup)
+    {
+        mutex_unlock(&uring_lock);
+        return -EEXIST;
+    }
+    ur->ur_setup = true;
+    mutex_unlock(&uring_lock);
+
+    uint64_t pages[URING_PAGE_NUM];
+    err_t err = uring_pages_map(p->p_pt, pages);
+    if (err < 0)
+    {
+        mutex_lock(&uring_lock);
+        ur->ur_setup = false;
+        mutex_unlock(&uring_lock);
+        return err;
+    }
+    uring_hdr_t *hdr = (uring_hdr_t *)pages[0];
+    hdr->sq_mask = URING_SQ_ENTRIES - 1;
+    hdr->cq_mask = URING_CQ_ENTRIES - 1;
+    ur->ur_sqes = (uring_sqe_t *)pages[1];
+    ur->ur_cqes = (uring_cqe_t *)pages[2];
+    ur->ur_pt = p->p_pt;
+    ur->ur_flags = params.flags;
+    ur->ur_cq_waiters = 0;
+    ur->ur_sq_idle_us = (params.sq_thread_idle ? params.sq_thread_idle : URING_SQ_IDLE_DEFAULT_MS) * 1000ul;
+    ur->ur_sqthread = NULL;
+    /* 其他字段初始化完成后才发布头部，io_uring_enter以ur_hdr判断队列是否可用*/
+    smp_wmb();
+    WRITE_ONCE(ur->ur_hdr, hdr);
+    mutex_lock(&uring_lock);
+    p->p_uring = ur;
+    ur->ur_setup = false;
+    mutex_unlock(&uring_lock);
+    if (params.flags & URING_SETUP_SQPOLL)
+    {
+        ur->ur_sqthread = kthread_create(uring_sqpoll, ur, "uring_sqpoll");
+        if (ur->ur_sqthread == NULL)
+        {
+            /* 没有空闲线程时退化为由io_uring_enter消费*/
+            ur->ur_flags &= ~URING_SETUP_SQPOLL;
+        }
+    }
+
+    params.flags = ur->ur_flags;
+    params.sq_entries = URING_SQ_ENTRIES;
+    params.cq_entries = URING_CQ_ENTRIES;
+    params.hdr_addr = URING_VMA;
+    params.sqes_addr = URING_VMA + PAGE_SIZE;
+    params.cqes_addr = URING_VMA + 2 * PAGE_SIZE;
+    return copyout(p->p_pt, uparams, &params, sizeof(params));
+}
+/**
+ * @brief io_uring_enter：消费提交项，唤醒轮询线程，等待完成
+ *
+ * @param p
+ * @param to_submit 最多消费的提交数(轮询模式下忽略)
+ * @param min_complete 等待至少这么多个未读取的完成项(需要URING_ENTER_GETEVENTS)
+ * @param flags URING_ENTER_*
+ * @return int64_t 消费的提交数
+ */
+int64_t uring_enter(proc_t *p, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+    uring_t *ur = READ_ONCE(p->p_uring);
+    if (ur == NULL || READ_ONCE(ur->ur_hdr) == NULL)
+    {
+        return -EBADF;
+    }
+    smp_rmb();
+    uint32_t submitted = 0;
+    if (ur->ur_flags & URING_SETUP_SQPOLL)
+    {
+        if (flags & URING_ENTER_SQ_WAKEUP)
+        {
+            mutex_lock(&ur->ur_sq_lock);
+            wakeup(&ur->ur_sqthread);
+            mutex_unlock(&ur->ur_sq_lock);
+        }
+    }
+    else
+    {
+        submitted = uring_submit(ur, to_submit);
+    }
+    if (flags & URING_ENTER_GETEVENTS)
+    {
+        uring_hdr_t *hdr = ur->ur_hdr;
+        min_complete = min_complete < URING_CQ_ENTRIES ? min_complete : URING_CQ_ENTRIES;
+        mutex_lock(&ur->ur_cq_lock);
+        while (READ_ONCE(hdr->cq_tail) - READ_ONCE(hdr->cq_head) < min_complete)
+        {
+            ur->ur_cq_waiters++;
+            sleep(&ur->ur_cq_waiters, &ur->ur_cq_lock, "uring_cq");
+            ur->ur_cq_waiters--;
+        }
+        mutex_unlock(&ur->ur_cq_lock);
+    }
+    return submitted;
+}
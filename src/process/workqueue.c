@@ -0,0 +1,133 @@
+#include "common/types.h"
+#include "common/atomic.h"
+#include "common/rv64.h"
+#include "lock/mutex.h"
+#include "cpu/cpu.h"
+#include "process/thread.h"
+#include "process/sched.h"
+#include "process/workqueue.h"
+
+static workqueue_t workqueues[NCPU]; /* 每个核心的工作队列*/
+
+/**
+ * @brief kworker：取走整条链表，反转为入队顺序后依次执行；队列为空时睡眠
+ *
+ * @param arg 所属核心
+ */
+static void kworker(void *arg)
+{
+    uint64_t cpu = (uint64_t)arg;
+    workqueue_t *wq = &workqueues[cpu];
+    /* 绑定到所属核心(创建时该核心已经上线)*/
+    sched_setaffinity(cpu_this.cpu_running, 1ul << cpu);
+    while (1)
+    {
+        work_t *list = __atomic_exchange_n(&wq->wq_head, NULL, __ATOMIC_ACQUIRE);
+        if (list == NULL)
+        {
+            /* 先声明空闲再检查队列：与queue_work_on的"先入队再检查空闲"配对，不会丢失唤醒*/
+            mutex_lock(&wq->wq_lock);
+            WRITE_ONCE(wq->wq_idle, 1);
+            smp_mb();
+            if (READ_ONCE(wq->wq_head) == NULL)
+            {
+                sleep(wq, &wq->wq_lock, "kworker");
+            }
+            WRITE_ONCE(wq->wq_idle, 0);
+            mutex_unlock(&wq->wq_lock);
+            continue;
+        }
+        work_t *fifo = NULL;
+        while (list != NULL)
+        {
+            work_t *next = list->wk_next;
+            list->wk_next = fifo;
+            fifo = list;
+            list = next;
+        }
+        while (fifo != NULL)
+        {
+            work_t *wk = fifo;
+            fifo = wk->wk_next;
+            /* 执行前清除：回调执行期间再次入队会在下一轮执行*/
+            __atomic_store_n(&wk->wk_pending, 0, __ATOMIC_RELEASE);
+            wk->wk_func(wk);
+        }
+    }
+}
+/**
+ * @brief 初始化每个核心的工作队列
+ *
+ */
+void workqueue_init(void)
+{
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        workqueue_t *wq = &workqueues[cpu];
+        wq->wq_head = NULL;
+        wq->wq_idle = 0;
+        mutex_init(&wq->wq_lock, "workqueue", MUTEX_TYPE_SPIN);
+        wq->wq_worker = NULL;
+    }
+}
+/**
+ * @brief 核心上线：创建该核心的kworker(之前入队的工作项由它开始处理)
+ *
+ * @param cpu
+ */
+void workqueue_cpu_online(uint64_t cpu)
+{
+    workqueue_t *wq = &workqueues[cpu];
+    if (wq->wq_worker != NULL)
+    {
+        return;
+    }
+    wq->wq_worker = kthread_create(kworker, (void *)cpu, "kworker");
+    if (wq->wq_worker == NULL)
+    {
+        while (1)
+            ;
+    }
+}
+/**
+ * @brief 把工作项放入指定核心的队列(可以在中断上下文调用)
+ *
+ * @param cpu
+ * @param wk
+ * @return bool 已经在排队时返回false
+ */
+bool queue_work_on(uint64_t cpu, work_t *wk)
+{
+    if (__atomic_exchange_n(&wk->wk_pending, 1, __ATOMIC_ACQ_REL))
+    {
+        return false;
+    }
+    workqueue_t *wq = &workqueues[cpu];
+    work_t *head = __atomic_load_n(&wq->wq_head, __ATOMIC_RELAXED);
+    do
+    {
+        wk->wk_next = head;
+    } while (!__atomic_compare_exchange_n(&wq->wq_head, &head, wk, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    /* 入队之后再检查kworker是否空闲*/
+    smp_mb();
+    if (READ_ONCE(wq->wq_idle))
+    {
+        mutex_lock(&wq->wq_lock);
+        wakeup(wq);
+        mutex_unlock(&wq->wq_lock);
+    }
+    return true;
+}
+/**
+ * @brief 把工作项放入当前核心的队列
+ *
+ * @param wk
+ * @return bool
+ */
+bool queue_work(work_t *wk)
+{
+    register_t sie = disable_si();
+    bool ret = queue_work_on(cpuid(), wk);
+    restore_si(sie);
+    return ret;
+}
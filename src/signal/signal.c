@@ -1,13 +1,32 @@
 #include "common/types.h"
+#include "common/errno.h"
+#include "common/platform.h"
+#include "common/rv64.h"
+#include "cpu/cpu.h"
 #include "signal/signal.h"
 #include "lock/mutex.h"
 #include "lib/string.h"
+#include "mmu/pmm.h"
+#include "process/proc.h"
 #include "process/thread.h"
 
-sigevent_t *sigevents;      /* 全局信号事件数组*/
-sigeventq_t sigevent_freeq; /* 空闲信号事件队列*/
+/**
+ * @brief 每个核心的空闲信号事件缓存(只在关中断时由本核心访问，不需要加锁)
+ *
+ */
+typedef struct
+{
+    sigevent_t *sc_free; /* 空闲信号事件链表*/
+    uint32_t sc_count;   /* 链表长度*/
+} sigevent_cache_t;
+
+sigevent_t *sigevents;                         /* 启动时预分配的信号事件数组*/
+static sigevent_t *sigevent_stack;             /* 全局空闲信号事件(无锁栈)*/
+static uint32_t sigevent_pages;                /* 已扩充的物理页数*/
+static sigevent_cache_t sigevent_caches[NCPU]; /* 每个核心的空闲信号事件缓存*/
 
-sighandler_set_t *sigactions; /* 全局信号动作数组*/
+static sighand_t sighands[MAX_PROC_NUM]; /* 信号动作表池(动作页按需分配)*/
+static sighand_t *sighand_free;          /* 空闲信号动作表(受sighand_lock保护)*/
 /**
  * @brief 初始化信号
  *
@@ -16,11 +35,562 @@ void signal_init(void)
 {
     /* 初始化信号事件锁*/
     mutex_init(&sigevent_lock, "sigevent_lock", MUTEX_TYPE_SPIN | MUTEX_RECURSE);
+    mutex_init(&sighand_lock, "sighand_lock", MUTEX_TYPE_SPIN);
 
+    /* 预分配的信号事件放入全局空闲栈，各核心第一次分配时再搬到自己的缓存*/
+    sigevent_stack = NULL;
     for (int i = MAX_SIGEVENT_NUM - 1; i >= 0; i--)
     {
-        TAILQ_INSERT_HEAD(&sigevent_freeq.tq_head, &sigevents[i], se_link);
+        sigevents[i].se_free = sigevent_stack;
+        sigevent_stack = &sigevents[i];
+    }
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        sigevent_caches[cpu].sc_free = NULL;
+        sigevent_caches[cpu].sc_count = 0;
+    }
+    sigevent_pages = 0;
+    /* 信号动作表只初始化空闲链表，动作页在设置非默认动作时才分配*/
+    sighand_free = NULL;
+    for (int i = MAX_PROC_NUM - 1; i >= 0; i--)
+    {
+        sighands[i].sh_next = sighand_free;
+        sighand_free = &sighands[i];
+    }
+}
+
+/**
+ * @brief 把一串信号事件[first, last]压入全局空闲栈
+ *
+ * @param first
+ * @param last
+ */
+static void sigevent_stack_push(sigevent_t *first, sigevent_t *last)
+{
+    sigevent_t *head = __atomic_load_n(&sigevent_stack, __ATOMIC_RELAXED);
+    do
+    {
+        last->se_free = head;
+    } while (!__atomic_compare_exchange_n(&sigevent_stack, &head, first, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+/**
+ * @brief 扩充一页信号事件，全部放入缓存
+ *
+ * @param sc
+ * @return bool 达到上限或没有空闲页时返回false
+ */
+static bool sigevent_grow(sigevent_cache_t *sc)
+{
+    if (__atomic_fetch_add(&sigevent_pages, 1, __ATOMIC_RELAXED) >= SIGEVENT_MAX_PAGES)
+    {
+        __atomic_fetch_sub(&sigevent_pages, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    Page *page = alloc_k_page();
+    if (page == NULL)
+    {
+        __atomic_fetch_sub(&sigevent_pages, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    page_ref_inc(page);
+    /* 扩充的页不回收：信号事件只在缓存和空闲栈之间流动*/
+    sigevent_t *se = (sigevent_t *)Page2Pa(page);
+    for (uint64_t i = 0; i < PAGE_SIZE / sizeof(sigevent_t); i++)
+    {
+        se[i].se_free = sc->sc_free;
+        sc->sc_free = &se[i];
+        sc->sc_count++;
+    }
+    return true;
+}
+/**
+ * @brief 从全局空闲栈补充本核心的缓存(需关中断)
+ *        一次取走整个栈(交换为NULL，没有ABA问题)，留下一批，其余压回
+ *        其他核心在取走期间看到栈为空时会扩充一页，代价是多占用少量内存
+ *
+ * @param sc
+ */
+static void sigevent_refill(sigevent_cache_t *sc)
+{
+    sigevent_t *list = __atomic_exchange_n(&sigevent_stack, NULL, __ATOMIC_ACQUIRE);
+    if (list == NULL)
+    {
+        sigevent_grow(sc);
+        return;
+    }
+    while (list != NULL && sc->sc_count < SIGEVENT_CACHE_BATCH)
+    {
+        sigevent_t *se = list;
+        list = se->se_free;
+        se->se_free = sc->sc_free;
+        sc->sc_free = se;
+        sc->sc_count++;
+    }
+    if (list != NULL)
+    {
+        sigevent_t *last = list;
+        while (last->se_free != NULL)
+        {
+            last = last->se_free;
+        }
+        sigevent_stack_push(list, last);
+    }
+}
+/**
+ * @brief 分配信号事件：先从本核心的缓存取，缓存为空时从全局空闲栈补充一批或扩充一页
+ *
+ * @return sigevent_t* 达到扩充上限时返回NULL
+ */
+static sigevent_t *sigevent_alloc(void)
+{
+    register_t sie = disable_si();
+    sigevent_cache_t *sc = &sigevent_caches[cpuid()];
+    if (sc->sc_free == NULL)
+    {
+        sigevent_refill(sc);
+    }
+    sigevent_t *se = sc->sc_free;
+    if (se != NULL)
+    {
+        sc->sc_free = se->se_free;
+        sc->sc_count--;
+    }
+    restore_si(sie);
+    return se;
+}
+/**
+ * @brief 释放信号事件：放回本核心的缓存，超过上限时把一批归还全局空闲栈
+ *
+ * @param se
+ */
+void sigevent_free(sigevent_t *se)
+{
+    register_t sie = disable_si();
+    sigevent_cache_t *sc = &sigevent_caches[cpuid()];
+    se->se_free = sc->sc_free;
+    sc->sc_free = se;
+    if (++sc->sc_count > SIGEVENT_CACHE_MAX)
+    {
+        sigevent_t *first = sc->sc_free;
+        sigevent_t *last = first;
+        for (int i = 1; i < SIGEVENT_CACHE_BATCH; i++)
+        {
+            last = last->se_free;
+        }
+        sc->sc_free = last->se_free;
+        sc->sc_count -= SIGEVENT_CACHE_BATCH;
+        sigevent_stack_push(first, last);
+    }
+    restore_si(sie);
+}
+/**
+ * @brief 重新计算线程的待处理信号汇总字(修改td_sigmask或线程加入进程后也需要调用)
+ *        汇总字 = (线程待处理 | 进程待处理) & ~屏蔽字 是否非空
+ *
+ * @param td
+ */
+void signal_recalc_pending(thread_t *td)
+{
+    sigset_t pending;
+    mutex_lock(&sigevent_lock);
+    if (td->td_proc != NULL)
+    {
+        sigorsets(&pending, &td->td_sigpending, &td->td_proc->p_sigpending);
+    }
+    else
+    {
+        pending = td->td_sigpending;
+    }
+    sigandnsets(&pending, &pending, &td->td_sigmask);
+    WRITE_ONCE(td->td_sigsummary, !sigisemptyset(&pending));
+    mutex_unlock(&sigevent_lock);
+}
+/**
+ * @brief 重新计算进程所有线程的汇总字(进程级待处理位图变化后调用，需持有sigevent_lock)
+ *
+ * @param p
+ */
+static void signal_recalc_proc(proc_t *p)
+{
+    thread_t *td;
+    mutex_lock(p->p_lock);
+    TAILQ_FOREACH(td, &p->p_threadsq, td_plist)
+    {
+        signal_recalc_pending(td);
+    }
+    mutex_unlock(p->p_lock);
+}
+/**
+ * @brief 向线程发送信号
+ *
+ * @param td
+ * @param signo 1~MAX_SIGNAL_NUM
+ * @param status 信号附加状态信息
+ * @return err_t
+ */
+err_t signal_send_thread(thread_t *td, int32_t signo, int32_t status)
+{
+    if (signo < 1 || signo > MAX_SIGNAL_NUM)
+    {
+        return -EINVAL;
+    }
+    sigevent_t *se = sigevent_alloc();
+    if (se == NULL)
+    {
+        return -EAGAIN;
+    }
+    se->se_signo = signo;
+    se->se_status = status;
+    mutex_lock(&sigevent_lock);
+    TAILQ_INSERT_TAIL(&td->td_sigqueue, se, se_link);
+    /* 队列和位图在同一把锁下修改，位图为空即队列为空*/
+    sigaddset(&td->td_sigpending, signo);
+    signal_recalc_pending(td);
+    mutex_unlock(&sigevent_lock);
+    return 0;
+}
+/**
+ * @brief 向进程发送信号(由任意一个未屏蔽该信号的线程处理)
+ *
+ * @param p
+ * @param signo 1~MAX_SIGNAL_NUM
+ * @param status 信号附加状态信息
+ * @return err_t
+ */
+err_t signal_send_proc(proc_t *p, int32_t signo, int32_t status)
+{
+    if (signo < 1 || signo > MAX_SIGNAL_NUM)
+    {
+        return -EINVAL;
+    }
+    sigevent_t *se = sigevent_alloc();
+    if (se == NULL)
+    {
+        return -EAGAIN;
+    }
+    se->se_signo = signo;
+    se->se_status = status;
+    mutex_lock(&sigevent_lock);
+    TAILQ_INSERT_TAIL(&p->p_sigqueue, se, se_link);
+    sigaddset(&p->p_sigpending, signo);
+    signal_recalc_proc(p);
+    mutex_unlock(&sigevent_lock);
+    return 0;
+}
+/**
+ * @brief 在队列中查找第一个信号属于deliverable的事件
+ *
+ * @param se 队列首元素
+ * @param deliverable 可以处理的信号(待处理且未屏蔽)
+ * @return sigevent_t*
+ */
+static sigevent_t *sigevent_find(sigevent_t *se, const sigset_t *deliverable)
+{
+    for (; se != NULL; se = TAILQ_NEXT(se, se_link))
+    {
+        if (sigismember(deliverable, se->se_signo))
+        {
+            return se;
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief 队列中是否还有同一信号的事件
+ *
+ * @param se 队列首元素
+ * @param signo
+ * @return bool
+ */
+static bool sigevent_queued(sigevent_t *se, int32_t signo)
+{
+    for (; se != NULL; se = TAILQ_NEXT(se, se_link))
+    {
+        if (se->se_signo == signo)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/**
+ * @brief 取出线程下一个要处理的信号：先线程级队列，再进程级队列，跳过被屏蔽的信号
+ *        先用位图按字判断有无可处理的信号，没有时不遍历队列；位图变化时同步更新汇总字
+ *
+ * @param td
+ * @return sigevent_t* 没有可处理的信号时返回NULL，处理完后调用sigevent_free
+ */
+sigevent_t *signal_dequeue(thread_t *td)
+{
+    sigset_t deliverable;
+    sigevent_t *se = NULL;
+    mutex_lock(&sigevent_lock);
+    sigandnsets(&deliverable, &td->td_sigpending, &td->td_sigmask);
+    if (!sigisemptyset(&deliverable))
+    {
+        se = sigevent_find(TAILQ_FIRST(&td->td_sigqueue), &deliverable);
+        TAILQ_REMOVE(&td->td_sigqueue, se, se_link);
+        if (!sigevent_queued(TAILQ_FIRST(&td->td_sigqueue), se->se_signo))
+        {
+            sigdelset(&td->td_sigpending, se->se_signo);
+            signal_recalc_pending(td);
+        }
+        mutex_unlock(&sigevent_lock);
+        return se;
+    }
+    proc_t *p = td->td_proc;
+    if (p != NULL)
+    {
+        sigandnsets(&deliverable, &p->p_sigpending, &td->td_sigmask);
+        if (!sigisemptyset(&deliverable))
+        {
+            se = sigevent_find(TAILQ_FIRST(&p->p_sigqueue), &deliverable);
+            TAILQ_REMOVE(&p->p_sigqueue, se, se_link);
+            if (!sigevent_queued(TAILQ_FIRST(&p->p_sigqueue), se->se_signo))
+            {
+                sigdelset(&p->p_sigpending, se->se_signo);
+                signal_recalc_proc(p);
+            }
+        }
+    }
+    mutex_unlock(&sigevent_lock);
+    return se;
+}
+/**
+ * @brief 从池中取出一个空的信号动作表(需持有sighand_lock)
+ *
+ * @return sighand_t* 池为空时返回NULL
+ */
+static sighand_t *sighand_alloc_locked(void)
+{
+    sighand_t *sh = sighand_free;
+    if (sh != NULL)
+    {
+        sighand_free = sh->sh_next;
+        sh->sh_next = NULL;
+        sh->sh_refcnt = 1;
+        for (int i = 0; i < SIGHAND_CHUNKS; i++)
+        {
+            sh->sh_action[i] = NULL;
+        }
+    }
+    return sh;
+}
+/**
+ * @brief 分配一个动作页(分配时已清零，即整页都是默认动作)
+ *
+ * @return sigaction_t* 没有空闲页时返回NULL
+ */
+static sigaction_t *sighand_chunk_alloc(void)
+{
+    Page *page = alloc_k_page();
+    if (page == NULL)
+    {
+        return NULL;
+    }
+    page_ref_inc(page);
+    return (sigaction_t *)Page2Pa(page);
+}
+/**
+ * @brief 分配信号动作表(全部为默认动作，引用计数为1)
+ *
+ * @return sighand_t* 池为空时返回NULL
+ */
+sighand_t *sighand_alloc(void)
+{
+    mutex_lock(&sighand_lock);
+    sighand_t *sh = sighand_alloc_locked();
+    mutex_unlock(&sighand_lock);
+    return sh;
+}
+/**
+ * @brief 共享进程的信号动作表(同一进程的新线程不需要调用，CLONE_SIGHAND创建子进程时调用)
+ *        共享前必须有表头：父进程还没有表时先分配一张空表，父子进程指向同一张表，
+ *        之后任何一方设置的动作对另一方可见，动作页仍然按需分配
+ *
+ * @param p 父进程
+ * @return sighand_t* 池为空时返回NULL
+ */
+sighand_t *sighand_get(proc_t *p)
+{
+    mutex_lock(&sighand_lock);
+    sighand_t *sh = p->p_sighand;
+    if (sh == NULL)
+    {
+        sh = sighand_alloc_locked();
+        if (sh == NULL)
+        {
+            mutex_unlock(&sighand_lock);
+            return NULL;
+        }
+        p->p_sighand = sh;
+    }
+    __atomic_fetch_add(&sh->sh_refcnt, 1, __ATOMIC_RELAXED);
+    mutex_unlock(&sighand_lock);
+    return sh;
+}
+/**
+ * @brief 复制进程的信号动作表(fork)，只复制已经分配的动作页
+ *
+ * @param p 父进程
+ * @param new 输出，父进程没有表(全部为默认动作)时为NULL，子进程同样不分配
+ * @return err_t 池为空或没有空闲页时返回-ENOMEM
+ */
+err_t sighand_copy(proc_t *p, sighand_t **new)
+{
+    *new = NULL;
+    mutex_lock(&sighand_lock);
+    sighand_t *sh = p->p_sighand;
+    if (sh == NULL)
+    {
+        mutex_unlock(&sighand_lock);
+        return 0;
+    }
+    sighand_t *copy = sighand_alloc_locked();
+    if (copy == NULL)
+    {
+        mutex_unlock(&sighand_lock);
+        return -ENOMEM;
+    }
+    for (int i = 0; i < SIGHAND_CHUNKS; i++)
+    {
+        if (sh->sh_action[i] != NULL)
+        {
+            copy->sh_action[i] = sighand_chunk_alloc();
+            if (copy->sh_action[i] == NULL)
+            {
+                mutex_unlock(&sighand_lock);
+                /* 回收已经复制的动作页*/
+                sighand_put(copy);
+                return -ENOMEM;
+            }
+            memcpy(copy->sh_action[i], sh->sh_action[i], SIGHAND_CHUNK_SIGNALS * sizeof(sigaction_t));
+        }
+    }
+    mutex_unlock(&sighand_lock);
+    *new = copy;
+    return 0;
+}
+/**
+ * @brief 释放一个引用，最后一个引用释放时回收动作页并放回池中
+ *
+ * @param sh 可以为NULL
+ */
+void sighand_put(sighand_t *sh)
+{
+    if (sh == NULL || __atomic_sub_fetch(&sh->sh_refcnt, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return;
+    }
+    mutex_lock(&sighand_lock);
+    for (int i = 0; i < SIGHAND_CHUNKS; i++)
+    {
+        if (sh->sh_action[i] != NULL)
+        {
+            free_km((uint64_t)sh->sh_action[i]);
+            sh->sh_action[i] = NULL;
+        }
+    }
+    sh->sh_next = sighand_free;
+    sighand_free = sh;
+    mutex_unlock(&sighand_lock);
+}
+/**
+ * @brief 读取信号动作(需持有sighand_lock)
+ *
+ * @param sh 可以为NULL
+ * @param signo
+ * @param act
+ */
+static void sighand_read(sighand_t *sh, int32_t signo, sigaction_t *act)
+{
+    uint32_t bit = signo - 1;
+    sigaction_t *chunk = sh != NULL ? sh->sh_action[bit / SIGHAND_CHUNK_SIGNALS] : NULL;
+    if (chunk != NULL)
+    {
+        *act = chunk[bit % SIGHAND_CHUNK_SIGNALS];
+    }
+    else
+    {
+        memset(act, 0, sizeof(sigaction_t));
+    }
+}
+/**
+ * @brief 读取进程的信号动作
+ *
+ * @param p
+ * @param signo 1~MAX_SIGNAL_NUM
+ * @param act 输出，未设置过的信号为全零(SIG_DFL)
+ * @return err_t
+ */
+err_t sigaction_get(proc_t *p, int32_t signo, sigaction_t *act)
+{
+    if (signo < 1 || signo > MAX_SIGNAL_NUM)
+    {
+        return -EINVAL;
+    }
+    mutex_lock(&sighand_lock);
+    sighand_read(p->p_sighand, signo, act);
+    mutex_unlock(&sighand_lock);
+    return 0;
+}
+/**
+ * @brief 设置进程的信号动作，对共享同一张表的所有线程和进程生效
+ *        第一次设置非默认动作时才分配动作表和对应的动作页
+ *
+ * @param p
+ * @param signo 1~MAX_SIGNAL_NUM
+ * @param act 新动作(NULL表示只读取)
+ * @param oact 旧动作(可以为NULL)
+ * @return err_t
+ */
+err_t sigaction_set(proc_t *p, int32_t signo, const sigaction_t *act, sigaction_t *oact)
+{
+    if (signo < 1 || signo > MAX_SIGNAL_NUM)
+    {
+        return -EINVAL;
+    }
+    mutex_lock(&sighand_lock);
+    if (oact != NULL)
+    {
+        sighand_read(p->p_sighand, signo, oact);
+    }
+    if (act == NULL)
+    {
+        mutex_unlock(&sighand_lock);
+        return 0;
+    }
+    bool dfl = act->sa_handler == NULL && act->sa_flags == 0 && act->sa_restorer == NULL && sigisemptyset(&act->sa_mask);
+    uint32_t bit = signo - 1;
+    sighand_t *sh = p->p_sighand;
+    if (sh == NULL || sh->sh_action[bit / SIGHAND_CHUNK_SIGNALS] == NULL)
+    {
+        if (dfl)
+        {
+            /* 没有分配的页全部为默认动作，不需要分配*/
+            mutex_unlock(&sighand_lock);
+            return 0;
+        }
+        sigaction_t *chunk = sighand_chunk_alloc();
+        if (chunk == NULL)
+        {
+            mutex_unlock(&sighand_lock);
+            return -ENOMEM;
+        }
+        if (sh == NULL)
+        {
+            sh = sighand_alloc_locked();
+            if (sh == NULL)
+            {
+                mutex_unlock(&sighand_lock);
+                free_km((uint64_t)chunk);
+                return -ENOMEM;
+            }
+            p->p_sighand = sh;
+        }
+        sh->sh_action[bit / SIGHAND_CHUNK_SIGNALS] = chunk;
     }
-    /* 初始化信号动作数组*/
-    memset(sigactions, 0, sizeof(sigaction_t) * MAX_SIGNAL_NUM * MAX_THREAD_NUM);
-}
\ No newline at end of file
+    sh->sh_action[bit / SIGHAND_CHUNK_SIGNALS][bit % SIGHAND_CHUNK_SIGNALS] = *act;
+    mutex_unlock(&sighand_lock);
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include "dev/dtb.h"
 #include "start/main.h"
 extern int main();
+extern void main_secondary(void);
 
 /**
  * @brief 临时异常处理函数
@@ -27,16 +28,34 @@ void _main(uint64_t _hart_id, uint64_t _dtb_entry)
 	write_satp(0L);
 
 	/* 启动S-Mode下的外部中断SEIE/定时器中断STIE/软件中断SSIE*/
-	write_sie(read_sie() | SIE_SEIE | SIE_STIE);
+	write_sie(read_sie() | SIE_SEIE | SIE_STIE | SIE_SSIE);
 
 	/* 读取openSBI提供的dtb地址*/
 	dtb_entry = _dtb_entry;
 	/* 读取openSBI提供的hartid*/
 	hart_id = _hart_id;
+	/* 内核态下tp寄存器始终保存hartid*/
+	write_tp(_hart_id);
 
 	/* 设置临时异常陷入地址*/
 	write_stvec((uint64_t)_trap);
 
 	/* call main*/
 	main();
-}
\ No newline at end of file
+}
+/**
+ * @brief 从核入口(由主核通过SBI HSM启动)
+ *
+ * @param _hart_id
+ */
+void _main_secondary(uint64_t _hart_id)
+{
+	write_satp(0L);
+	/* 启动S-Mode下的外部中断SEIE/定时器中断STIE/软件中断SSIE*/
+	write_sie(read_sie() | SIE_SEIE | SIE_STIE | SIE_SSIE);
+	/* 内核态下tp寄存器始终保存hartid*/
+	write_tp(_hart_id);
+	write_stvec((uint64_t)_trap);
+
+	main_secondary();
+}
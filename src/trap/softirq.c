@@ -0,0 +1,95 @@
+#include "common/types.h"
+#include "common/bitops.h"
+#include "common/rv64.h"
+#include "cpu/cpu.h"
+#include "dev/clocksource.h"
+#include "process/workqueue.h"
+#include "trap/softirq.h"
+
+static void (*softirq_vec[SOFTIRQ_NR])(void); /* 软中断处理函数*/
+static work_t softirq_works[NCPU];            /* 超出预算时交给kworker继续处理*/
+
+/**
+ * @brief kworker中继续处理软中断
+ *
+ * @param wk
+ */
+static void softirq_work_fn(work_t *wk)
+{
+    register_t sie = disable_si();
+    do_softirq();
+    restore_si(sie);
+}
+/**
+ * @brief 初始化每个核心的软中断延续工作项
+ *
+ */
+void softirq_init(void)
+{
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        work_init(&softirq_works[cpu], softirq_work_fn);
+    }
+}
+/**
+ * @brief 注册软中断处理函数
+ *
+ * @param nr
+ * @param action
+ */
+void open_softirq(uint32_t nr, void (*action)(void))
+{
+    softirq_vec[nr] = action;
+}
+/**
+ * @brief 标记本核心的软中断待处理(可以在中断上下文调用)
+ *
+ * @param nr
+ */
+void raise_softirq(uint32_t nr)
+{
+    register_t sie = disable_si();
+    cpu_this.cpu_softirq_pending |= (1u << nr);
+    restore_si(sie);
+}
+/**
+ * @brief 执行本核心待处理的软中断(关中断调用，返回时仍关中断)
+ *        处理函数开中断执行，期间到达的中断只标记待处理位，由这里的循环继续处理
+ */
+void do_softirq(void)
+{
+    if (cpu_this.cpu_in_softirq || cpu_this.cpu_softirq_pending == 0)
+    {
+        return;
+    }
+    /* 软中断期间不抢占，核心不会改变*/
+    cpu_this.cpu_in_softirq = 1;
+    uint64_t deadline = read_rdtime() + clocksource_us2cyc(SOFTIRQ_BUDGET_US);
+    uint32_t restart = SOFTIRQ_MAX_RESTART;
+    uint32_t pending;
+    while ((pending = cpu_this.cpu_softirq_pending) != 0)
+    {
+        cpu_this.cpu_softirq_pending = 0;
+        enable_si();
+        while (pending)
+        {
+            uint32_t nr = ctz64(pending);
+            pending &= pending - 1;
+            if (softirq_vec[nr] != NULL)
+            {
+                softirq_vec[nr]();
+            }
+        }
+        disable_si();
+        if (--restart == 0 || read_rdtime() >= deadline)
+        {
+            break;
+        }
+    }
+    cpu_this.cpu_in_softirq = 0;
+    if (cpu_this.cpu_softirq_pending)
+    {
+        /* 超出预算：剩余的交给kworker，让出处理器*/
+        queue_work_on(cpuid(), &softirq_works[cpuid()]);
+    }
+}
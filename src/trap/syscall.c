@@ -0,0 +1,405 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/rv64.h"
+#include "common/atomic.h"
+#include "trap/syscall.h"
+#include "dev/clocksource.h"
+#include "dev/hrtimer.h"
+#include "mmu/vmm.h"
+#include "cpu/cpu.h"
+#include "process/proc.h"
+#include "process/thread.h"
+#include "process/sched.h"
+#include "process/futex.h"
+#include "process/uring.h"
+#include "trap/trapstat.h"
+#include "lock/lockstat.h"
+
+static syscall_stat_t syscall_stats[NCPU][NR_SYSCALLS]; /* 每个核心的系统调用统计*/
+
+/**
+ * @brief 当前进程的用户页表
+ *
+ * @return uint64_t
+ */
+static inline uint64_t syscall_pt(void)
+{
+    return cpu_this.cpu_running->td_proc->p_pt;
+}
+/**
+ * @brief 从用户空间读取timespec并换算为纳秒
+ *
+ * @param uaddr
+ * @param ns
+ * @return err_t
+ */
+static err_t timespec_copyin(uint64_t uaddr, uint64_t *ns)
+{
+    timespec_t ts;
+    if (copyin(syscall_pt(), &ts, uaddr, sizeof(ts)) < 0)
+    {
+        return -EFAULT;
+    }
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= (int64_t)NSEC_PER_SEC)
+    {
+        return -EINVAL;
+    }
+    *ns = timespec_to_ns(&ts);
+    return 0;
+}
+/**
+ * @brief 纳秒换算为timespec并写入用户空间
+ *
+ * @param uaddr
+ * @param ns
+ * @return err_t
+ */
+static err_t timespec_copyout(uint64_t uaddr, uint64_t ns)
+{
+    timespec_t ts = {
+        .tv_sec = (int64_t)(ns / NSEC_PER_SEC),
+        .tv_nsec = (int64_t)(ns % NSEC_PER_SEC),
+    };
+    return copyout(syscall_pt(), uaddr, &ts, sizeof(ts));
+}
+/**
+ * @brief void exit(int status)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_exit(trapframe_t *tf)
+{
+    kthread_exit((err_t)tf->a0);
+}
+/**
+ * @brief long futex(uint32_t *uaddr, int op, uint32_t val, const struct timespec *timeout)
+ *        只支持FUTEX_WAIT(相对超时)和FUTEX_WAKE
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_futex(trapframe_t *tf)
+{
+    switch (tf->a1 & FUTEX_CMD_MASK)
+    {
+    case FUTEX_WAIT:
+    {
+        uint64_t wakeus = 0;
+        if (tf->a3 != 0)
+        {
+            uint64_t ns;
+            err_t err = timespec_copyin(tf->a3, &ns);
+            if (err < 0)
+            {
+                return err;
+            }
+            /* 向上取整到微秒，不提前醒来*/
+            wakeus = time_mono_us() + (ns + NSEC_PER_USEC - 1) / NSEC_PER_USEC;
+        }
+        return futex_wait(syscall_pt(), tf->a0, (uint32_t)tf->a2, wakeus);
+    }
+    case FUTEX_WAKE:
+        return futex_wake(syscall_pt(), tf->a0, (uint32_t)tf->a2);
+    default:
+        return -ENOSYS;
+    }
+}
+/**
+ * @brief int nanosleep(const struct timespec *req, struct timespec *rem)
+ *        睡眠不会被信号打断，不写回rem
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_nanosleep(trapframe_t *tf)
+{
+    uint64_t ns;
+    err_t err = timespec_copyin(tf->a0, &ns);
+    if (err < 0)
+    {
+        return err;
+    }
+    return hrtimer_nanosleep(ns, false);
+}
+/**
+ * @brief int clock_settime(clockid_t clockid, const struct timespec *tp)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_clock_settime(trapframe_t *tf)
+{
+    uint64_t ns;
+    err_t err = timespec_copyin(tf->a1, &ns);
+    if (err < 0)
+    {
+        return err;
+    }
+    return clock_settime_ns((int32_t)tf->a0, ns);
+}
+/**
+ * @brief int clock_gettime(clockid_t clockid, struct timespec *tp)
+ *        vdso不支持的时钟回退到这里
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_clock_gettime(trapframe_t *tf)
+{
+    uint64_t ns;
+    err_t err = clock_gettime_ns((int32_t)tf->a0, &ns);
+    if (err < 0)
+    {
+        return err;
+    }
+    return timespec_copyout(tf->a1, ns);
+}
+/**
+ * @brief int clock_getres(clockid_t clockid, struct timespec *res)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_clock_getres(trapframe_t *tf)
+{
+    int32_t clockid = (int32_t)tf->a0;
+    if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC)
+    {
+        return -EINVAL;
+    }
+    if (tf->a1 == 0)
+    {
+        return 0;
+    }
+    /* 分辨率为一个计数周期(向上取整到纳秒)*/
+    return timespec_copyout(tf->a1, (NSEC_PER_SEC + clocksource.cs_freq - 1) / clocksource.cs_freq);
+}
+/**
+ * @brief int clock_nanosleep(clockid_t clockid, int flags, const struct timespec *req, struct timespec *rem)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_clock_nanosleep(trapframe_t *tf)
+{
+    int32_t clockid = (int32_t)tf->a0;
+    if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC)
+    {
+        return -EINVAL;
+    }
+    uint64_t ns;
+    err_t err = timespec_copyin(tf->a2, &ns);
+    if (err < 0)
+    {
+        return err;
+    }
+    if (!(tf->a1 & TIMER_ABSTIME))
+    {
+        return hrtimer_nanosleep(ns, false);
+    }
+    if (clockid == CLOCK_REALTIME)
+    {
+        /* 实时时钟的绝对时间换算为单调时钟的绝对时间*/
+        uint64_t real = clock_real_ns();
+        uint64_t mono = clock_mono_ns();
+        ns = ns > real ? mono + (ns - real) : mono;
+    }
+    return hrtimer_nanosleep(ns, true);
+}
+/**
+ * @brief int sched_yield(void)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_sched_yield(trapframe_t *tf)
+{
+    yield();
+    return 0;
+}
+/**
+ * @brief int gettimeofday(struct timeval *tv, struct timezone *tz)
+ *        tz已废弃，忽略
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_gettimeofday(trapframe_t *tf)
+{
+    if (tf->a0 == 0)
+    {
+        return 0;
+    }
+    uint64_t ns = clock_real_ns();
+    timeval_t tv = {
+        .tv_sec = (int64_t)(ns / NSEC_PER_SEC),
+        .tv_usec = (int64_t)((ns % NSEC_PER_SEC) / NSEC_PER_USEC),
+    };
+    return copyout(syscall_pt(), tf->a0, &tv, sizeof(tv));
+}
+/**
+ * @brief pid_t getpid(void)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_getpid(trapframe_t *tf)
+{
+    return cpu_this.cpu_running->td_proc->p_pid;
+}
+/**
+ * @brief pid_t getppid(void)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_getppid(trapframe_t *tf)
+{
+    proc_t *parent = cpu_this.cpu_running->td_proc->p_parent;
+    return parent == NULL ? 0 : parent->p_pid;
+}
+/**
+ * @brief pid_t gettid(void)
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_gettid(trapframe_t *tf)
+{
+    return cpu_this.cpu_running->td_tid;
+}
+/**
+ * @brief int io_uring_setup(uint32_t entries, struct io_uring_params *p)
+ *        队列长度固定，忽略entries
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_io_uring_setup(trapframe_t *tf)
+{
+    return uring_setup(cpu_this.cpu_running->td_proc, tf->a1);
+}
+/**
+ * @brief int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+ *        每个进程只有一组队列，忽略fd
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_io_uring_enter(trapframe_t *tf)
+{
+    return uring_enter(cpu_this.cpu_running->td_proc, (uint32_t)tf->a1, (uint32_t)tf->a2, (uint32_t)tf->a3);
+}
+/**
+ * @brief long trapstat(int which, unsigned int arg, void *buf)
+ *        JaeOS私有：读取所有核心汇总的统计，which与输出格式见trap/trapstat.h
+ *
+ * @param tf
+ * @return int64_t
+ */
+static int64_t sys_trapstat(trapframe_t *tf)
+{
+    uint32_t which = (uint32_t)tf->a0;
+    uint32_t arg = (uint32_t)tf->a1;
+    if (which == TRAPSTAT_EXCEPTION)
+    {
+        uint64_t counts[TRAPSTAT_EXCEPTION_NR];
+        trapstat_read_exception(counts);
+        return copyout(syscall_pt(), tf->a2, counts, sizeof(counts));
+    }
+    if (which == TRAPSTAT_SYSCALL)
+    {
+        if (arg >= NR_SYSCALLS)
+        {
+            return -EINVAL;
+        }
+        syscall_stat_t stat;
+        syscall_stat_read(arg, &stat);
+        return copyout(syscall_pt(), tf->a2, &stat, sizeof(stat));
+    }
+    if (which == TRAPSTAT_LOCK)
+    {
+#ifdef JAEOS_LOCKSTAT
+        lockstat_record_t recs[LOCKSTAT_DUMP_MAX];
+        int32_t n = lockstat_read(recs, arg < LOCKSTAT_DUMP_MAX ? arg : LOCKSTAT_DUMP_MAX);
+        err_t err = copyout(syscall_pt(), tf->a2, recs, n * sizeof(lockstat_record_t));
+        return err < 0 ? err : n;
+#else
+        return -ENOSYS;
+#endif
+    }
+    trapstat_hist_t th;
+    err_t err = trapstat_read(which, arg, &th);
+    if (err < 0)
+    {
+        return err;
+    }
+    return copyout(syscall_pt(), tf->a2, &th, sizeof(th));
+}
+
+/* 系统调用表(未实现的调用号为NULL，返回-ENOSYS)*/
+static const syscall_fn_t syscall_table[NR_SYSCALLS] = {
+    [SYS_exit] = sys_exit,
+    [SYS_exit_group] = sys_exit,
+    [SYS_futex] = sys_futex,
+    [SYS_nanosleep] = sys_nanosleep,
+    [SYS_clock_settime] = sys_clock_settime,
+    [SYS_clock_gettime] = sys_clock_gettime,
+    [SYS_clock_getres] = sys_clock_getres,
+    [SYS_clock_nanosleep] = sys_clock_nanosleep,
+    [SYS_sched_yield] = sys_sched_yield,
+    [SYS_gettimeofday] = sys_gettimeofday,
+    [SYS_getpid] = sys_getpid,
+    [SYS_getppid] = sys_getppid,
+    [SYS_gettid] = sys_gettid,
+    [SYS_io_uring_setup] = sys_io_uring_setup,
+    [SYS_io_uring_enter] = sys_io_uring_enter,
+    [SYS_trapstat] = sys_trapstat,
+};
+
+/**
+ * @brief 系统调用分发(开中断调用)：按a7查表，返回值写回a0
+ *
+ * @param tf 当前进程的trapframe
+ */
+void syscall_dispatch(trapframe_t *tf)
+{
+    uint64_t nr = tf->a7;
+    if (nr >= NR_SYSCALLS || syscall_table[nr] == NULL)
+    {
+        tf->a0 = (uint64_t)-ENOSYS;
+        return;
+    }
+    uint64_t start = read_rdtime();
+    int64_t ret = syscall_table[nr](tf);
+    uint64_t cycles = read_rdtime() - start;
+    tf->a0 = (uint64_t)ret;
+
+    /* 系统调用期间可能迁移到其他核心，统计到返回时所在的核心；关中断避免被抢占打断读-改-写*/
+    register_t sie = disable_si();
+    syscall_stat_t *stat = &syscall_stats[cpuid()][nr];
+    stat->ss_count++;
+    stat->ss_cycles += cycles;
+    restore_si(sie);
+}
+/**
+ * @brief 汇总所有核心上某个系统调用的统计
+ *
+ * @param nr 系统调用号
+ * @param stat 返回的统计
+ */
+void syscall_stat_read(uint64_t nr, syscall_stat_t *stat)
+{
+    stat->ss_count = 0;
+    stat->ss_cycles = 0;
+    if (nr >= NR_SYSCALLS)
+    {
+        return;
+    }
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        stat->ss_count += READ_ONCE(syscall_stats[cpu][nr].ss_count);
+        stat->ss_cycles += READ_ONCE(syscall_stats[cpu][nr].ss_cycles);
+    }
+}
@@ -1,54 +1,240 @@
 #include "common/types.h"
 #include "common/rv64.h"
+#include "common/errno.h"
 #include "trap/trap.h"
 #include "dev/timer.h"
+#include "dev/hrtimer.h"
+#include "dev/irq.h"
+#include "trap/softirq.h"
+#include "trap/trapstat.h"
+#include "lock/rcu.h"
+#include "lock/lockstat.h"
+#include "cpu/smp.h"
+#include "process/sched.h"
+#include "process/proc.h"
+#include "trap/syscall.h"
+#include "mmu/mmu.h"
+#include "mmu/vmm.h"
+#include "cpu/cpu.h"
 
-extern char ktrap_vector[]; /* 异常向量表地址*/
+extern char ktrap_vector[];  /* 异常向量表地址*/
+extern char trampoline[];    /* trampoline.S的全局符号(跳板页起始地址)*/
+extern char user_vec[];      /* 用户态陷阱入口*/
+extern char user_ret[];      /* 返回用户态(恢复浮点寄存器)*/
+extern char user_ret_fast[]; /* 返回用户态(不恢复浮点寄存器)*/
 /**
- * @brief 设置异常向量表
+ * @brief 设置异常向量表(向量模式：定时器、核间、外部中断直接进入各自的入口)
  *
- * @param handle_addr 异常向量表入口地址
  */
 void set_trap_handle(void)
 {
-    write_stvec((uint64_t)ktrap_vector);
+    write_stvec((uint64_t)ktrap_vector | STVEC_MODE_VECTORED);
 }
 /**
- * @brief C内核异常处理函数入口
+ * @brief 外部中断：处理函数开中断执行，更高优先级的中断源和定时器/核间中断可以嵌套进来
+ *
+ */
+static void trap_external(void)
+{
+    cpu_this.cpu_irq_depth++;
+    irq_dispatch();
+    cpu_this.cpu_irq_depth--;
+}
+/**
+ * @brief 用户态中断分发(内核态的中断由向量表直接分发)
+ *
+ * @param trap_code
+ */
+static void trap_interrupt(uint64_t trap_code)
+{
+    if (trap_code == INTERRUPT_TIMER)
+    {
+        /* 定时器中断*/
+        timer_interrupt_handler();
+    }
+    else if (trap_code == INTERRUPT_SOFTWARE)
+    {
+        /* 核间中断*/
+        ipi_interrupt_handler();
+    }
+    else if (trap_code == INTERRUPT_EXTERNEL)
+    {
+        /* 外部中断*/
+        trap_external();
+    }
+    else
+    {
+        /* 未定义中断*/
+        while (1)
+            ;
+    }
+}
+/**
+ * @brief 内核中断的公共部分(在中断栈上执行，不能切换线程)，内联到每个向量入口中直接调用handler
+ *
+ * @param ktf 被打断代码的寄存器帧(在被打断的栈上)
+ * @param handler 中断处理函数
+ * @return uint64_t 非0时ktrap_vector回到线程栈后调用kernel_trap_tail
+ */
+static inline __attribute__((always_inline)) uint64_t kernel_irq(ktrapframe_t *ktf, void (*handler)(void))
+{
+    /* 被打断的代码处于开中断状态时，中断处理期间计入关中断窗口(嵌套中断计入外层的窗口)*/
+    uint64_t trap_spie = ktf->sstatus & SSTATUS_SPIE_MASK;
+    bool nested = cpu_this.cpu_irq_depth != 0;
+    if (trap_spie && !nested)
+    {
+        lockstat_irqoff_begin();
+    }
+    handler();
+    /* 陷阱返回：不在读临界区时即为静止状态*/
+    rcu_note_qs();
+    if (trap_spie && !nested)
+    {
+        lockstat_irqoff_end();
+    }
+    /* 嵌套中断返回到外层中断处理，不能抢占*/
+    return trap_spie && !nested;
+}
+/**
+ * @brief 内核态定时器中断入口
+ *
+ * @param ktf
+ * @return uint64_t
+ */
+uint64_t kernel_trap_timer(ktrapframe_t *ktf)
+{
+    return kernel_irq(ktf, timer_interrupt_handler);
+}
+/**
+ * @brief 内核态核间中断入口
+ *
+ * @param ktf
+ * @return uint64_t
+ */
+uint64_t kernel_trap_ipi(ktrapframe_t *ktf)
+{
+    return kernel_irq(ktf, ipi_interrupt_handler);
+}
+/**
+ * @brief 内核态外部中断入口
  *
  * @param ktf
+ * @return uint64_t
  */
-void kernel_trap(ktrapframe_t *ktf)
+uint64_t kernel_trap_external(ktrapframe_t *ktf)
+{
+    return kernel_irq(ktf, trap_external);
+}
+/**
+ * @brief 内核态异常和未定义中断的入口
+ *
+ * @param ktf
+ * @return uint64_t
+ */
+uint64_t kernel_trap(ktrapframe_t *ktf)
 {
-    // 获取陷入中断/异常的原因
+    uint64_t trap_cause = read_scause();
+    if ((trap_cause >> SCAUSE_TRAP_CODE_LEN) == SCAUSE_EXCEPTION)
+    {
+        trapstat_exception(trap_cause & SCAUSE_TRAP_CODE_MASK);
+    }
+    //printf("Uncaught Trap: scause = 0x%016lx, epc = 0x%016lx, ra = 0x%016lx\n", trap_cause, ktf->epc, ktf->ra);
+    while (1)
+        ;
+}
+/**
+ * @brief 内核中断返回前的收尾(已回到线程栈，可以开中断、切换线程)
+ *
+ * @param ktf
+ */
+void kernel_trap_tail(ktrapframe_t *ktf)
+{
+    /* 执行硬中断标记的软中断(开中断)*/
+    do_softirq();
+    /* 中断返回前检查是否需要抢占当前线程*/
+    sched_preempt();
+}
+/**
+ * @brief 返回用户态：设置下一次用户态陷阱需要的内核现场，经跳板页切换到用户页表
+ *
+ * @param fast 为true时不恢复浮点寄存器
+ */
+static void __attribute__((noreturn)) user_trap_return(bool fast)
+{
+    thread_t *td = cpu_this.cpu_running;
+    proc_t *p = td->td_proc;
+    trapframe_t *tf = p->p_trapframe;
+    /* 关中断直到sret：之后的陷阱要经过user_vec，此时仍在内核页表上*/
+    disable_si();
+    write_stvec(TRAMPOLINE_VMA + (user_vec - trampoline));
+
+    tf->kernel_satp = make_satp(kernel_root_pte_pa);
+    tf->kernel_sp = td->td_kstack + TD_KSTACK_SIZE;
+    tf->trap_handler = (uint64_t)user_trap;
+    tf->hartid = cpuid();
+    /* 先声明本核心将使用该页表再切换satp：之后修改页表的核心一定会向本核心发送TLB刷新*/
+    WRITE_ONCE(cpu_this.cpu_user_pt, p->p_pt);
+    smp_mb();
+
+    /* sret返回U-Mode并开中断*/
+    uint64_t sstatus = read_sstatus();
+    sstatus &= ~SSTATUS_SPP_MASK;
+    sstatus |= SSTATUS_SPIE_MASK;
+    write_sstatus(sstatus);
+
+    char *ret = fast ? user_ret_fast : user_ret;
+    void (*entry)(uint64_t, uint64_t) = (void (*)(uint64_t, uint64_t))(TRAMPOLINE_VMA + (ret - trampoline));
+    entry(TRAPFRAME_VMA, make_satp(p->p_pt));
+    __builtin_unreachable();
+}
+/**
+ * @brief 返回用户态(首次进入用户态或线程被切换过)，完整恢复寄存器
+ *
+ */
+void user_trap_ret(void)
+{
+    user_trap_return(false);
+}
+/**
+ * @brief 用户态陷阱处理(由user_vec跳转，已切换到内核页表和内核栈)
+ *        系统调用的快速路径：处理期间线程没有被切换、也没有待处理信号时，跳过浮点寄存器的恢复
+ */
+void user_trap(void)
+{
+    /* 内核态的陷阱由ktrap_vector处理*/
+    set_trap_handle();
+    /* user_vec切换到内核页表时已刷新整个TLB，不再需要用户页表的TLB刷新*/
+    WRITE_ONCE(cpu_this.cpu_user_pt, 0);
+    thread_t *td = cpu_this.cpu_running;
+    trapframe_t *tf = td->td_proc->p_trapframe;
+    uint64_t nswitch = td->td_nswitch;
     uint64_t trap_cause = read_scause();
     uint64_t trap_type = (trap_cause >> SCAUSE_TRAP_CODE_LEN);
     uint64_t trap_code = (trap_cause & SCAUSE_TRAP_CODE_MASK);
+    if (trap_type == SCAUSE_EXCEPTION)
+    {
+        trapstat_exception(trap_code);
+    }
 
-    if (trap_type == SCAUSE_INTERRUPT)
-    {
-        if (trap_code == INTERRUPT_TIMER)
-        {
-            /* 定时器中断*/
-            timer_interrupt_handler();
-        }
-        else if (trap_code == INTERRUPT_EXTERNEL)
-        {
-            /* 外部中断*/
-            // trap_device();
-        }
-        else
-        {
-            /* 未定义中断*/
-            while (1)
-                ;
-        }
+    if (trap_type == SCAUSE_EXCEPTION && trap_code == EXCEPTION_ECALL_U)
+    {
+        /* 返回到ecall的下一条指令*/
+        tf->epc += 4;
+        enable_si();
+        syscall_dispatch(tf);
+    }
+    else if (trap_type == SCAUSE_INTERRUPT)
+    {
+        trap_interrupt(trap_code);
+        do_softirq();
     }
     else
     {
-        /* 异常*/
-        //printf("Uncaught Exception: sp = 0x%016lx, ra = 0x%016lx\n", ktf->sp, ktf->ra);
-        while (1)
-            ;
+        /* 用户态的未处理异常：结束线程*/
+        kthread_exit(-EFAULT);
     }
-}
\ No newline at end of file
+    /* 用户态即为静止状态*/
+    rcu_note_qs();
+    sched_preempt();
+    user_trap_return(td->td_nswitch == nswitch && !signal_pending(td));
+}
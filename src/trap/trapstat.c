@@ -0,0 +1,156 @@
+#include "common/types.h"
+#include "common/errno.h"
+#include "common/atomic.h"
+#include "common/rv64.h"
+#include "cpu/cpu.h"
+#include "lib/printf.h"
+#include "lib/string.h"
+#include "trap/trapstat.h"
+
+trapstat_cpu_t trapstat_cpus[NCPU]; /* 每个核心的中断/异常统计*/
+
+/**
+ * @brief 记录一次异常(需关中断)
+ *
+ * @param code scause的异常编号
+ */
+void trapstat_exception(uint64_t code)
+{
+    if (code < TRAPSTAT_EXCEPTION_NR)
+    {
+        trapstat_this.tc_exception[code]++;
+    }
+}
+/**
+ * @brief 把src累加到dst(src可能正在被其他核心修改，逐项单次读取)
+ *
+ * @param dst
+ * @param src
+ */
+static void trapstat_hist_add(trapstat_hist_t *dst, trapstat_hist_t *src)
+{
+    dst->th_count += READ_ONCE(src->th_count);
+    dst->th_total += READ_ONCE(src->th_total);
+    uint64_t max = READ_ONCE(src->th_max);
+    if (max > dst->th_max)
+    {
+        dst->th_max = max;
+    }
+    for (int i = 0; i < TRAPSTAT_BUCKETS; i++)
+    {
+        dst->th_hist[i] += READ_ONCE(src->th_hist[i]);
+    }
+}
+/**
+ * @brief 汇总所有核心的某个直方图
+ *
+ * @param which TRAPSTAT_TIMER_LATENESS/TRAPSTAT_TIMER/TRAPSTAT_IPI/TRAPSTAT_EXTERNAL
+ * @param arg TRAPSTAT_EXTERNAL时为PLIC中断源ID
+ * @param th 返回的直方图
+ * @return err_t
+ */
+err_t trapstat_read(uint32_t which, uint32_t arg, trapstat_hist_t *th)
+{
+    if (which == TRAPSTAT_EXTERNAL && (arg == 0 || arg >= IRQ_NUM))
+    {
+        return -EINVAL;
+    }
+    memset(th, 0, sizeof(*th));
+    for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+    {
+        trapstat_cpu_t *tc = &trapstat_cpus[cpu];
+        switch (which)
+        {
+        case TRAPSTAT_TIMER_LATENESS:
+            trapstat_hist_add(th, &tc->tc_timer_late);
+            break;
+        case TRAPSTAT_TIMER:
+            trapstat_hist_add(th, &tc->tc_timer);
+            break;
+        case TRAPSTAT_IPI:
+            trapstat_hist_add(th, &tc->tc_ipi);
+            break;
+        case TRAPSTAT_EXTERNAL:
+            trapstat_hist_add(th, &tc->tc_external[arg]);
+            break;
+        default:
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief 汇总所有核心的异常次数
+ *
+ * @param counts uint64_t[TRAPSTAT_EXCEPTION_NR]
+ */
+void trapstat_read_exception(uint64_t *counts)
+{
+    for (int i = 0; i < TRAPSTAT_EXCEPTION_NR; i++)
+    {
+        counts[i] = 0;
+        for (uint64_t cpu = 0; cpu < NCPU; cpu++)
+        {
+            counts[i] += READ_ONCE(trapstat_cpus[cpu].tc_exception[i]);
+        }
+    }
+}
+/**
+ * @brief 输出一个直方图(只输出非空的桶)
+ *
+ * @param name
+ * @param irq 外部中断源ID(其他统计项为0)
+ * @param th
+ */
+static void trapstat_hist_dump(const char *name, uint32_t irq, trapstat_hist_t *th)
+{
+    if (th->th_count == 0)
+    {
+        return;
+    }
+    if (irq)
+    {
+        printf("       %s-%-6u", name, irq);
+    }
+    else
+    {
+        printf("       %-15s", name);
+    }
+    printf(" count %lu avg %lu max %lu\n", th->th_count, th->th_total / th->th_count, th->th_max);
+    for (int i = 0; i < TRAPSTAT_BUCKETS; i++)
+    {
+        if (th->th_hist[i])
+        {
+            printf("         < %-12lu %lu\n", i == 0 ? 1ul : 1ul << i, th->th_hist[i]);
+        }
+    }
+}
+/**
+ * @brief 输出所有核心汇总的中断/异常统计
+ *
+ */
+void trapstat_dump(void)
+{
+    trapstat_hist_t th;
+    printf("[JaeOS]Trap Statistics (rdtime cycles):\n");
+    trapstat_read(TRAPSTAT_TIMER_LATENESS, 0, &th);
+    trapstat_hist_dump("timer-lateness", 0, &th);
+    trapstat_read(TRAPSTAT_TIMER, 0, &th);
+    trapstat_hist_dump("timer", 0, &th);
+    trapstat_read(TRAPSTAT_IPI, 0, &th);
+    trapstat_hist_dump("ipi", 0, &th);
+    for (uint32_t irq = 1; irq < IRQ_NUM; irq++)
+    {
+        trapstat_read(TRAPSTAT_EXTERNAL, irq, &th);
+        trapstat_hist_dump("external", irq, &th);
+    }
+    uint64_t counts[TRAPSTAT_EXCEPTION_NR];
+    trapstat_read_exception(counts);
+    for (int i = 0; i < TRAPSTAT_EXCEPTION_NR; i++)
+    {
+        if (counts[i])
+        {
+            printf("       exception %-6d %lu\n", i, counts[i]);
+        }
+    }
+}